@@ -9,7 +9,10 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 #include <fstream>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <sstream>
 #include <math.h>
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -117,6 +120,18 @@ class CoreAffinity {
         // core_counter_
     }
 
+    // numa node of the core that thread tid is bound to, -1 if not bound
+    int GetNumaNodeOfThread(int tid) {
+        if (!config_->global_enable_core_binding) {
+            return -1;
+        }
+        auto itr = thread_to_core_map.find(tid);
+        if (itr == thread_to_core_map.end()) {
+            return -1;
+        }
+        return cpuinfo_->GetSocketMappingVector(itr->second);
+    }
+
     void GetStealList(int tid, vector<int> & list) {
         int core_id = thread_to_core_map[tid];
         for (auto itr = stealing_table[core_id].begin(); itr != stealing_table[core_id].end(); itr++) {
@@ -124,6 +139,115 @@ class CoreAffinity {
         }
     }
 
+    // number of threads that msgs of expert type are sent to
+    int GetNumThreadsForExpert(EXPERT_T type) {
+        if (config_->global_enable_expert_division) {
+            ExpertDivisionType att = expert_division[type];
+            pthread_spin_lock(&(lock_table[att]));
+            int num = core_pool_table[att].size();
+            pthread_spin_unlock(&(lock_table[att]));
+            return num;
+        } else {
+            return config_->global_num_threads;
+        }
+    }
+
+    // add the time spent by an expert of type on one msg to its division
+    void RecordServiceTime(EXPERT_T type, uint64_t usec) {
+        if (config_->global_enable_expert_division) {
+            busy_usec_[expert_division[type]].fetch_add(usec, std::memory_order_relaxed);
+        }
+    }
+
+    // Adapt the number of threads of divisions to their load
+    //
+    // Load of a division is the time spent on its experts since last call, by
+    // any thread (stealing included), smoothed over calls. One thread is moved
+    // per call from the division with most threads beyond its share of load to
+    // the one with most threads lacking, threads stay bound to their cores.
+    // Msgs already sent to a moved thread are run there as before, only new
+    // msgs follow the new division.
+    //
+    // Return true if a thread is moved.
+    bool Rebalance() {
+        if (!config_->global_enable_expert_division || core_pool_table.size() != NUM_THREAD_DIVISION) {
+            return false;
+        }
+
+        double total = 0;
+        for (int i = 0; i < NUM_THREAD_DIVISION; i++) {
+            load_[i] = 0.5 * load_[i] + 0.5 * busy_usec_[i].exchange(0, std::memory_order_relaxed);
+            total += load_[i];
+        }
+        if (total == 0) {
+            return false;
+        }
+
+        // threads beyond (> 0) or lacking (< 0) the share of load
+        int num_thread = config_->global_num_threads;
+        int from = -1, to = -1;
+        double max_surplus = 0, max_deficit = 0;
+        for (int i = 0; i < NUM_THREAD_DIVISION; i++) {
+            double share = max(1.0, load_[i] / total * num_thread);
+            double surplus = num_threads[i] - share;
+            if (surplus > max_surplus && num_threads[i] > 1) {
+                max_surplus = surplus;
+                from = i;
+            }
+            if (-surplus > max_deficit) {
+                max_deficit = -surplus;
+                to = i;
+            }
+        }
+        // leave small differences to stealing
+        if (from < 0 || to < 0 || max_surplus < 1 || max_deficit < 1) {
+            return false;
+        }
+
+        // lock in order of division
+        int first = min(from, to), second = max(from, to);
+        pthread_spin_lock(&(lock_table[first]));
+        pthread_spin_lock(&(lock_table[second]));
+        int core_id = core_pool_table[from].back();
+        core_pool_table[from].pop_back();
+        core_pool_table[to].push_back(core_id);
+        core_pool_pos_[from] %= core_pool_table[from].size();
+        thread_division_[core_to_thread_map[core_id]].store(to, std::memory_order_relaxed);
+        num_threads[from]--;
+        num_threads[to]++;
+        pthread_spin_unlock(&(lock_table[second]));
+        pthread_spin_unlock(&(lock_table[first]));
+        return true;
+    }
+
+    // whether msgs routed to thread tid may run on thread other_tid instead,
+    // as stealing does, any two threads if experts are not divided
+    bool InSameDivision(int tid, int other_tid) {
+        if (!config_->global_enable_expert_division) {
+            return true;
+        }
+        // no lock, a thread moved by a concurrent Rebalance() may be seen in
+        // either division as with msgs already routed to it
+        int division = thread_division_[tid].load(std::memory_order_relaxed);
+        return division >= 0 && division == thread_division_[other_tid].load(std::memory_order_relaxed);
+    }
+
+    // current threads and load of each division
+    string DivisionString() {
+        stringstream ss;
+        ss << "Divisions :" << endl;
+        for (int i = 0; i < NUM_THREAD_DIVISION; i++) {
+            pthread_spin_lock(&(lock_table[i]));
+            ss << "    " << DebugString(i) << " : " << core_pool_table[i].size() << " threads [";
+            for (auto core_id : core_pool_table[i]) {
+                ss << " " << core_to_thread_map[core_id];
+            }
+            pthread_spin_unlock(&(lock_table[i]));
+            ss << " ], load " << load_[i] / 1000 << " ms" << endl;
+        }
+        return ss.str();
+    }
+
     int GetThreadIdForExpert(EXPERT_T type) {
         if (config_->global_enable_expert_division) {
             return core_to_thread_map[get_core_id_by_expert(type)];
@@ -186,11 +310,19 @@ class CoreAffinity {
     map<EXPERT_T, ExpertDivisionType> expert_division;
 
     map<int, vector<int>> core_pool_table;
-    map<int, vector<int>::iterator> core_pool_table_itr;
+    // next position in core_pool_table to send msgs to
+    int core_pool_pos_[NUM_THREAD_DIVISION] = {0};
     pthread_spinlock_t lock_table[NUM_THREAD_DIVISION];
 
+    // usec spent on experts of each division since last Rebalance()
+    std::atomic<uint64_t> busy_usec_[NUM_THREAD_DIVISION] = {};
+    // smoothed busy usec per Rebalance()
+    double load_[NUM_THREAD_DIVISION] = {0};
+
     map<int, int> core_to_thread_map;
     map<int, int> thread_to_core_map;
+    // division of each thread, kept with core_pool_table for lookups without lock
+    unique_ptr<std::atomic<int>[]> thread_division_;
 
     SimpleThreadSafeMap<int, vector<int>> core_counter_;  // this is implemented in case of bad affinity implementation
 
@@ -397,19 +529,24 @@ class CoreAffinity {
             }
         }
 
-        // Init Iterator and lock
+        // Init position and lock
         for (int i = 0; i < NUM_THREAD_DIVISION; i++) {
-            core_pool_table_itr[i] = core_pool_table[i].begin();
+            core_pool_pos_[i] = 0;
             pthread_spin_init(&lock_table[i], 0);
         }
     }
 
     void load_core_to_thread_map() {
         int thread_id = 0;
+        thread_division_.reset(new std::atomic<int>[config_->global_num_threads]);
+        for (int i = 0; i < config_->global_num_threads; i++) {
+            thread_division_[i].store(-1, std::memory_order_relaxed);
+        }
         for (int i = 0; i < NUM_THREAD_DIVISION; i++) {
             for (auto & core_id : core_pool_table[i]) {
                 core_to_thread_map[core_id] = thread_id;
                 thread_to_core_map[thread_id] = core_id;
+                thread_division_[thread_id].store(i, std::memory_order_relaxed);
                 thread_id++;
             }
         }
@@ -455,11 +592,9 @@ class CoreAffinity {
         ExpertDivisionType att = expert_division[type];
 
         pthread_spin_lock(&(lock_table[att]));
-        int cur_tid = *core_pool_table_itr[att];
-        core_pool_table_itr[att]++;
-        if (core_pool_table_itr[att] == core_pool_table[att].end()) {
-            core_pool_table_itr[att] = core_pool_table[att].begin();
-        }
+        vector<int> & pool = core_pool_table[att];
+        int cur_tid = pool[core_pool_pos_[att]];
+        core_pool_pos_[att] = (core_pool_pos_[att] + 1) % pool.size();
         pthread_spin_unlock(&(lock_table[att]));
 
         return cur_tid;
@@ -0,0 +1,140 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#ifndef LATENCY_HISTOGRAM_HPP_
+#define LATENCY_HISTOGRAM_HPP_
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "base/serialization.hpp"
+
+// HDR style histogram of latencies (usec)
+//
+// Values are grouped into log-linear buckets: values below 2^SUB_BUCKET_BITS are
+// counted exactly, every larger power-of-2 range is split into 2^(SUB_BUCKET_BITS-1)
+// equal sub-buckets, so any recorded value is reported within 0.2% of its true value.
+// Memory grows with the log of the largest value instead of the number of samples,
+// and histograms from different threads or nodes are merged by adding counters.
+class LatencyHistogram {
+ public:
+    LatencyHistogram() : total_(0), sum_(0), min_(UINT64_MAX), max_(0) {}
+
+    void Record(uint64_t value) {
+        size_t idx = Index(value);
+        if (idx >= counts_.size()) {
+            counts_.resize(idx + 1, 0);
+        }
+        counts_[idx]++;
+
+        total_++;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void Merge(const LatencyHistogram& other) {
+        if (other.counts_.size() > counts_.size()) {
+            counts_.resize(other.counts_.size(), 0);
+        }
+        for (size_t i = 0; i < other.counts_.size(); i++) {
+            counts_[i] += other.counts_[i];
+        }
+
+        total_ += other.total_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    // value at given percentile, e.g. 99.9
+    // returns the highest value equivalent to the bucket reaching the percentile
+    uint64_t Percentile(double percentile) const {
+        if (total_ == 0) {
+            return 0;
+        }
+
+        uint64_t target = percentile / 100 * total_ + 0.5;
+        target = std::max(target, (uint64_t)1);
+        target = std::min(target, total_);
+
+        uint64_t cnt = 0;
+        for (size_t i = 0; i < counts_.size(); i++) {
+            cnt += counts_[i];
+            if (cnt >= target) {
+                return std::min(HighestEquivalent(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t Count() const { return total_; }
+    uint64_t Min() const { return total_ == 0 ? 0 : min_; }
+    uint64_t Max() const { return max_; }
+    double Mean() const { return total_ == 0 ? 0 : (double)sum_ / total_; }
+
+ private:
+    static const int SUB_BUCKET_BITS = 10;
+    static const uint64_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT >> 1;
+
+    // counter index of value
+    static size_t Index(uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return value;
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int shift = msb - (SUB_BUCKET_BITS - 1);
+        return shift * SUB_BUCKET_HALF + (value >> shift);
+    }
+
+    // largest value counted in the counter at idx
+    static uint64_t HighestEquivalent(size_t idx) {
+        if (idx < SUB_BUCKET_COUNT) {
+            return idx;
+        }
+        int shift = idx / SUB_BUCKET_HALF - 1;
+        uint64_t lowest = (idx - shift * SUB_BUCKET_HALF) << shift;
+        return lowest + (1ULL << shift) - 1;
+    }
+
+    vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+
+    friend ibinstream& operator<<(ibinstream& m, const LatencyHistogram& h);
+    friend obinstream& operator>>(obinstream& m, LatencyHistogram& h);
+};
+
+// only non-empty counters are sent
+inline ibinstream& operator<<(ibinstream& m, const LatencyHistogram& h) {
+    vector<pair<uint64_t, uint64_t>> counts;
+    for (size_t i = 0; i < h.counts_.size(); i++) {
+        if (h.counts_[i] != 0) {
+            counts.emplace_back(i, h.counts_[i]);
+        }
+    }
+    m << counts << h.total_ << h.sum_ << h.min_ << h.max_;
+    return m;
+}
+
+inline obinstream& operator>>(obinstream& m, LatencyHistogram& h) {
+    vector<pair<uint64_t, uint64_t>> counts;
+    m >> counts >> h.total_ >> h.sum_ >> h.min_ >> h.max_;
+
+    h.counts_.clear();
+    if (!counts.empty()) {
+        h.counts_.resize(counts.back().first + 1, 0);
+    }
+    for (auto& p : counts) {
+        h.counts_[p.first] = p.second;
+    }
+    return m;
+}
+
+#endif  // LATENCY_HISTOGRAM_HPP_
@@ -27,7 +27,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "base/rdma.hpp"
 
 RDMA_Device::RDMA_Device(int num_nodes, int num_threads, int nid, char *mem, uint64_t mem_sz, vector<Node> & nodes, vector<Node> & memory_nodes) : 
-    num_threads_(num_threads), memory_nodes_(memory_nodes) {
+    num_threads_(num_threads), memory_nodes_(memory_nodes), num_requested_reads_(0), num_posted_reads_(0) {
     // record IPs of ndoes
     vector<string> ipset;
     for (const auto & node : nodes)
@@ -182,6 +182,79 @@ int RDMA_Device::RdmaReadBatch(int dst_tid, int dst_nid, char*local, uint64_t si
     return 0;
 }
 
+int RDMA_Device::RdmaReadCoalesced(int dst_tid, int dst_nid, char *local, uint64_t local_sz, uint64_t size, vector<uint64_t> &off, uint64_t begin, uint64_t num, uint64_t gap) {
+    static thread_local ReadPlanner planner;
+    static thread_local vector<ReadSpan> spans;
+
+    uint64_t stage_sz = local_sz > size * num ? local_sz - size * num : 0;
+    planner.Plan(&off[begin], num, size, local, gap, local + size * num, stage_sz, spans);
+    num_requested_reads_ += num;
+    num_posted_reads_ += spans.size();
+
+    if (RdmaReadSpans(dst_tid, dst_nid, spans) != 0)
+        return -1;
+    planner.Scatter();
+    return 0;
+}
+
+// post spans as one batch and wait for the last one
+int RDMA_Device::RdmaReadSpans(int dst_tid, int dst_nid, vector<ReadSpan> &spans) {
+    if (RdmaPostReadSpans(dst_tid, dst_nid, spans) != 0) {
+        return -1;
+    }
+    return RdmaPollCompletion(dst_tid, dst_nid);
+}
+
+int RDMA_Device::RdmaPostReadSpans(int dst_tid, int dst_nid, vector<ReadSpan> &spans) {
+    RCQP * qp = global_rdma_ctrl->get_rc_qp(create_rc_idx(dst_nid, dst_tid));
+    int num = spans.size();
+    struct ibv_send_wr sr[num];
+    struct ibv_sge sge[num];
+    struct ibv_send_wr* bad_sr;
+
+    for(int i = 0; i < num; ++i) {
+        sge[i].addr = (uint64_t)spans[i].local;
+        sge[i].length = spans[i].len;
+        sge[i].lkey = qp->local_mr_.key;
+
+        sr[i].wr_id = 0;
+        sr[i].opcode = IBV_WR_RDMA_READ;
+        sr[i].num_sge = 1;
+        sr[i].next = (i == num -1) ? NULL : &(sr[i+1]);
+
+        sr[i].sg_list = &sge[i];
+        sr[i].send_flags = 0;
+        sr[i].imm_data = 0;
+
+        sr[i].wr.rdma.remote_addr = qp->remote_mr_.buf + spans[i].off;
+        sr[i].wr.rdma.rkey = qp->remote_mr_.key;
+    }
+    sr[num-1].send_flags = IBV_SEND_SIGNALED;
+    auto rc = qp->post_batch(&(sr[0]), &bad_sr);
+    if(rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: post batch failed. rc = " << rc;
+        return -1;
+    }
+    return 0;
+}
+
+int RDMA_Device::RdmaPollCompletion(int dst_tid, int dst_nid) {
+    RCQP * qp = global_rdma_ctrl->get_rc_qp(create_rc_idx(dst_nid, dst_tid));
+    ibv_wc wc;
+    auto rc = qp->poll_till_completion(wc, no_timeout);
+    if(rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: poll read failed. rc=" << rc;
+        return -1;
+    }
+    return 0;
+}
+
+string RDMA_Device::ReadStatString() {
+    uint64_t requested = num_requested_reads_;
+    uint64_t posted = num_posted_reads_;
+    return "Coalesced reads : " + to_string(requested) + " requested, " + to_string(posted) + " posted\n";
+}
+
 int RDMA_Device::RdmaWrite(int dst_tid, int dst_nid, char *local, uint64_t size, uint64_t off) {
     // RCQP * qp = qp_man_->GetRemoteDataQPWithNodeID(dst_nid);
 
@@ -194,15 +267,50 @@ int RDMA_Device::RdmaWrite(int dst_tid, int dst_nid, char *local, uint64_t size,
         return -1;
     }
     // TODO(big) batch polling ? see pendind_qps in ford
+    // wait for the write to complete, as mutations publish it by atomics later
     ibv_wc wc{};
-    int poll_rc = qp->poll_send_completion(wc);
-    if(poll_rc != SUCC) {
+    rc = qp->poll_till_completion(wc, no_timeout);
+    if(rc != SUCC) {
         RDMA_LOG(ERROR) << "client: poll write fail. rc=" << rc;
         return -1;
     }
     return 0;
 }
 
+int RDMA_Device::RdmaCompareAndSwap(int dst_tid, int dst_nid, char *local, uint64_t compare, uint64_t swap, uint64_t off) {
+    RCQP * qp = global_rdma_ctrl->get_rc_qp(create_rc_idx(dst_nid, dst_tid));
+
+    auto rc = qp->post_cas(local, off, compare, swap, IBV_SEND_SIGNALED);
+    if (rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: post cas fail. rc = " << rc;
+        return -1;
+    }
+    ibv_wc wc;
+    rc = qp->poll_till_completion(wc, no_timeout);
+    if (rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: poll cas fail. rc=" << rc;
+        return -1;
+    }
+    return 0;
+}
+
+int RDMA_Device::RdmaFetchAndAdd(int dst_tid, int dst_nid, char *local, uint64_t add, uint64_t off) {
+    RCQP * qp = global_rdma_ctrl->get_rc_qp(create_rc_idx(dst_nid, dst_tid));
+
+    auto rc = qp->post_faa(local, off, add, IBV_SEND_SIGNALED);
+    if (rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: post faa fail. rc = " << rc;
+        return -1;
+    }
+    ibv_wc wc;
+    rc = qp->poll_till_completion(wc, no_timeout);
+    if (rc != SUCC) {
+        RDMA_LOG(ERROR) << "client: poll faa fail. rc=" << rc;
+        return -1;
+    }
+    return 0;
+}
+
 void RDMA_init(int num_nodes,  int num_threads, int nid, char *mem, uint64_t mem_sz, vector<Node> & nodes, vector<Node> & memory_nodes) {
     uint64_t t = timer::get_usec();
 
@@ -29,11 +29,13 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 
 // #pragma GCC diagnostic warning "-fpermissive"
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <iostream>     // std::cout
 #include <fstream>      // std::ifstream
 #include "base/node.hpp"
+#include "base/read_planner.hpp"
 
 using namespace std;
 
@@ -66,8 +68,32 @@ public:
 
     int RdmaReadBatch(int dst_tid, int dst_nid, char *local, uint64_t size, vector<uint64_t> &off, uint64_t begin, uint64_t len);
 
+    // same as RdmaReadBatch, but reads within gap bytes are merged into one
+    // read, local_sz is the size of local buffer, beyond len * size is used
+    // as staging area of merged reads
+    int RdmaReadCoalesced(int dst_tid, int dst_nid, char *local, uint64_t local_sz, uint64_t size, vector<uint64_t> &off, uint64_t begin, uint64_t len, uint64_t gap);
+
+    // read spans of any size in one batch, 0 on success, -1 otherwise
+    int RdmaReadSpans(int dst_tid, int dst_nid, vector<ReadSpan> &spans);
+
+    // async version of RdmaReadSpans, the batch completes at the next
+    // RdmaPollCompletion on the same QP, nothing else may be posted on the QP
+    // in between
+    int RdmaPostReadSpans(int dst_tid, int dst_nid, vector<ReadSpan> &spans);
+
+    int RdmaPollCompletion(int dst_tid, int dst_nid);
+
+    // number of reads requested and posted by RdmaReadCoalesced
+    string ReadStatString();
+
     int RdmaWrite(int dst_tid, int dst_nid, char *local, uint64_t size, uint64_t off);
 
+    // atomics on the 8 bytes at off (8-byte aligned), the value before the
+    // operation is returned in local, 0 on success, -1 otherwise
+    int RdmaCompareAndSwap(int dst_tid, int dst_nid, char *local, uint64_t compare, uint64_t swap, uint64_t off);
+
+    int RdmaFetchAndAdd(int dst_tid, int dst_nid, char *local, uint64_t add, uint64_t off);
+
 private:   
 
     void GetMRMeta(const vector<Node>& memory_nodes);    
@@ -81,6 +107,9 @@ private:
     // LCY: if more remote nodes, change this to a map<node_id, MemoryAttr>
     MemoryAttr remote_mr_;
 
+    atomic<uint64_t> num_requested_reads_;
+    atomic<uint64_t> num_posted_reads_;
+
     // QPManager *qp_man_;        
     };
 
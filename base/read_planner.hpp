@@ -0,0 +1,89 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// One RDMA read of [off, off + len) of the remote region into local
+struct ReadSpan {
+    uint64_t off;
+    uint64_t len;
+    char * local;
+};
+
+// Planner of a batch of remote reads of the same size
+//
+// Reads are sorted by offset and those within gap bytes of each other are
+// merged into one span, so that a dense batch becomes a few large reads
+// instead of many small ones. A read that is not merged goes directly to its
+// destination, merged spans go to a staging area and each read is copied out
+// of it by Scatter() after the spans complete. Spans are merged only while
+// the staging area has room.
+class ReadPlanner {
+ public:
+    // plan num reads of size bytes at off[0, num), read i goes to dst + i * size
+    void Plan(const uint64_t * off, int num, uint64_t size, char * dst,
+              uint64_t gap, char * stage, uint64_t stage_sz, vector<ReadSpan> & spans) {
+        size_ = size;
+        dst_ = dst;
+        spans.clear();
+        copies_.clear();
+
+        order_.resize(num);
+        for (int i = 0; i < num; i++) {
+            order_[i] = i;
+        }
+        sort(order_.begin(), order_.end(), [&](int l, int r) { return off[l] < off[r]; });
+
+        uint64_t staged = 0;
+        int i = 0;
+        while (i < num) {
+            // extend the span while the next read is within gap and it fits in stage
+            uint64_t begin = off[order_[i]];
+            uint64_t end = begin + size;
+            int j = i + 1;
+            while (j < num && off[order_[j]] <= end + gap && staged + max(end, off[order_[j]] + size) - begin <= stage_sz) {
+                end = max(end, off[order_[j]] + size);
+                j++;
+            }
+
+            if (j == i + 1) {
+                spans.push_back(ReadSpan{begin, size, dst + order_[i] * size});
+            } else {
+                char * local = stage + staged;
+                spans.push_back(ReadSpan{begin, end - begin, local});
+                for (int k = i; k < j; k++) {
+                    copies_.push_back(Copy{local + (off[order_[k]] - begin), order_[k]});
+                }
+                staged += end - begin;
+            }
+            i = j;
+        }
+    }
+
+    // copy merged reads from stage to their destinations
+    void Scatter() {
+        for (auto & c : copies_) {
+            memcpy(dst_ + c.index * size_, c.src, size_);
+        }
+    }
+
+ private:
+    struct Copy {
+        char * src;
+        int index;
+    };
+
+    uint64_t size_;
+    char * dst_;
+    vector<int> order_;
+    vector<Copy> copies_;
+};
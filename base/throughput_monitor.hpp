@@ -8,28 +8,35 @@ Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
 
 #include <unordered_map>
 
+#include "base/latency_histogram.hpp"
 #include "utils/timer.hpp"
 
 class Throughput_Monitor {
  public:
     Throughput_Monitor() : is_emu_(false) {}
-    void StartEmu() {
+
+    // queries started within warmup_time (usec) are excluded from statistics
+    void StartEmu(uint64_t warmup_time = 0) {
         {
             unique_lock<mutex> lock(thread_mutex_);
             stats_.clear();
+            histograms_.clear();
         }
 
         num_completed_ = 0;
         num_recorded_ = 0;
+        num_measured_ = 0;
         last_cnt_ = 0;
         start_time_ = last_time_ = timer::get_usec();
+        measure_start_time_ = start_time_ + warmup_time;
         is_emu_ = true;
     }
 
+    // stop counting throughput, latencies of queries still running are recorded
+    // until GetHistograms is called
     void StopEmu() {
         last_time_ = timer::get_usec();
-        last_cnt_ = num_completed_;
-        is_emu_ = false;
+        last_cnt_ = num_measured_;
     }
 
     // Set the start time of emu command
@@ -40,47 +47,59 @@ class Throughput_Monitor {
     }
 
     // Set the start time of normal query
-    void RecordStart(uint64_t qid, int query_type = -1) {
+    // in open-loop emulation, start_time is the scheduled time of the query
+    // so that the delay before sending counts into latency
+    void RecordStart(uint64_t qid, int query_type = -1, uint64_t start_time = 0) {
         num_recorded_++;
+        if (start_time == 0) {
+            start_time = timer::get_usec();
+        }
         unique_lock<mutex> lock(thread_mutex_);
-        stats_[qid] = make_pair(query_type, timer::get_usec());
+        stats_[qid] = make_pair(query_type, start_time);
     }
 
     // Record latency of query
     uint64_t RecordEnd(uint64_t qid) {
         num_completed_ ++;
+        uint64_t now = timer::get_usec();
         unique_lock<mutex> lock(thread_mutex_);
-        uint64_t latency = timer::get_usec() - stats_[qid].second;
-        if (!is_emu_) {
-            stats_.erase(qid);
-        } else {
-            stats_.at(qid).second = latency;
+        auto itr = stats_.find(qid);
+        if (itr == stats_.end()) {
+            return 0;
         }
+        uint64_t latency = now - itr->second.second;
+        if (is_emu_ && now >= measure_start_time_) {
+            num_measured_++;
+        }
+        if (is_emu_ && itr->second.second >= measure_start_time_) {
+            histograms_[itr->second.first].Record(latency);
+        }
+        stats_.erase(itr);
         return latency;
     }
 
+    // throughput after warmup, 0 if the run ended within warmup
     double GetThroughput() {
+        if (last_time_ <= measure_start_time_) {
+            cout << "No throughput measured, emu run is not longer than warmup" << endl;
+            return 0;
+        }
         double thpt = 1000.0 * last_cnt_;
-        thpt /= (last_time_ - start_time_);
+        thpt /= (last_time_ - measure_start_time_);
         return thpt;
     }
 
-    void GetLatencyMap(map<int, vector<uint64_t>>& m) {
-        for (auto & latency : stats_) {
-            m[latency.second.first].push_back(latency.second.second);
-        }
+    // take latency histograms of each query type and stop recording
+    void GetHistograms(map<int, LatencyHistogram>& m) {
         unique_lock<mutex> lock(thread_mutex_);
-        stats_.clear();
-    }
-
-    void PrintCDF(vector<map<int, vector<uint64_t>>>& vec) {
-        map<int, vector<uint64_t>> m;
-        for (auto& node_map : vec) {
-            for (auto& item : node_map) {
-                m[item.first].insert(m[item.first].end(), item.second.begin(), item.second.end());
-            }
+        is_emu_ = false;
+        for (auto & item : histograms_) {
+            m[item.first].Merge(item.second);
         }
+        histograms_.clear();
+    }
 
+    void PrintCDF(map<int, LatencyHistogram>& m) {
         vector<double> cdf_rates = {0.01};
 
         // output cdf
@@ -92,24 +111,6 @@ class Throughput_Monitor {
         for (int i = 1; i <= 5; i++)
             cdf_rates.push_back(0.95 + i * 0.01);
 
-        map<int, vector<uint64_t>> cdf_res;
-        for (auto& item : m) {
-            if (!item.second.empty()) {
-                sort(item.second.begin(), item.second.end());
-
-                int query_type = item.first;
-                int cnt = 0;
-                // select 25 points from total_latency_map
-                // select points from lats corresponding to cdf_rates
-                for (auto const &rate : cdf_rates) {
-                    int idx = item.second.size() * rate;
-                    if (idx >= item.second.size()) idx = item.second.size() - 1;
-                    cdf_res[query_type].push_back(item.second[idx]);
-                    cnt++;
-                }
-                assert(cdf_res[query_type].size() == 25);
-            }
-        }
         string ofname = "CDF.txt";
         ofstream ofs(ofname, ofstream::out);
         ofs << "CDF Res: " << endl;
@@ -130,7 +131,7 @@ class Throughput_Monitor {
                 ofs << 95 + (row - 20) << "\t";
 
             for (auto& item : m) {
-                ofs << cdf_res[item.first][row - 1] << "\t";
+                ofs << item.second.Percentile(cdf_rates[row - 1] * 100) << "\t";
             }
 
             ofs << endl;
@@ -156,6 +157,8 @@ class Throughput_Monitor {
 private:
     uint64_t num_completed_;
     uint64_t num_recorded_;
+    // completed after warmup
+    uint64_t num_measured_;
     bool is_emu_;
     mutex thread_mutex_;
 
@@ -163,9 +166,13 @@ private:
     uint64_t last_cnt_;
     uint64_t last_time_;
     uint64_t start_time_;
+    uint64_t measure_start_time_;
     static const uint64_t interval = 500000;
 
+    // qid -> <query_type, start_time>
     unordered_map<uint64_t, pair<int, uint64_t>> stats_;
+    // query_type -> latencies
+    map<int, LatencyHistogram> histograms_;
 };
 
 #endif  // THROUGHTPUT_MONITOR_HPP_
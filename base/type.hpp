@@ -99,6 +99,22 @@ obinstream& operator>>(obinstream& m, ikey_t& p);
 
 bool operator == (const ikey_t &p1, const ikey_t &p2);
 
+// Allocation cursors of the remote region, at the end of it
+//
+// Written by the memory node after loading, then only advanced by compute
+// nodes with RDMA fetch-and-add when they mutate the graph
+struct AllocHeader {
+    uint64_t v_next;         // vid of the next added vertex
+    uint64_t v_ext_last;     // bytes used in ext of vertex table
+    uint64_t vp_ext_last;    // indirect buckets used in VKVStore
+    uint64_t vp_entry_last;  // bytes used in entries of VKVStore
+    uint64_t ep_ext_last;    // indirect buckets used in EKVStore
+    uint64_t ep_entry_last;  // bytes used in entries of EKVStore
+};
+
+// max number of in/out nbs inline in a vertex record
+#define MAX_INLINE_NBS 32
+
 enum {VID_BITS = 26};  // <32; the total # of vertices should no be more than 2^26
 enum {EID_BITS = (VID_BITS * 2)};  // eid = v1_id | v2_id (52 bits)
 enum {PID_BITS = (64 - EID_BITS)};  // 12, the total # of property should no be more than 2^PID_BITS
@@ -386,11 +402,23 @@ struct string_index {
 
 enum Index_T { E_LABEL, E_PROPERTY, V_LABEL, V_PROPERTY };
 
+// Requests from client to worker
+// Query: run a new query
+// Next: a chunk of results is consumed, ask for more
+enum Request_T { REQ_QUERY, REQ_NEXT };
+
+// Priority classes of queries
+// Auto: low for queries scanning all vertices/edges, otherwise high
+enum Priority_T { PRIORITY_HIGH, PRIORITY_LOW, PRIORITY_AUTO };
+
+// Placement of vertices in the vertex table, see storage/vertex_order.hpp
+enum VtxOrder_T { ORDER_NONE, ORDER_DEGREE, ORDER_BFS, ORDER_LABEL };
+
 // Spawn: spawn a new expert
 // Feed: "proxy" feed expert a input
 // Reply: expert returns the intermidiate result to expert
-enum class MSG_T : char { INIT, SPAWN, FEED, REPLY, BARRIER, BRANCH, EXIT };
-static const char *MsgType[] = {"init", "spawn", "feed", "reply", "barrier", "branch", "exit"};
+enum class MSG_T : char { INIT, SPAWN, FEED, REPLY, BARRIER, BRANCH, EXIT, ABORT };
+static const char *MsgType[] = {"init", "spawn", "feed", "reply", "barrier", "branch", "exit", "abort"};
 
 ibinstream& operator<<(ibinstream& m, const MSG_T& type);
 
@@ -398,11 +426,11 @@ obinstream& operator>>(obinstream& m, MSG_T& type);
 
 enum class EXPERT_T : char {
     INIT, AGGREGATE, AS, BRANCH, BRANCHFILTER, CAP, CONFIG, COUNT, DEDUP, GROUP, HAS, HASLABEL, INDEX,
-    IS, KEY, LABEL, MATH, ORDER, PROPERTY, RANGE, SELECT, TRAVERSAL, VALUES, WHERE, COIN, REPEAT, END
+    IS, KEY, LABEL, MATH, ORDER, PROPERTY, RANGE, SELECT, TRAVERSAL, VALUES, WHERE, COIN, REPEAT, MUTATE, END
 };
 
 static const char *ExpertType[] = { "INIT", "AGGREGATE", "AS", "BRANCH", "BRANCHFILTER", "CAP", "CONFIG", "COUNT", "DEDUP", "GROUP", "HAS",
-"HASLABEL", "INDEX", "IS", "KEY", "LABEL", "MATH", "ORDER", "PROPERTY", "RANGE", "SELECT", "TRAVERSAL", "VALUES", "WHERE" , "COIN", "REPEAT", "END"};
+"HASLABEL", "INDEX", "IS", "KEY", "LABEL", "MATH", "ORDER", "PROPERTY", "RANGE", "SELECT", "TRAVERSAL", "VALUES", "WHERE" , "COIN", "REPEAT", "MUTATE", "END"};
 
 ibinstream& operator<<(ibinstream& m, const EXPERT_T& type);
 
@@ -415,6 +443,7 @@ enum Element_T{ VERTEX, EDGE };
 enum Direction_T{ IN, OUT, BOTH };
 enum Order_T {INCR, DECR};
 enum Predicate_T{ ANY, NONE, EQ, NEQ, LT, LTE, GT, GTE, INSIDE, OUTSIDE, BETWEEN, WITHIN, WITHOUT };
+enum Mutate_T{ ADD_VTX, ADD_EDGE, SET_VP, SET_EP };
 
 struct qid_t {
     uint32_t nid;
@@ -0,0 +1,70 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#ifndef BENCH_HPP_
+#define BENCH_HPP_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "utils/timer.hpp"
+
+using namespace std;
+
+// Minimal microbenchmark harness
+//
+// A benchmark is a function running the measured code state.iters times.
+// Register it at file scope with
+//     BENCHMARK(BM_Name);
+// and the runner in bench_main.cpp calibrates iters, repeats the measurement and
+// reports the median ns per iteration.
+//
+// Each run builds its input again, call state.StartTiming() after the setup to
+// leave it out of the measurement. Inputs that are expensive to build and
+// not modified should be kept in function-local statics.
+struct BenchState {
+    uint64_t iters;
+    uint64_t start_usec;
+
+    explicit BenchState(uint64_t _iters) : iters(_iters), start_usec(timer::get_usec()) {}
+
+    void StartTiming() { start_usec = timer::get_usec(); }
+};
+
+typedef function<void(BenchState& state)> bench_func_t;
+
+struct BenchCase {
+    string name;
+    bench_func_t func;
+};
+
+class BenchRegistry {
+ public:
+    static vector<BenchCase>& Cases() {
+        static vector<BenchCase> cases;
+        return cases;
+    }
+
+    static int Register(const string& name, bench_func_t func) {
+        Cases().push_back(BenchCase{name, func});
+        return Cases().size();
+    }
+};
+
+#define BENCHMARK(func) \
+    static int func##_registered = BenchRegistry::Register(#func, func)
+
+// keep the compiler from optimizing away the value
+template <class T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// fixed seed so that inputs are the same across runs
+const uint64_t BENCH_SEED = 20190101;
+
+#endif  // BENCH_HPP_
@@ -0,0 +1,79 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "bench/bench.hpp"
+#include "expert/agg_kernel.hpp"
+#include "utils/tool.hpp"
+
+// values of one msg to MathExpert, e.g. values('age').sum()
+static const int NUM_VALUES = 65536;
+
+static vector<value_t> MakeValues(int type) {
+    mt19937_64 rng(BENCH_SEED);
+    vector<value_t> vals(NUM_VALUES);
+    for (auto& v : vals) {
+        if (type == 1) {
+            Tool::str2int(to_string(rng() % 100000), v);
+        } else {
+            Tool::str2double(to_string((rng() % 100000) / 100.0), v);
+        }
+    }
+    return vals;
+}
+
+// per value fold as MathExpert did before the kernels
+static void ScalarSumLoop(int type, BenchState& state) {
+    vector<value_t> vals = MakeValues(type);
+
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        value_t sum = vals[0];
+        for (int j = 1; j < NUM_VALUES; j++) {
+            value_t temp = sum;
+            sum.content.clear();
+            if (type == 1) {
+                Tool::str2int(to_string(Tool::value_t2int(temp) + Tool::value_t2int(vals[j])), sum);
+            } else {
+                Tool::str2double(to_string(Tool::value_t2double(temp) + Tool::value_t2double(vals[j])), sum);
+            }
+        }
+        DoNotOptimize(sum);
+    }
+}
+
+static void KernelLoop(int type, BenchState& state) {
+    vector<value_t> vals = MakeValues(type);
+    vector<int64_t> ints;
+    vector<double> doubles;
+
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        AggPartial agg;
+        AggKernel::Update(agg, vals, ints, doubles);
+        DoNotOptimize(agg);
+    }
+}
+
+static void BM_MathSumScalarInt(BenchState& state) {
+    ScalarSumLoop(1, state);
+}
+BENCHMARK(BM_MathSumScalarInt);
+
+static void BM_MathSumScalarDouble(BenchState& state) {
+    ScalarSumLoop(2, state);
+}
+BENCHMARK(BM_MathSumScalarDouble);
+
+static void BM_MathAggKernelInt(BenchState& state) {
+    KernelLoop(1, state);
+}
+BENCHMARK(BM_MathAggKernelInt);
+
+static void BM_MathAggKernelDouble(BenchState& state) {
+    KernelLoop(2, state);
+}
+BENCHMARK(BM_MathAggKernelDouble);
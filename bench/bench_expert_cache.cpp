@@ -0,0 +1,80 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "bench/bench.hpp"
+#include "expert/expert_cache.hpp"
+
+static const int NUM_IDS = 1 << 16;
+
+// vpid-like ids and string properties
+static void MakeInput(vector<uint64_t>& ids, vector<value_t>& values) {
+    mt19937_64 rng(BENCH_SEED);
+    ids.resize(NUM_IDS);
+    values.resize(NUM_IDS);
+    for (int i = 0; i < NUM_IDS; i++) {
+        ids[i] = rng() >> 12;
+        Tool::str2str("property_" + to_string(i), values[i]);
+    }
+}
+
+// handle of a cache of the bench, with budget large enough to hold the input
+static ExpertCache MakeCache() {
+    static PropertyCache cache(MiB2B(64));
+    return ExpertCache(EXPERT_T::PROPERTY, &cache);
+}
+
+static void BM_ExpertCacheInsert(BenchState& state) {
+    vector<uint64_t> ids;
+    vector<value_t> values;
+    MakeInput(ids, values);
+    ExpertCache cache = MakeCache();
+
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        cache.insert_properties(Element_T::VERTEX, ids[i % NUM_IDS], values[i % NUM_IDS]);
+    }
+}
+BENCHMARK(BM_ExpertCacheInsert);
+
+static void BM_ExpertCacheLookupHit(BenchState& state) {
+    vector<uint64_t> ids;
+    vector<value_t> values;
+    MakeInput(ids, values);
+    ExpertCache cache = MakeCache();
+    for (int i = 0; i < NUM_IDS; i++) {
+        cache.insert_properties(Element_T::VERTEX, ids[i], values[i]);
+    }
+
+    int cnt = 0;
+    value_t val;
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        cnt += cache.get_property_from_cache(Element_T::VERTEX, ids[i % NUM_IDS], val);
+    }
+    DoNotOptimize(cnt);
+}
+BENCHMARK(BM_ExpertCacheLookupHit);
+
+static void BM_ExpertCacheLookupMiss(BenchState& state) {
+    vector<uint64_t> ids;
+    vector<value_t> values;
+    MakeInput(ids, values);
+    ExpertCache cache = MakeCache();
+    for (int i = 0; i < NUM_IDS; i++) {
+        cache.insert_properties(Element_T::VERTEX, ids[i], values[i]);
+    }
+
+    int cnt = 0;
+    value_t val;
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        // ids are never inserted
+        cnt += cache.get_property_from_cache(Element_T::VERTEX, ids[i % NUM_IDS] + 1, val);
+    }
+    DoNotOptimize(cnt);
+}
+BENCHMARK(BM_ExpertCacheLookupMiss);
@@ -0,0 +1,94 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "bench/bench.hpp"
+#include "storage/kv_bucket.hpp"
+#include "utils/mymath.hpp"
+
+// Header region of VKVStore filled in the same way as VKVStore::insert_id,
+// probed as VKVStore_Local does after reading a bucket from the memory node
+static const int ASSOCIATIVITY = 8;
+static const uint64_t NUM_KEYS = 1 << 20;
+
+struct KVHeader {
+    vector<ikey_t> keys;
+    uint64_t num_buckets;
+    uint64_t last_ext;
+};
+
+static void Insert(KVHeader& h, uint64_t pid) {
+    uint64_t slot_id = (pid % h.num_buckets) * ASSOCIATIVITY;
+    while (true) {
+        for (int i = 0; i < ASSOCIATIVITY - 1; i++, slot_id++) {
+            if (h.keys[slot_id].pid == 0) {
+                h.keys[slot_id].pid = pid;
+                return;
+            }
+        }
+        if (!h.keys[slot_id].is_empty()) {
+            slot_id = h.keys[slot_id].pid * ASSOCIATIVITY;
+            continue;
+        }
+        // link a new indirect header
+        h.keys[slot_id].pid = h.num_buckets + (h.last_ext++);
+        if ((h.keys[slot_id].pid + 1) * ASSOCIATIVITY > h.keys.size()) {
+            h.keys.resize((h.keys[slot_id].pid + 1) * ASSOCIATIVITY);
+        }
+        slot_id = h.keys[slot_id].pid * ASSOCIATIVITY;
+    }
+}
+
+// load: used slots / main-header slots
+static void MakeHeader(double load, KVHeader& h, vector<uint64_t>& pids) {
+    mt19937_64 rng(BENCH_SEED);
+    h.num_buckets = mymath::hash_prime_u64(NUM_KEYS / load / (ASSOCIATIVITY - 1));
+    // indirect headers are appended on demand
+    h.keys.assign(h.num_buckets * ASSOCIATIVITY, ikey_t());
+    h.last_ext = 0;
+
+    pids.resize(NUM_KEYS);
+    for (auto& pid : pids) {
+        // vpid_t: vid | pid
+        pid = ((rng() % (1 << 26)) << 12) | (rng() % 64 + 1);
+        Insert(h, pid);
+    }
+}
+
+static void ProbeLoop(KVHeader& h, vector<uint64_t>& pids, BenchState& state) {
+    int cnt = 0;
+    ikey_t key;
+    for (uint64_t i = 0; i < state.iters; i++) {
+        uint64_t pid = pids[(i * 7919) % NUM_KEYS];
+        uint64_t bucket_id = pid % h.num_buckets;
+        while (!ProbeBucket<ASSOCIATIVITY>(&h.keys[bucket_id * ASSOCIATIVITY], pid, key, bucket_id)
+               && bucket_id != 0) {}
+        cnt += key.pid == pid;
+    }
+    DoNotOptimize(cnt);
+}
+
+static void BM_KVBucketProbeLoad50(BenchState& state) {
+    static KVHeader h;
+    static vector<uint64_t> pids;
+    if (pids.empty()) {
+        MakeHeader(0.5, h, pids);
+    }
+    state.StartTiming();
+    ProbeLoop(h, pids, state);
+}
+BENCHMARK(BM_KVBucketProbeLoad50);
+
+static void BM_KVBucketProbeLoad90(BenchState& state) {
+    static KVHeader h;
+    static vector<uint64_t> pids;
+    if (pids.empty()) {
+        MakeHeader(0.9, h, pids);
+    }
+    state.StartTiming();
+    ProbeLoop(h, pids, state);
+}
+BENCHMARK(BM_KVBucketProbeLoad90);
@@ -0,0 +1,154 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+
+#include "bench/bench.hpp"
+
+struct BenchResult {
+    string name;
+    uint64_t iters;
+    double ns_per_op;
+};
+
+static void print_usage(const char* prog) {
+    cout << "Usage: " << prog << " [options]" << endl;
+    cout << "    --filter <str>      only run benchmarks whose name contains <str>" << endl;
+    cout << "    --min_time <sec>    minimal time of one measurement, default 0.2" << endl;
+    cout << "    --repeat <n>        number of measurements, median is reported, default 5" << endl;
+    cout << "    --json <file>       write results into <file>" << endl;
+    cout << "    --baseline <file>   compare results with a json written by --json" << endl;
+}
+
+static double run_once(BenchCase& bench, uint64_t iters) {
+    BenchState state(iters);
+    bench.func(state);
+    return timer::get_usec() - state.start_usec;
+}
+
+static BenchResult run_bench(BenchCase& bench, double min_time, int repeat) {
+    // calibrate iterations until one run takes at least min_time
+    uint64_t iters = 1;
+    double min_usec = min_time * 1000000;
+    while (true) {
+        double usec = run_once(bench, iters);
+        if (usec >= min_usec) {
+            break;
+        }
+        // grow towards the target with some margin
+        double factor = usec <= 0 ? 100 : min(100.0, max(2.0, 1.4 * min_usec / usec));
+        iters *= factor;
+    }
+
+    vector<double> ns_per_op;
+    for (int i = 0; i < repeat; i++) {
+        ns_per_op.push_back(run_once(bench, iters) * 1000 / iters);
+    }
+    sort(ns_per_op.begin(), ns_per_op.end());
+
+    return BenchResult{bench.name, iters, ns_per_op[ns_per_op.size() / 2]};
+}
+
+static map<string, double> read_baseline(const string& file) {
+    map<string, double> baseline;
+    ifstream ifs(file);
+    if (!ifs.good()) {
+        cout << "baseline not found: " << file << endl;
+        return baseline;
+    }
+
+    // one result per line, as written by write_json
+    regex pattern("\"name\": \"([^\"]+)\".*\"ns_per_op\": ([0-9.eE+-]+)");
+    string line;
+    smatch match;
+    while (getline(ifs, line)) {
+        if (regex_search(line, match, pattern)) {
+            baseline[match[1]] = atof(match[2].str().c_str());
+        }
+    }
+    return baseline;
+}
+
+static void write_json(const string& file, vector<BenchResult>& results) {
+    ofstream ofs(file, ofstream::out);
+    ofs << "{" << endl;
+    ofs << "  \"benchmarks\": [" << endl;
+    for (int i = 0; i < results.size(); i++) {
+        ofs << "    {\"name\": \"" << results[i].name << "\""
+            << ", \"iterations\": " << results[i].iters
+            << ", \"ns_per_op\": " << fixed << setprecision(2) << results[i].ns_per_op << "}"
+            << (i == results.size() - 1 ? "" : ",") << endl;
+    }
+    ofs << "  ]" << endl;
+    ofs << "}" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    string filter, json_file, baseline_file;
+    double min_time = 0.2;
+    int repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min_time") == 0 && i + 1 < argc) {
+            min_time = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_file = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    map<string, double> baseline;
+    if (!baseline_file.empty()) {
+        baseline = read_baseline(baseline_file);
+    }
+
+    vector<BenchCase>& cases = BenchRegistry::Cases();
+    sort(cases.begin(), cases.end(), [](const BenchCase& l, const BenchCase& r) { return l.name < r.name; });
+
+    vector<BenchResult> results;
+    cout << left << setw(40) << "Benchmark" << right << setw(14) << "ns/op" << setw(14) << "iterations";
+    if (!baseline.empty()) {
+        cout << setw(14) << "baseline" << setw(10) << "diff";
+    }
+    cout << endl;
+
+    for (auto& bench : cases) {
+        if (bench.name.find(filter) == string::npos) {
+            continue;
+        }
+
+        BenchResult res = run_bench(bench, min_time, repeat);
+        results.push_back(res);
+
+        cout << left << setw(40) << res.name << right << fixed << setprecision(2)
+             << setw(14) << res.ns_per_op << setw(14) << res.iters;
+        auto itr = baseline.find(res.name);
+        if (itr != baseline.end() && itr->second > 0) {
+            double diff = (res.ns_per_op - itr->second) / itr->second * 100;
+            cout << setw(14) << itr->second << setw(9) << showpos << diff << "%" << noshowpos;
+        }
+        cout << endl;
+    }
+
+    if (!json_file.empty()) {
+        write_json(json_file, results);
+    }
+    return 0;
+}
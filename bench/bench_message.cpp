@@ -0,0 +1,88 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <string.h>
+#include <random>
+
+#include "bench/bench.hpp"
+#include "core/message.hpp"
+#include "utils/tool.hpp"
+
+// A msg in the middle of a traversal g.V().as('a').out().as('b').out().values()
+// 64 traversers share 8 'a' vertices, each carries 32 vertex ids
+static Message MakeMessage() {
+    mt19937_64 rng(BENCH_SEED);
+
+    Message msg;
+    msg.meta.qid = 1;
+    msg.meta.step = 3;
+    msg.meta.recver_nid = 1;
+    msg.meta.recver_tid = 2;
+    msg.meta.parent_nid = 0;
+    msg.meta.parent_tid = 0;
+    msg.meta.msg_type = MSG_T::SPAWN;
+    msg.meta.msg_credit = 5;
+
+    EXPERT_T types[] = {EXPERT_T::INIT, EXPERT_T::AS, EXPERT_T::TRAVERSAL, EXPERT_T::AS,
+                        EXPERT_T::TRAVERSAL, EXPERT_T::VALUES, EXPERT_T::END};
+    for (EXPERT_T type : types) {
+        Expert_Object expert(type);
+        expert.AddParam(1);
+        msg.meta.experts.push_back(expert);
+    }
+
+    vector<history_t> roots(8);
+    for (int i = 0; i < roots.size(); i++) {
+        value_t v;
+        Tool::str2int(to_string(rng() % 1000000), v);
+        roots[i].emplace_back(1, v);
+    }
+
+    for (int i = 0; i < 64; i++) {
+        history_t his = roots[i % roots.size()];
+        value_t v;
+        Tool::str2int(to_string(rng() % 1000000), v);
+        his.emplace_back(3, v);
+
+        vector<value_t> values(32);
+        for (auto& val : values) {
+            Tool::str2int(to_string(rng() % 1000000), val);
+        }
+        msg.data.emplace_back(move(his), move(values));
+    }
+    return msg;
+}
+
+static void BM_MessageSerialize(BenchState& state) {
+    Message msg = MakeMessage();
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        ibinstream m;
+        m << msg;
+        DoNotOptimize(m.size());
+    }
+}
+BENCHMARK(BM_MessageSerialize);
+
+// includes copying the bytes into the buffer owned by obinstream,
+// as done when fetching msgs from the recv ring buffer
+static void BM_MessageDeserialize(BenchState& state) {
+    Message msg = MakeMessage();
+    ibinstream in;
+    in << msg;
+
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        char* buf = new char[in.size()];
+        memcpy(buf, in.get_buf(), in.size());
+        obinstream um;
+        um.assign(buf, in.size(), 0);
+
+        Message out;
+        um >> out;
+        DoNotOptimize(out.data.size());
+    }
+}
+BENCHMARK(BM_MessageDeserialize);
@@ -0,0 +1,56 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "bench/bench.hpp"
+#include "storage/nbs_codec.hpp"
+
+// neighbor list of a high degree vertex, vids are clustered as after loading
+static const int NUM_NBS = 4096;
+static const int NUM_LABELS = 4;
+
+static vector<char> MakeList(bool compressed) {
+    mt19937_64 rng(BENCH_SEED);
+    vector<Nbs_pair> nbs(NUM_NBS);
+    for (int i = 0; i < NUM_NBS; i++) {
+        nbs[i].vid = rng() % (NUM_NBS * 16);
+        nbs[i].label = rng() % NUM_LABELS;
+    }
+
+    vector<char> list;
+    if (compressed) {
+        NbsCodec::Encode(nbs, list);
+    } else {
+        list.resize(sizeof(uint32_t) + NUM_NBS * sizeof(Nbs_pair));
+        uint32_t num = NUM_NBS;
+        memcpy(&list[0], &num, sizeof(uint32_t));
+        memcpy(&list[sizeof(uint32_t)], &nbs[0], NUM_NBS * sizeof(Nbs_pair));
+    }
+    return list;
+}
+
+static void DecodeLoop(bool compressed, BenchState& state) {
+    vector<char> list = MakeList(compressed);
+    vector<Nbs_pair> nbs;
+    nbs.reserve(NUM_NBS);
+
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        nbs.clear();
+        NbsCodec::Decode(&list[0], nbs);
+        DoNotOptimize(nbs[NUM_NBS - 1]);
+    }
+}
+
+static void BM_NbsDecodeRaw(BenchState& state) {
+    DecodeLoop(false, state);
+}
+BENCHMARK(BM_NbsDecodeRaw);
+
+static void BM_NbsDecodeCompressed(BenchState& state) {
+    DecodeLoop(true, state);
+}
+BENCHMARK(BM_NbsDecodeCompressed);
@@ -0,0 +1,77 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "bench/bench.hpp"
+#include "base/predicate.hpp"
+#include "utils/tool.hpp"
+
+static const int NUM_VALUES = 4096;
+
+// values of the same type as compared by has() and where() experts
+static vector<value_t> MakeValues(int type) {
+    mt19937_64 rng(BENCH_SEED);
+    vector<value_t> values(NUM_VALUES);
+    for (auto& v : values) {
+        switch (type) {
+        case 1:
+            Tool::str2int(to_string(rng() % 100000), v);
+            break;
+        case 2:
+            Tool::str2double(to_string((rng() % 100000) / 100.0), v);
+            break;
+        default:
+            Tool::str2str("value_" + to_string(rng() % 100000), v);
+        }
+    }
+    return values;
+}
+
+static void CompareLoop(vector<value_t>& values, BenchState& state) {
+    int cnt = 0;
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        const value_t& l = values[i % NUM_VALUES];
+        const value_t& r = values[(i * 7 + 1) % NUM_VALUES];
+        cnt += (l < r) + (l == r);
+    }
+    DoNotOptimize(cnt);
+}
+
+static void BM_ValueCompareInt(BenchState& state) {
+    vector<value_t> values = MakeValues(1);
+    CompareLoop(values, state);
+}
+BENCHMARK(BM_ValueCompareInt);
+
+static void BM_ValueCompareDouble(BenchState& state) {
+    vector<value_t> values = MakeValues(2);
+    CompareLoop(values, state);
+}
+BENCHMARK(BM_ValueCompareDouble);
+
+static void BM_ValueCompareString(BenchState& state) {
+    vector<value_t> values = MakeValues(4);
+    CompareLoop(values, state);
+}
+BENCHMARK(BM_ValueCompareString);
+
+// has("key", inside(lower, upper))
+static void BM_EvaluateInside(BenchState& state) {
+    vector<value_t> values = MakeValues(1);
+    value_t lower, upper;
+    Tool::str2int("25000", lower);
+    Tool::str2int("75000", upper);
+    PredicateValue pv(Predicate_T::INSIDE, vector<value_t>{lower, upper});
+
+    int cnt = 0;
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        cnt += Evaluate(pv, &values[i % NUM_VALUES]);
+    }
+    DoNotOptimize(cnt);
+}
+BENCHMARK(BM_EvaluateInside);
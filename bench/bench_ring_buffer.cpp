@@ -0,0 +1,60 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <string.h>
+
+#include "bench/bench.hpp"
+#include "core/ring_buffer.hpp"
+
+// recv ring buffer of RdmaMailbox, the RDMA write is replaced by memcpy
+static const uint64_t RBF_SZ = MiB2B(1);
+
+// copy a frame into the ring at tail, split into two writes at the end of ring
+static void WriteFrame(char* rbf, uint64_t tail, const char* frame, uint64_t frame_sz) {
+    uint64_t off = tail % RBF_SZ;
+    if (off + frame_sz <= RBF_SZ) {
+        memcpy(rbf + off, frame, frame_sz);
+    } else {
+        uint64_t sz = RBF_SZ - off;
+        memcpy(rbf + off, frame, sz);
+        memcpy(rbf, frame + sz, frame_sz - sz);
+    }
+}
+
+static void RingLoop(uint64_t data_sz, BenchState& state) {
+    vector<char> rbf(RBF_SZ, 0);
+    vector<char> data(data_sz, 'x');
+    vector<char> frame(RingFrameSize(data_sz));
+
+    uint64_t head = 0, tail = 0;
+    state.StartTiming();
+    for (uint64_t i = 0; i < state.iters; i++) {
+        RingEncode(&frame[0], &data[0], data_sz);
+        WriteFrame(&rbf[0], tail, &frame[0], frame.size());
+        tail += frame.size();
+
+        if (RingPoll(&rbf[0], RBF_SZ, head)) {
+            obinstream um;
+            head = RingDecode(&rbf[0], RBF_SZ, head, um);
+        }
+    }
+    DoNotOptimize(head);
+}
+
+static void BM_RingEncodeDecode256B(BenchState& state) {
+    RingLoop(256, state);
+}
+BENCHMARK(BM_RingEncodeDecode256B);
+
+static void BM_RingEncodeDecode4KB(BenchState& state) {
+    RingLoop(KiB2B(4), state);
+}
+BENCHMARK(BM_RingEncodeDecode4KB);
+
+// frames are not aligned to the ring size, so some of them wrap around
+static void BM_RingEncodeDecode60KB(BenchState& state) {
+    RingLoop(KiB2B(60) + 8, state);
+}
+BENCHMARK(BM_RingEncodeDecode60KB);
@@ -16,7 +16,16 @@ class AbstractMailbox {
 
     virtual void Init(vector<Node> & nodes, vector<Node> & memory_nodes) = 0;
     virtual int Send(int tid, const Message & msg) = 0;
+    // msg is left unspecified, mailboxes that keep msgs take it without copy
+    virtual int Send(int tid, Message && msg) {
+        return Send(tid, static_cast<const Message &>(msg));
+    }
     virtual bool TryRecv(int tid, Message & msg) = 0;
     virtual void Recv(int tid, Message & msg) = 0;
     virtual void Sweep(int tid) = 0;
+    // msgs of this node not taken by receivers yet, queued for local threads
+    // or held while remote recv buffers are full, 0 if not tracked
+    virtual uint64_t Backlog() {
+        return 0;
+    }
 };
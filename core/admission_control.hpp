@@ -0,0 +1,100 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "base/type.hpp"
+#include "core/logical_plan.hpp"
+
+// Queue of parsed plans waiting to be started by the worker
+//
+// At most max_inflight queries of the worker run at the same time, the others
+// wait here, so that a burst of queries does not flood the experts with msgs
+// and memory. High priority plans are started first, and low priority ones
+// may take at most half of the slots so that short queries always find one.
+//
+// A query holds its slot until its last result is popped from the collector.
+class AdmissionQueue {
+ public:
+    // max_inflight = 0 for no limit
+    explicit AdmissionQueue(int max_inflight) : max_inflight_(max_inflight), num_low_(0) {
+        max_low_ = max(1, max_inflight / 2);
+    }
+
+    void Push(LogicPlan && plan) {
+        unique_lock<mutex> lk(mu_);
+        if (plan.priority == PRIORITY_LOW) {
+            low_.push_back(move(plan));
+        } else {
+            high_.push_back(move(plan));
+        }
+        cv_.notify_all();
+    }
+
+    // wait until a plan can be started
+    void WaitAndPop(LogicPlan & plan) {
+        unique_lock<mutex> lk(mu_);
+        cv_.wait(lk, [this] { return CanStartHigh() || CanStartLow(); });
+
+        deque<LogicPlan> & q = CanStartHigh() ? high_ : low_;
+        plan = move(q.front());
+        q.pop_front();
+
+        if (max_inflight_ > 0) {
+            admitted_[plan.qid.value()] = plan.priority;
+            if (plan.priority == PRIORITY_LOW) {
+                num_low_++;
+            }
+        }
+    }
+
+    // query qid ends, no-op if it was not admitted from here
+    void Release(uint64_t qid) {
+        unique_lock<mutex> lk(mu_);
+        auto itr = admitted_.find(qid);
+        if (itr == admitted_.end()) {
+            return;
+        }
+        if (itr->second == PRIORITY_LOW) {
+            num_low_--;
+        }
+        admitted_.erase(itr);
+        cv_.notify_all();
+    }
+
+    int NumWaiting() {
+        unique_lock<mutex> lk(mu_);
+        return high_.size() + low_.size();
+    }
+
+ private:
+    int max_inflight_;
+    int max_low_;
+    int num_low_;
+
+    mutex mu_;
+    condition_variable cv_;
+    deque<LogicPlan> high_;
+    deque<LogicPlan> low_;
+    // qid -> priority of running queries
+    unordered_map<uint64_t, int> admitted_;
+
+    bool HasSlot() {
+        return max_inflight_ <= 0 || admitted_.size() < max_inflight_;
+    }
+
+    bool CanStartHigh() {
+        return !high_.empty() && HasSlot();
+    }
+
+    bool CanStartLow() {
+        return !low_.empty() && HasSlot() && (max_inflight_ <= 0 || num_low_ < max_low_);
+    }
+};
@@ -8,15 +8,23 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include <memory>
 
 #include "glog/logging.h"
+#include "base/core_affinity.hpp"
 #include "utils/config.hpp"
+#include "utils/mem_util.hpp"
 #include "utils/unit.hpp"
 
 class Buffer {
  public:
-    Buffer(Node & node) : node_(node) {
+    // with core_affinity, buffers of each thread are placed on its numa node
+    Buffer(Node & node, CoreAffinity * core_affinity = NULL) : node_(node) {
         config_ = Config::GetInstance();
-        buffer_ = new char[config_->local_buffer_sz];
-        memset(buffer_, 0, config_->local_buffer_sz);
+        buffer_ = MemUtil::Alloc(config_->local_buffer_sz, config_->global_hugepage_sz_mb, page_sz_);
+        CHECK(buffer_ != NULL) << "Failed to allocate local buffer";
+        if (config_->global_enable_numa_placement && core_affinity != NULL) {
+            PlaceOnNuma(core_affinity);
+        }
+        // mapped memory is zeros already, only commit the pages
+        MemUtil::Prefault(buffer_, config_->local_buffer_sz, page_sz_, config_->global_num_threads);
         config_->send_buf = buffer_ + config_->send_buffer_offset;
         config_->recv_buf = buffer_ + config_->recv_buffer_offset;
         config_->local_head_buf = buffer_ + config_->local_head_buffer_offset;
@@ -25,7 +33,7 @@ class Buffer {
 
     ~Buffer() {
         std::cout << "Delete buffer" << std::endl;
-        delete[] buffer_;
+        MemUtil::Free(buffer_, config_->local_buffer_sz, page_sz_);
     }
 
     // Get index of (nid, tid) at reference node
@@ -65,6 +73,10 @@ class Buffer {
         return config_->kvstore_offset + GiB2B(config_->global_vertex_property_kv_sz_gb);
     }
 
+    inline uint64_t GetAllocHeaderOffset() {
+        return config_->alloc_header_offset;
+    }
+
     inline char* GetSendBuf(int index) {
         assert(config_->global_use_rdma);
         CHECK_LE(index, config_->global_num_threads);
@@ -82,6 +94,17 @@ class Buffer {
         return config_->send_buffer_offset + index * MiB2B(config_->global_per_send_buffer_sz_mb);
     }
 
+    // records of next hop vertices are read into it, see MetaData::PostPrefetch
+    inline char* GetPrefetchBuf(int tid) {
+        assert(config_->global_use_rdma && config_->global_enable_prefetch);
+        CHECK_LT(tid, config_->global_num_threads);
+        return buffer_ + config_->prefetch_buffer_offset + tid * Config::per_prefetch_buffer_sz;
+    }
+
+    inline uint64_t GetPrefetchBufSize() {
+        return Config::per_prefetch_buffer_sz;
+    }
+
     inline char* GetRecvBuf(int tid, int nid) {
         assert(config_->global_use_rdma);
         CHECK_LT(tid, config_->global_num_threads);
@@ -140,8 +163,37 @@ class Buffer {
     }
 
  private:
-    // layout: send_buffer | recv_buffer | local_head_buffer | remote_head_buffer
-    char* buffer_; 
+    // Put the send buffer and recv rings of each thread on the numa node of
+    // its core, so that serialization and polling stay inside the socket.
+    // Layout and offsets are unchanged, buffers smaller than a page stay as they are.
+    void PlaceOnNuma(CoreAffinity * core_affinity) {
+        if (!config_->global_use_rdma) {
+            return;
+        }
+
+        int num_placed = 0;
+        for (int tid = 0; tid < config_->global_num_threads; tid++) {
+            int numa_node = core_affinity->GetNumaNodeOfThread(tid);
+            if (numa_node < 0) {
+                continue;
+            }
+
+            MemUtil::Prefer(buffer_ + GetSendBufOffset(tid), GetSendBufSize(), page_sz_, numa_node);
+            for (int nid = 0; nid < config_->global_num_workers; nid++) {
+                if (nid == node_.get_local_rank()) {
+                    continue;
+                }
+                // ring written by nid and polled by local thread tid
+                MemUtil::Prefer(buffer_ + config_->recv_buffer_offset + GetIndex(tid, nid, node_.get_local_rank()) * GetRecvBufSize(), GetRecvBufSize(), page_sz_, numa_node);
+            }
+            num_placed++;
+        }
+        std::cout << "Worker" << node_.get_local_rank() << ": buffers of " << num_placed << " threads placed on their numa nodes" << std::endl;
+    }
+
+    // layout: send_buffer | recv_buffer | local_head_buffer | remote_head_buffer | prefetch_buffer
+    char* buffer_;
+    uint64_t page_sz_;
     Config* config_;
     Node & node_;
 };
@@ -27,6 +27,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "expert/key_expert.hpp"
 #include "expert/label_expert.hpp"
 #include "expert/labelled_branch_expert.hpp"
+#include "expert/mutate_expert.hpp"
 #include "expert/properties_expert.hpp"
 #include "expert/select_expert.hpp"
 #include "expert/traversal_expert.hpp"
@@ -38,6 +39,8 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "base/type.hpp"
 #include "base/core_affinity.hpp"
 #include "core/abstract_mailbox.hpp"
+#include "core/fair_queue.hpp"
+#include "core/pipeline_mailbox.hpp"
 #include "core/result_collector.hpp"
 #include "core/index_store.hpp"
 #include "storage/metadata.hpp"
@@ -56,37 +59,48 @@ class ExpertAdapter {
         config_ = Config::GetInstance();
         num_thread_ = config_->global_num_threads;
         times_.resize(num_thread_, 0);
+        fair_queues_.resize(num_thread_);
+        adapt_division_ = config_->global_enable_expert_division && config_->global_division_adapt_ms > 0;
+        last_adapt_time_ = timer::get_usec();
     }
 
     void Init() {
+        // experts send msgs via pipeline mailbox if enabled
+        AbstractMailbox * mailbox = mailbox_;
+        if (config_->global_enable_pipeline) {
+            pipeline_mailbox_ = unique_ptr<PipelineMailbox>(new PipelineMailbox(node_, mailbox_, core_affinity_, num_thread_));
+            mailbox = pipeline_mailbox_.get();
+        }
+
         int id = 0;
-        experts_[EXPERT_T::AGGREGATE] = unique_ptr<AbstractExpert>(new AggregateExpert(id ++, metadata_, node_.get_local_size(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::AS] = unique_ptr<AbstractExpert>(new AsExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::BRANCH] = unique_ptr<AbstractExpert>(new BranchExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::BRANCHFILTER] = unique_ptr<AbstractExpert>(new BranchFilterExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_, &id_allocator_));
-        experts_[EXPERT_T::CAP] = unique_ptr<AbstractExpert>(new CapExpert(id ++, metadata_ , num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::CONFIG] = unique_ptr<AbstractExpert>(new ConfigExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::COUNT] = unique_ptr<AbstractExpert>(new CountExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::DEDUP] = unique_ptr<AbstractExpert>(new DedupExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::END] = unique_ptr<AbstractExpert>(new EndExpert(id ++, metadata_, node_.get_local_size(), rc_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::GROUP] = unique_ptr<AbstractExpert>(new GroupExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::HAS] = unique_ptr<AbstractExpert>(new HasExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::HASLABEL] = unique_ptr<AbstractExpert>(new HasLabelExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::INIT] = unique_ptr<AbstractExpert>(new InitExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_, index_store_, node_.get_local_size()));
-        experts_[EXPERT_T::INDEX] = unique_ptr<AbstractExpert>(new IndexExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_, index_store_));
-        experts_[EXPERT_T::IS] = unique_ptr<AbstractExpert>(new IsExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::KEY] = unique_ptr<AbstractExpert>(new KeyExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::LABEL] = unique_ptr<AbstractExpert>(new LabelExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::MATH] = unique_ptr<AbstractExpert>(new MathExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::ORDER] = unique_ptr<AbstractExpert>(new OrderExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::PROPERTY] = unique_ptr<AbstractExpert>(new PropertiesExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::RANGE] = unique_ptr<AbstractExpert>(new RangeExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::COIN] = unique_ptr<AbstractExpert>(new CoinExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::REPEAT] = unique_ptr<AbstractExpert>(new RepeatExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::SELECT] = unique_ptr<AbstractExpert>(new SelectExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::TRAVERSAL] = unique_ptr<AbstractExpert>(new TraversalExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::VALUES] = unique_ptr<AbstractExpert>(new ValuesExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox_, core_affinity_));
-        experts_[EXPERT_T::WHERE] = unique_ptr<AbstractExpert>(new WhereExpert(id ++, metadata_, num_thread_, mailbox_, core_affinity_));
+        experts_[EXPERT_T::AGGREGATE] = unique_ptr<AbstractExpert>(new AggregateExpert(id ++, metadata_, node_.get_local_size(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::AS] = unique_ptr<AbstractExpert>(new AsExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::BRANCH] = unique_ptr<AbstractExpert>(new BranchExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::BRANCHFILTER] = unique_ptr<AbstractExpert>(new BranchFilterExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_, &id_allocator_));
+        experts_[EXPERT_T::CAP] = unique_ptr<AbstractExpert>(new CapExpert(id ++, metadata_ , num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::CONFIG] = unique_ptr<AbstractExpert>(new ConfigExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::COUNT] = unique_ptr<AbstractExpert>(new CountExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::DEDUP] = unique_ptr<AbstractExpert>(new DedupExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::END] = unique_ptr<AbstractExpert>(new EndExpert(id ++, metadata_, node_.get_local_size(), rc_, mailbox, core_affinity_));
+        experts_[EXPERT_T::GROUP] = unique_ptr<AbstractExpert>(new GroupExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::HAS] = unique_ptr<AbstractExpert>(new HasExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::HASLABEL] = unique_ptr<AbstractExpert>(new HasLabelExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::INIT] = unique_ptr<AbstractExpert>(new InitExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_, index_store_, node_.get_local_size()));
+        experts_[EXPERT_T::INDEX] = unique_ptr<AbstractExpert>(new IndexExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_, index_store_));
+        experts_[EXPERT_T::IS] = unique_ptr<AbstractExpert>(new IsExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::KEY] = unique_ptr<AbstractExpert>(new KeyExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::LABEL] = unique_ptr<AbstractExpert>(new LabelExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::MATH] = unique_ptr<AbstractExpert>(new MathExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::MUTATE] = unique_ptr<AbstractExpert>(new MutateExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::ORDER] = unique_ptr<AbstractExpert>(new OrderExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::PROPERTY] = unique_ptr<AbstractExpert>(new PropertiesExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::RANGE] = unique_ptr<AbstractExpert>(new RangeExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::COIN] = unique_ptr<AbstractExpert>(new CoinExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::REPEAT] = unique_ptr<AbstractExpert>(new RepeatExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::SELECT] = unique_ptr<AbstractExpert>(new SelectExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::TRAVERSAL] = unique_ptr<AbstractExpert>(new TraversalExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::VALUES] = unique_ptr<AbstractExpert>(new ValuesExpert(id ++, metadata_, node_.get_local_rank(), num_thread_, mailbox, core_affinity_));
+        experts_[EXPERT_T::WHERE] = unique_ptr<AbstractExpert>(new WhereExpert(id ++, metadata_, num_thread_, mailbox, core_affinity_));
         // TODO(future) add more
 
         timer::init_timers((experts_.size() + timer_offset) * num_thread_);
@@ -147,6 +161,8 @@ class ExpertAdapter {
             return;
         }
 
+        SplitMorsels(tid, ac->second, msg);
+
         int current_step;
         do {
             current_step = msg.meta.step;
@@ -157,7 +173,14 @@ class ExpertAdapter {
                 metadata_->InitCounter();
             #endif
 
+            if (pipeline_mailbox_) {
+                pipeline_mailbox_->SetStep(tid, current_step);
+            }
+            uint64_t service_start = adapt_division_ ? timer::get_usec() : 0;
             experts_[next_expert]->process(ac->second, msg);
+            if (adapt_division_) {
+                core_affinity_->RecordServiceTime(next_expert, timer::get_usec() - service_start);
+            }
 
             #ifdef TEST_WITH_COUNT
                 uint64_t end_t = timer::get_usec();
@@ -176,6 +199,108 @@ class ExpertAdapter {
         } while (current_step != msg.meta.step);    // process next expert directly if step is modified
     }
 
+    // split a large msg into morsels, the first is kept and the others are sent
+    // to other threads of the same expert, idle threads steal them
+    void SplitMorsels(int tid, const vector<Expert_Object>& experts, Message & msg) {
+        size_t morsel_size = KiB2B((size_t)config_->global_morsel_sz_kb);
+        if (morsel_size == 0 || msg.meta.msg_type != MSG_T::SPAWN || msg.data_size < 2 * morsel_size) {
+            return;
+        }
+
+        // only experts processing each value on its own
+        const Expert_Object& expert = experts[msg.meta.step];
+        if (expert.IsBarrier()) {
+            return;
+        }
+        switch (expert.expert_type) {
+            case EXPERT_T::INIT:
+            case EXPERT_T::BRANCH:
+            case EXPERT_T::BRANCHFILTER:
+            case EXPERT_T::REPEAT:
+            case EXPERT_T::CONFIG:
+            case EXPERT_T::INDEX:
+            case EXPERT_T::MUTATE:
+                return;
+            default:
+                break;
+        }
+
+        int num = min((size_t)core_affinity_->GetNumThreadsForExpert(expert.expert_type), msg.data_size / morsel_size);
+        if (num <= 1) {
+            return;
+        }
+
+        vector<Message> morsels;
+        msg.SplitData(num, morsels);
+        for (int i = 1; i < morsels.size(); i++) {
+            morsels[i].meta.recver_tid = core_affinity_->GetThreadIdForExpert(expert.expert_type);
+            mailbox_->Send(tid, move(morsels[i]));
+        }
+        msg = move(morsels[0]);
+    }
+
+    // execute msg, then the chain of local msgs kept by pipeline mailbox in current thread
+    void ExecuteChain(int tid, Message & msg) {
+        if (!pipeline_mailbox_) {
+            execute(tid, msg);
+            return;
+        }
+
+        pipeline_mailbox_->Open(tid);
+        execute(tid, msg);
+
+        Message next_msg;
+        while (pipeline_mailbox_->Pop(tid, next_msg)) {
+            // msgs of other queries waiting in this thread go first, as they
+            // would if the msg was queued
+            if (config_->global_enable_fair_scheduling && fair_queues_[tid].Size() > 0) {
+                fair_queues_[tid].Push(move(next_msg));
+                break;
+            }
+            execute(tid, next_msg);
+        }
+        pipeline_mailbox_->Close(tid);
+    }
+
+    // move threads among divisions by their load, in thread 0 periodically
+    void AdaptDivision() {
+        uint64_t now = timer::get_usec();
+        if (now - last_adapt_time_ < config_->global_division_adapt_ms * 1000ul) {
+            return;
+        }
+        last_adapt_time_ = now;
+
+        if (core_affinity_->Rebalance()) {
+            cout << "Worker" << node_.get_local_rank() << ": " << core_affinity_->DivisionString();
+        }
+    }
+
+    // get the next msg of thread tid with queries interleaved
+    bool FairRecv(int tid, Message & msg) {
+        FairQueue & queue = fair_queues_[tid];
+        Message recv_msg;
+        // look ahead a window of msgs, leave the rest in mailbox
+        while (queue.Size() < FAIR_WINDOW && mailbox_->TryRecv(tid, recv_msg)) {
+            MSG_T type = recv_msg.meta.msg_type;
+            // control msgs are cheap and unblock others, run them at once
+            if (type == MSG_T::INIT || type == MSG_T::FEED || type == MSG_T::EXIT) {
+                msg = move(recv_msg);
+                return true;
+            }
+            queue.Push(move(recv_msg));
+        }
+        return queue.Pop(msg);
+    }
+
+    // take a msg of thread victim, msgs FairRecv already pulled into its
+    // queue can be stolen as well as the ones left in mailbox
+    bool StealRecv(int victim, Message & msg) {
+        if (mailbox_->TryRecv(victim, msg)) {
+            return true;
+        }
+        return config_->global_enable_fair_scheduling && fair_queues_[victim].Pop(msg);
+    }
+
     void ThreadExecutor(int tid) {
         TidMapper::GetInstance()->Register(tid);
         // bind thread to core
@@ -187,16 +312,20 @@ class ExpertAdapter {
         core_affinity_->GetStealList(tid, steal_list);
 
         while (true) {
+            if (tid == 0 && adapt_division_) {
+                AdaptDivision();
+            }
+
             // timer::start_timer(tid + 2 * num_thread_);
             mailbox_->Sweep(tid);
 
             Message recv_msg;
             // timer::start_timer(tid + 3 * num_thread_);
-            bool success = mailbox_->TryRecv(tid, recv_msg);
+            bool success = config_->global_enable_fair_scheduling ? FairRecv(tid, recv_msg) : mailbox_->TryRecv(tid, recv_msg);
             times_[tid] = timer::get_usec();
             if (success) {
                 // timer::stop_timer(tid + 3 * num_thread_);
-                execute(tid, recv_msg);
+                ExecuteChain(tid, recv_msg);
                 times_[tid] = timer::get_usec();
                 // timer::stop_timer(tid + 2 * num_thread_);
             } else {
@@ -204,10 +333,10 @@ class ExpertAdapter {
                     continue;
 
                 if (steal_list.size() == 0) {  // num_thread_ < 6
-                    success = mailbox_->TryRecv((tid + 1) % num_thread_, recv_msg);
+                    success = StealRecv((tid + 1) % num_thread_, recv_msg);
                     if (success) {
                         // timer::stop_timer(tid + 3 * num_thread_);
-                        execute(tid, recv_msg);
+                        ExecuteChain(tid, recv_msg);
                         // timer::stop_timer(tid + 2 * num_thread_);
                     }
                 } else {  // num_thread_ >= 6
@@ -217,10 +346,10 @@ class ExpertAdapter {
 
                         // timer::start_timer(tid + 2 * num_thread_);
                         // timer::start_timer(tid + 3 * num_thread_);
-                        success = mailbox_->TryRecv(*itr, recv_msg);
+                        success = StealRecv(*itr, recv_msg);
                         if (success) {
                             // timer::stop_timer(tid + 3 * num_thread_);
-                            execute(tid, recv_msg);
+                            ExecuteChain(tid, recv_msg);
                             // timer::stop_timer(tid + 2 * num_thread_);
                             break;
                         }
@@ -241,6 +370,9 @@ class ExpertAdapter {
     msg_id_alloc id_allocator_;
     Node node_;
 
+    // Keep local msgs in thread for sequential experts
+    unique_ptr<PipelineMailbox> pipeline_mailbox_;
+
     // Experts pool <expert_type, [experts]>
     map<EXPERT_T, unique_ptr<AbstractExpert>> experts_;
 
@@ -252,6 +384,13 @@ class ExpertAdapter {
     // Thread pool
     vector<thread> thread_pool_;
 
+    // msgs received by each thread and not run yet, when fair scheduling
+    vector<FairQueue> fair_queues_;
+
+    // adapt thread division to load of experts
+    bool adapt_division_;
+    uint64_t last_adapt_time_;
+
     // clocks
     vector<uint64_t> times_;
     int num_thread_;
@@ -259,6 +398,7 @@ class ExpertAdapter {
     // 5 more timers for total, recv , send, serialization, create msg
     const static int timer_offset = 5;
     const static uint64_t STEALTIMEOUT = 1000;
+    const static size_t FAIR_WINDOW = 32;
 };
 
 
@@ -0,0 +1,113 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <deque>
+#include <unordered_map>
+
+#include "base/type.hpp"
+#include "core/message.hpp"
+
+// Per-thread queue of msgs interleaving queries by deficit round-robin
+//
+// Msgs are kept FIFO per qid. Queries take turns, in each turn a query gets a
+// quantum of bytes weighted by its priority and runs msgs while the quantum
+// covers their data size, so a query with many large msgs cannot hold the
+// thread while short queries wait behind it.
+//
+// Filled by its own thread, idle threads may pop from it when stealing, so
+// every access takes the spinlock.
+class FairQueue {
+ public:
+    FairQueue() : size_(0) {
+        pthread_spin_init(&lock_, 0);
+    }
+
+    ~FairQueue() {
+        pthread_spin_destroy(&lock_);
+    }
+
+    void Push(Message && msg) {
+        pthread_spin_lock(&lock_);
+        uint64_t qid = msg.meta.qid;
+        auto itr = flows_.find(qid);
+        if (itr == flows_.end()) {
+            itr = flows_.emplace(qid, Flow()).first;
+            itr->second.deficit = Quantum(msg.meta.priority);
+            active_.push_back(qid);
+        }
+        itr->second.msgs.push_back(move(msg));
+        size_++;
+        pthread_spin_unlock(&lock_);
+    }
+
+    bool Pop(Message & msg) {
+        pthread_spin_lock(&lock_);
+        bool success = PopLocked(msg);
+        pthread_spin_unlock(&lock_);
+        return success;
+    }
+
+    size_t Size() {
+        pthread_spin_lock(&lock_);
+        size_t sz = size_;
+        pthread_spin_unlock(&lock_);
+        return sz;
+    }
+
+ private:
+    // bytes of data per turn
+    static const int64_t QUANTUM = 64 * 1024;
+    // high priority queries get more turns
+    static const int64_t HIGH_WEIGHT = 4;
+
+    struct Flow {
+        deque<Message> msgs;
+        int64_t deficit;
+    };
+
+    static int64_t Quantum(int priority) {
+        return priority == PRIORITY_HIGH ? HIGH_WEIGHT * QUANTUM : QUANTUM;
+    }
+
+    bool PopLocked(Message & msg) {
+        while (!active_.empty()) {
+            uint64_t qid = active_.front();
+            Flow & flow = flows_[qid];
+            Message & head = flow.msgs.front();
+
+            // single query needs no turns
+            int64_t cost = head.data_size;
+            if (flow.deficit >= cost || active_.size() == 1) {
+                flow.deficit -= cost;
+                msg = move(head);
+                flow.msgs.pop_front();
+                size_--;
+
+                if (flow.msgs.empty()) {
+                    // idle queries do not keep their quantum
+                    flows_.erase(qid);
+                    active_.pop_front();
+                }
+                return true;
+            }
+
+            // turn goes to the next query
+            active_.pop_front();
+            active_.push_back(qid);
+            Flow & next = flows_[active_.front()];
+            next.deficit += Quantum(next.msgs.front().meta.priority);
+        }
+        return false;
+    }
+
+    pthread_spinlock_t lock_;
+    unordered_map<uint64_t, Flow> flows_;
+    // queries with msgs, in round-robin order
+    deque<uint64_t> active_;
+    size_t size_;
+};
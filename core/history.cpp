@@ -0,0 +1,159 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+         Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <unordered_map>
+
+#include "core/history.hpp"
+#include "base/predicate.hpp"
+
+HistoryNode::HistoryNode(int key, value_t&& value, const shared_ptr<const HistoryNode>& _parent) : parent(_parent) {
+    kv.first = key;
+    kv.second = move(value);
+    depth = parent ? parent->depth + 1 : 1;
+
+    uint64_t hash_tmp = parent ? parent->hash : mymath::hash_u64(0);
+    hash = mymath::hash_u64(hash_tmp + ValueTHash()(kv.second) + key);
+}
+
+void history_t::emplace_back(int key, value_t value) {
+    head_ = make_shared<const HistoryNode>(key, move(value), head_);
+}
+
+void history_t::push_back(const pair<int, value_t>& kv) {
+    value_t v = kv.second;
+    emplace_back(kv.first, move(v));
+}
+
+void history_t::EraseAfter(const_iterator itr) {
+    if (itr.slot_ == NULL) {
+        head_.reset();
+    } else {
+        // copy before assigning, slot may be owned by current head
+        shared_ptr<const HistoryNode> head = *itr.slot_;
+        head_ = move(head);
+    }
+}
+
+bool operator==(const history_t& l, const history_t& r) {
+    const HistoryNode* ln = l.Head();
+    const HistoryNode* rn = r.Head();
+
+    // shared path or different signature
+    if (ln == rn) {
+        return true;
+    }
+    if (l.size() != r.size() || l.Hash() != r.Hash()) {
+        return false;
+    }
+
+    // history keys are in the same order
+    // so simply match kv pair one by one
+    while (ln != rn) {
+        if (ln->kv.first != rn->kv.first || ln->kv.second != rn->kv.second) {
+            return false;
+        }
+        ln = ln->parent.get();
+        rn = rn->parent.get();
+    }
+    return true;
+}
+
+bool operator!=(const history_t& l, const history_t& r) {
+    return !(l == r);
+}
+
+ibinstream& operator<<(ibinstream& m, const history_t& his) {
+    vector<const HistoryNode*> nodes;
+    for (const HistoryNode* node = his.Head(); node != NULL; node = node->parent.get()) {
+        nodes.push_back(node);
+    }
+
+    m << nodes.size();
+    for (auto itr = nodes.rbegin(); itr != nodes.rend(); itr++) {
+        m << (*itr)->kv;
+    }
+    return m;
+}
+
+obinstream& operator>>(obinstream& m, history_t& his) {
+    size_t size;
+    m >> size;
+
+    his = history_t();
+    for (size_t i = 0; i < size; i++) {
+        int key;
+        value_t v;
+        m >> key >> v;
+        his.emplace_back(key, move(v));
+    }
+    return m;
+}
+
+ibinstream& operator<<(ibinstream& m, const vector<pair<history_t, vector<value_t>>>& data) {
+    // index of node in table, parents are always indexed before children
+    unordered_map<const HistoryNode*, int> node_index;
+    vector<const HistoryNode*> table;
+    vector<int> heads;
+    heads.reserve(data.size());
+
+    vector<const HistoryNode*> stack;
+    for (auto& p : data) {
+        const HistoryNode* node = p.first.Head();
+        // collect nodes not yet in table
+        while (node != NULL && node_index.count(node) == 0) {
+            stack.push_back(node);
+            node = node->parent.get();
+        }
+        while (!stack.empty()) {
+            node_index[stack.back()] = table.size();
+            table.push_back(stack.back());
+            stack.pop_back();
+        }
+        heads.push_back(p.first.empty() ? -1 : node_index[p.first.Head()]);
+    }
+
+    // node table
+    m << table.size();
+    for (auto node : table) {
+        int parent = node->parent ? node_index[node->parent.get()] : -1;
+        m << parent;
+        m << node->kv;
+    }
+
+    // data
+    m << data.size();
+    for (int i = 0; i < data.size(); i++) {
+        m << heads[i];
+        m << data[i].second;
+    }
+    return m;
+}
+
+obinstream& operator>>(obinstream& m, vector<pair<history_t, vector<value_t>>>& data) {
+    size_t table_size;
+    m >> table_size;
+
+    vector<shared_ptr<const HistoryNode>> table;
+    table.reserve(table_size);
+    for (size_t i = 0; i < table_size; i++) {
+        int parent, key;
+        value_t v;
+        m >> parent >> key >> v;
+        table.push_back(make_shared<const HistoryNode>(key, move(v), parent < 0 ? shared_ptr<const HistoryNode>() : table[parent]));
+    }
+
+    size_t size;
+    m >> size;
+    data.clear();
+    data.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        int head;
+        m >> head;
+        data.emplace_back(head < 0 ? history_t() : history_t(table[head]), vector<value_t>());
+        m >> data.back().second;
+    }
+    return m;
+}
@@ -0,0 +1,146 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+         Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/serialization.hpp"
+#include "base/type.hpp"
+
+// One labelled step of a traverser path
+// Nodes are immutable once created and shared by every history extending them
+struct HistoryNode {
+    // <label step key, value>
+    pair<int, value_t> kv;
+    shared_ptr<const HistoryNode> parent;
+    // number of nodes from root to this one
+    uint32_t depth;
+    // hash of the whole path, computed at creation
+    size_t hash;
+
+    HistoryNode(int key, value_t&& value, const shared_ptr<const HistoryNode>& _parent);
+};
+
+// Path of a traverser, a persistent singly linked list of HistoryNode
+// Copying a history only copies the head pointer, appending creates a new head
+// while the prefix stays shared with all other copies
+//
+// Iteration goes from the latest recorded label back to the first one
+class history_t {
+ public:
+    class const_iterator {
+     public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef pair<int, value_t> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        const_iterator() : slot_(NULL) {}
+        explicit const_iterator(const shared_ptr<const HistoryNode>* slot) : slot_(slot) {}
+
+        reference operator*() const { return (*slot_)->kv; }
+        pointer operator->() const { return &(*slot_)->kv; }
+
+        const_iterator& operator++() {
+            slot_ = &(*slot_)->parent;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator tmp = *this;
+            ++(*this);
+            return tmp;
+        }
+
+        bool operator==(const const_iterator& r) const { return node() == r.node(); }
+        bool operator!=(const const_iterator& r) const { return node() != r.node(); }
+
+     private:
+        // points to the shared_ptr owning current node, so that
+        // a history can be cut at any position without extra ref counting
+        const shared_ptr<const HistoryNode>* slot_;
+
+        const HistoryNode* node() const { return slot_ == NULL ? NULL : slot_->get(); }
+
+        friend class history_t;
+    };
+
+    typedef const_iterator iterator;
+    typedef pair<int, value_t> value_type;
+
+    history_t() {}
+
+    size_t size() const { return head_ ? head_->depth : 0; }
+    bool empty() const { return !head_; }
+
+    const_iterator begin() const { return const_iterator(&head_); }
+    const_iterator end() const { return const_iterator(); }
+
+    void emplace_back(int key, value_t value);
+    void push_back(const pair<int, value_t>& kv);
+
+    // remove all labels recorded after itr, itr itself is kept
+    void EraseAfter(const_iterator itr);
+
+    // keep labels with key in given set, order is preserved
+    template<class KeySet>
+    history_t Project(const KeySet& keys) const;
+
+    size_t Hash() const { return head_ ? head_->hash : 0; }
+
+    const HistoryNode* Head() const { return head_.get(); }
+
+ private:
+    shared_ptr<const HistoryNode> head_;
+
+    explicit history_t(const shared_ptr<const HistoryNode>& head) : head_(head) {}
+
+    friend ibinstream& operator<<(ibinstream& m, const vector<pair<history_t, vector<value_t>>>& data);
+    friend obinstream& operator>>(obinstream& m, vector<pair<history_t, vector<value_t>>>& data);
+    friend obinstream& operator>>(obinstream& m, history_t& his);
+};
+
+struct HistoryTHash {
+    size_t operator() (const history_t& his) const {
+        return his.Hash();
+    }
+};
+
+bool operator==(const history_t& l, const history_t& r);
+
+bool operator!=(const history_t& l, const history_t& r);
+
+// single history, written from root to head
+ibinstream& operator<<(ibinstream& m, const history_t& his);
+
+obinstream& operator>>(obinstream& m, history_t& his);
+
+// message body
+// all distinct history nodes are written once as a table before the data,
+// so a prefix shared by many traversers costs a single copy on the wire
+ibinstream& operator<<(ibinstream& m, const vector<pair<history_t, vector<value_t>>>& data);
+
+obinstream& operator>>(obinstream& m, vector<pair<history_t, vector<value_t>>>& data);
+
+template<class KeySet>
+history_t history_t::Project(const KeySet& keys) const {
+    vector<const pair<int, value_t>*> selected;
+    for (auto& kv : *this) {
+        if (keys.find(kv.first) != keys.end()) {
+            selected.push_back(&kv);
+        }
+    }
+
+    history_t his;
+    for (auto itr = selected.rbegin(); itr != selected.rend(); itr++) {
+        his.push_back(**itr);
+    }
+    return his;
+}
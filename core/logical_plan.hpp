@@ -12,14 +12,16 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 
 class LogicPlan {
  public:
-    LogicPlan() {}
-    explicit LogicPlan(qid_t id) : qid(id) {}
+    LogicPlan() : priority(PRIORITY_HIGH) {}
+    explicit LogicPlan(qid_t id) : qid(id), priority(PRIORITY_HIGH) {}
     void Feed(vector<Expert_Object> & experts_) {
         experts = move(experts_);
     }
 
     qid_t qid;
     vector<Expert_Object> experts;
+    // Priority_T, either high or low
+    int priority;
 };
 
 #endif /* LOGICAL_PLAN_HPP_ */
@@ -12,7 +12,7 @@ ibinstream& operator<<(ibinstream& m, const Branch_Info& info) {
     m << info.index;
     m << info.key;
     m << info.msg_id;
-    m << info.msg_path;
+    m << info.msg_credit;
     return m;
 }
 
@@ -22,7 +22,7 @@ obinstream& operator>>(obinstream& m, Branch_Info& info) {
     m >> info.index;
     m >> info.key;
     m >> info.msg_id;
-    m >> info.msg_path;
+    m >> info.msg_credit;
     return m;
 }
 
@@ -30,11 +30,12 @@ ibinstream& operator<<(ibinstream& m, const Meta& meta) {
     m << meta.qid;
     m << meta.step;
     m << meta.msg_type;
+    m << meta.priority;
     m << meta.recver_nid;
     m << meta.recver_tid;
     m << meta.parent_nid;
     m << meta.parent_tid;
-    m << meta.msg_path;
+    m << meta.msg_credit;
     m << meta.branch_infos;
     m << meta.experts;
     return m;
@@ -44,11 +45,12 @@ obinstream& operator>>(obinstream& m, Meta& meta) {
     m >> meta.qid;
     m >> meta.step;
     m >> meta.msg_type;
+    m >> meta.priority;
     m >> meta.recver_nid;
     m >> meta.recver_tid;
     m >> meta.parent_nid;
     m >> meta.parent_tid;
-    m >> meta.msg_path;
+    m >> meta.msg_credit;
     m >> meta.branch_infos;
     m >> meta.experts;
     return m;
@@ -61,7 +63,8 @@ std::string Meta::DebugString() const {
     ss << ", step: " << step;
     ss << ", recver node: " << recver_nid << ":" << recver_tid;
     ss << ", msg type: " << MsgType[static_cast<int>(msg_type)];
-    ss << ", msg path: " << msg_path;
+    ss << ", priority: " << priority;
+    ss << ", msg credit: " << msg_credit;
     ss << ", parent node: " << parent_nid;
     ss << ", paraent thread: " << parent_tid;
     if (msg_type == MSG_T::INIT) {
@@ -91,7 +94,7 @@ obinstream& operator>>(obinstream& m, Message& msg) {
     return m;
 }
 
-void Message::CreateInitMsg(uint64_t qid, int parent_node, int nodes_num, int recv_tid, const vector<Expert_Object>& experts, vector<Message>& vec) {
+void Message::CreateInitMsg(uint64_t qid, int parent_node, int nodes_num, int recv_tid, int priority, const vector<Expert_Object>& experts, vector<Message>& vec) {
     // assign receiver thread id
     Meta m;
     m.qid = qid;
@@ -101,13 +104,14 @@ void Message::CreateInitMsg(uint64_t qid, int parent_node, int nodes_num, int re
     m.parent_nid = parent_node;
     m.parent_tid = recv_tid;
     m.msg_type = MSG_T::INIT;
-    m.msg_path = to_string(nodes_num);
+    m.priority = priority;
     m.experts = experts;
 
     for (int i = 0; i < nodes_num; i++) {
         Message msg;
         msg.meta = m;
         msg.meta.recver_nid = i;
+        msg.meta.msg_credit = SplitCredit(0, nodes_num, i);
         vec.push_back(move(msg));
     }
 }
@@ -126,6 +130,21 @@ void Message::CreateExitMsg(int nodes_num, vector<Message>& vec) {
 }
 
 
+void Message::CreateAbortMsg(const vector<Expert_Object>& experts, const string& reason, CoreAffinity* core_affinity, Message& msg) {
+    assert(this->meta.branch_infos.empty());
+    msg.meta = this->meta;
+    msg.meta.step = experts.size() - 1;
+    msg.meta.msg_type = MSG_T::ABORT;
+    msg.meta.recver_nid = this->meta.parent_nid;
+    msg.meta.recver_tid = core_affinity->GetThreadIdForExpert(EXPERT_T::END);
+    msg.max_data_size = this->max_data_size;
+
+    value_t v;
+    Tool::str2str(reason, v);
+    pair<history_t, vector<value_t>> p(history_t(), vector<value_t>{move(v)});
+    msg.InsertData(p);
+}
+
 void Message::CreateNextMsg(const vector<Expert_Object>& experts, vector<pair<history_t, vector<value_t>>>& data, int num_thread, MetaData* data_store, CoreAffinity* core_affinity, vector<Message>& vec) {
     // timer::start_timer(meta.recver_tid + 4 * num_thread);
     Meta m = this->meta;
@@ -134,14 +153,10 @@ void Message::CreateNextMsg(const vector<Expert_Object>& experts, vector<pair<hi
     int count = vec.size();
     dispatch_data(m, experts, data, num_thread, data_store, core_affinity, vec);
 
-    // set disptching path
-    string num = to_string(vec.size() - count);
-    if (meta.msg_path != "") {
-        num = "\t" + num;
-    }
-
+    // split credit to dispatched msgs
+    int num = vec.size() - count;
     for (int i = count; i < vec.size(); i++) {
-        vec[i].meta.msg_path += num;
+        vec[i].meta.msg_credit = SplitCredit(meta.msg_credit, num, i - count);
     }
     // timer::stop_timer(meta.recver_tid + 4 * num_thread);
 }
@@ -150,62 +165,53 @@ void Message::CreateBranchedMsg(const vector<Expert_Object>& experts, vector<int
     // timer::start_timer(meta.recver_tid + 4 * num_thread);
     Meta m = this->meta;
 
-    // append steps num into msg path
     int step_count = steps.size();
 
     // update branch info
     Branch_Info info;
 
-    // parent msg end path
-    string parent_path = "";
+    // credit of parent scope
+    credit_t parent_credit = 0;
 
     int branch_depth = m.branch_infos.size() - 1;
     if (branch_depth >= 0) {
         // use parent branch's route
         info = m.branch_infos[branch_depth];
-        parent_path = info.msg_path;
-
-        // update current branch's end path with steps num
-        info.msg_path += "\t" + to_string(step_count);
+        parent_credit = info.msg_credit;
     } else {
         info.node_id = m.parent_nid;
         info.thread_id = m.parent_tid;
         info.key = -1;
-        info.msg_path = to_string(step_count);
         info.msg_id = 0;
     }
 
-    string tail = m.msg_path.substr(parent_path.size());
-    // append "\t" to tail when first char is not "\t"
-    if (tail != "" && tail.find("\t") != 0) {
-        tail = "\t" + tail;
-    }
-
-    //    insert step_count into current msg path
+    // each branch takes one share of both parent scope and current msg
     //     e.g.:
-    //  "3\t2\t4" with parent path "3\t2", steps num 5
-    //  info.msg_path => "3\t2\t5"
-    //  tail = "4"
-    //  msg_path = "3\t2\t5\t4"
-    m.msg_path = info.msg_path + tail;
-
-    // copy labeled data to each step
+    //  parent scope credit 1, msg credit 3, 3 branches
+    //  branch 1: scope 2, msg 4
+    //  branch 2: scope 3, msg 5
+    //  branch 3: scope 3, msg 5
+    // msgs leaving the branch need no conversion,
+    // as shares of all branches add up to the parent again
     for (int i = 0; i < steps.size(); i ++) {
         Meta step_meta = m;
 
         int step = steps[i];
         info.index = i + 1;
+        info.msg_credit = SplitCredit(parent_credit, step_count, i);
         step_meta.branch_infos.push_back(info);
         step_meta.step = step;
+        step_meta.msg_credit = SplitCredit(m.msg_credit, step_count, i);
 
         auto temp = data;
         // dispatch data to msg vec
         int count = vec.size();
         dispatch_data(step_meta, experts, temp, num_thread, data_store, core_affinity, vec);
 
-        // set msg_path for each branch
+        // split credit for each branch
+        int num = vec.size() - count;
         for (int j = count; j < vec.size(); j++) {
-            vec[j].meta.msg_path += "\t" + to_string(vec.size() - count);
+            vec[j].meta.msg_credit = SplitCredit(step_meta.msg_credit, num, j - count);
         }
     }
     // timer::stop_timer(meta.recver_tid + 4 * num_thread);
@@ -220,7 +226,7 @@ void Message::CreateBranchedMsgWithHisLabel(const vector<Expert_Object>& experts
     info.node_id = m.recver_nid;
     info.thread_id = m.recver_tid;
     info.key = m.step;
-    info.msg_path = m.msg_path;
+    info.msg_credit = m.msg_credit;
     info.msg_id = msg_id;
 
     // label each data with unique id
@@ -259,9 +265,10 @@ void Message::CreateBranchedMsgWithHisLabel(const vector<Expert_Object>& experts
         int count = vec.size();
         dispatch_data(step_meta, experts, temp, num_thread, data_store, core_affinity, vec);
 
-        // set msg_path for each branch
+        // each branch collects the full credit of current msg
+        int num = vec.size() - count;
         for (int j = count; j < vec.size(); j++) {
-            vec[j].meta.msg_path += "\t" + to_string(vec.size() - count);
+            vec[j].meta.msg_credit = SplitCredit(m.msg_credit, num, j - count);
         }
     }
     // timer::stop_timer(meta.recver_tid + 4 * num_thread);
@@ -512,6 +519,53 @@ void Message::InsertData(vector<pair<history_t, vector<value_t>>>& vec) {
     vec.erase(vec.begin(), itr);
 }
 
+void Message::SplitData(int num, vector<Message>& vec) {
+    int count = vec.size();
+    size_t target = data_size / num + 1;
+
+    Message msg(meta);
+    msg.max_data_size = max_data_size;
+    for (auto& p : data) {
+        size_t his_size = MemSize(p.first) + sizeof(size_t);
+        if (p.second.size() == 0) {
+            msg.data_size += his_size;
+            msg.data.push_back(move(p));
+            continue;
+        }
+
+        // values of one history may go to several msgs
+        auto begin = p.second.begin();
+        size_t in_size = his_size;
+        for (auto itr = p.second.begin(); itr != p.second.end(); itr++) {
+            in_size += MemSize(*itr);
+            if (msg.data_size + in_size >= target && (int)vec.size() - count < num - 1) {
+                msg.data.emplace_back(p.first, vector<value_t>(make_move_iterator(begin), make_move_iterator(itr + 1)));
+                msg.data_size += in_size;
+                vec.push_back(move(msg));
+
+                msg = Message(meta);
+                msg.max_data_size = max_data_size;
+                begin = itr + 1;
+                in_size = his_size;
+            }
+        }
+        if (begin != p.second.end()) {
+            msg.data.emplace_back(move(p.first), vector<value_t>(make_move_iterator(begin), make_move_iterator(p.second.end())));
+            msg.data_size += in_size;
+        }
+    }
+    if (msg.data.size() != 0) {
+        vec.push_back(move(msg));
+    }
+    data.clear();
+    data_size = sizeof(size_t);
+
+    int n = vec.size() - count;
+    for (int i = count; i < vec.size(); i++) {
+        vec[i].meta.msg_credit = SplitCredit(meta.msg_credit, n, i - count);
+    }
+}
+
 std::string Message::DebugString() const {
     std::stringstream ss;
     ss << meta.DebugString();
@@ -523,21 +577,6 @@ std::string Message::DebugString() const {
     return ss.str();
 }
 
-bool operator == (const history_t& l, const history_t& r) {
-    if (l.size() != r.size()) {
-        return false;
-    }
-
-    // history keys are in ascending order
-    // so simply match kv pair one by one
-    for (int i = 0; i < l.size(); i++) {
-        if (l[i] != r[i]) {
-            return false;
-        }
-    }
-    return true;
-}
-
 size_t MemSize(const int& i) {
     return sizeof(int);
 }
@@ -551,3 +590,12 @@ size_t MemSize(const value_t& data) {
     s += MemSize(data.content);
     return s;
 }
+
+size_t MemSize(const history_t& his) {
+    // upper bound, nodes shared with other histories in the same msg are only sent once
+    size_t s = sizeof(size_t) + sizeof(int);
+    for (auto& kv : his) {
+        s += 2 * sizeof(int) + MemSize(kv.second);
+    }
+    return s;
+}
@@ -17,6 +17,8 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "base/serialization.hpp"
 #include "base/type.hpp"
 #include "core/expert_object.hpp"
+#include "core/history.hpp"
+#include "core/msg_credit.hpp"
 #include "storage/metadata.hpp"
 
 #define TEN_MB 1048576
@@ -31,8 +33,9 @@ struct Branch_Info {
     int key;
     // msg id of parent, unique on each node
     uint64_t msg_id;
-    // msg path of parent
-    string msg_path;
+    // credit of branch scope
+    // msgs inside branch are collected when their credits add up to it
+    credit_t msg_credit;
 };
 
 ibinstream& operator<<(ibinstream& m, const Branch_Info& info);
@@ -55,8 +58,11 @@ struct Meta {
     // type
     MSG_T msg_type;
 
-    // Msg disptching path
-    string msg_path;
+    // Priority_T of query
+    int priority = PRIORITY_HIGH;
+
+    // Msg weight in current collection scope
+    credit_t msg_credit;
 
     // branch info
     vector<Branch_Info> branch_infos;
@@ -71,27 +77,6 @@ ibinstream& operator<<(ibinstream& m, const Meta& meta);
 
 obinstream& operator>>(obinstream& m, Meta& meta);
 
-typedef vector<pair<int, value_t>> history_t;
-
-struct HistoryTHash {
-    // To limit the upper bound of cost for hashing
-    constexpr static int max_hash_len = 4;
-
-    size_t operator() (const history_t& his) const {
-        uint64_t hash_tmp = mymath::hash_u64(his.size());
-
-        int hash_loop_len = (max_hash_len > his.size()) ? his.size() : max_hash_len;
-
-        // Only use the former elements to compute the hash value
-        for (int i = 0; i < hash_loop_len; i++)
-            hash_tmp = mymath::hash_u64(hash_tmp + ValueTHash()(his[i].second) + his[i].first);
-
-        return hash_tmp;
-    }
-};
-
-bool operator==(const history_t& l, const history_t& r);
-
 class Message {
     // Node node_ = Node::StaticInstance();
  public:
@@ -117,11 +102,15 @@ class Message {
     // currently
     // recv_tid = qid % thread_pool.size()
     // parent_node = _my_node.get_local_rank()
-    static void CreateInitMsg(uint64_t qid, int parent_node, int nodes_num, int recv_tid, const vector<Expert_Object>& experts, vector<Message>& vec);
+    static void CreateInitMsg(uint64_t qid, int parent_node, int nodes_num, int recv_tid, int priority, const vector<Expert_Object>& experts, vector<Message>& vec);
 
     // create exit msg, notifying ending of one query
     void CreateExitMsg(int nodes_num, vector<Message>& vec);
 
+    // create abort msg, carrying the credit of this msg of main query to end
+    // expert, which ends the query with reason as error, msg is a new msg
+    void CreateAbortMsg(const vector<Expert_Object>& experts, const string& reason, CoreAffinity* core_affinity, Message& msg);
+
     // experts:  experts chain for current message
     // data:    new data processed by expert_type
     // vec:     messages to be send
@@ -139,6 +128,10 @@ class Message {
     // vec:     messages to be send
     void CreateBranchedMsgWithHisLabel(const vector<Expert_Object>& experts, vector<int>& steps, uint64_t msg_id, int num_thread, MetaData* metadata, CoreAffinity* core_affinity, vector<Message>& vec);
 
+    // split data into at most num msgs of similar size, in order,
+    // the credit of this msg is split among them
+    void SplitData(int num, vector<Message>& vec);
+
     // create Feed msg
     // Feed data to all node with tid = parent_tid
     void CreateFeedMsg(int key, int nodes_num, vector<value_t>& data, vector<Message>& vec);
@@ -163,6 +156,7 @@ obinstream& operator>>(obinstream& m, Message& msg);
 size_t MemSize(const int& i);
 size_t MemSize(const char& c);
 size_t MemSize(const value_t& data);
+size_t MemSize(const history_t& his);
 
 template<class T1, class T2>
 size_t MemSize(const pair<T1, T2>& p);
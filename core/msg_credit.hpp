@@ -0,0 +1,86 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+// Credit of a msg inside its collection scope (whole query or one branch)
+// credit_t c stands for the weight 2^(-c), the scope itself owns weight 2^(-end)
+//
+// When a msg is split into n msgs, its weight is divided into n powers of 2
+// that sum up exactly to the parent's weight, so a barrier knows that all
+// msgs are collected once the received weights add up to the scope's weight
+typedef uint16_t credit_t;
+
+// credit of the index-th msg when splitting a msg with credit c into n msgs
+static inline credit_t SplitCredit(credit_t c, int n, int index) {
+    if (n <= 1) {
+        return c;
+    }
+
+    // smallest m with 2^m >= n
+    int m = 0;
+    while ((1 << m) < n) {
+        m++;
+    }
+
+    // start with 2^m pieces of 2^(-c-m), then merge pairs until n pieces left
+    // the first (2^m - n) pieces are merged ones
+    int merged = (1 << m) - n;
+    return index < merged ? c + m - 1 : c + m;
+}
+
+// Accumulate weights of received msgs as a binary fraction
+// bit i is the coefficient of 2^(-i)
+class CreditCounter {
+ public:
+    CreditCounter() {}
+
+    // add weight 2^(-c)
+    void Add(credit_t c) {
+        if (bits_.size() <= c / 64) {
+            bits_.resize(c / 64 + 1, 0);
+        }
+
+        // carry to larger weight
+        int i = c;
+        while (i >= 0 && Test(i)) {
+            Reset(i);
+            i--;
+        }
+        if (i >= 0) {
+            Set(i);
+        }
+    }
+
+    // received weights never exceed the scope's weight,
+    // so the scope is complete once its own bit is set
+    bool IsComplete(credit_t end) const {
+        return Test(end);
+    }
+
+    void Clear() {
+        bits_.clear();
+    }
+
+ private:
+    vector<uint64_t> bits_;
+
+    bool Test(int i) const {
+        return i / 64 < bits_.size() && (bits_[i / 64] >> (i % 64)) & 1;
+    }
+
+    void Set(int i) {
+        bits_[i / 64] |= (1ULL << (i % 64));
+    }
+
+    void Reset(int i) {
+        bits_[i / 64] &= ~(1ULL << (i % 64));
+    }
+};
@@ -10,7 +10,11 @@ Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
 #include "core/parser.hpp"
 
 void Parser::LoadMapping(MetaData* metadata) {
-    indexes_ = &(metadata->indexes);
+    LoadMapping(&(metadata->indexes));
+}
+
+void Parser::LoadMapping(string_index* indexes) {
+    indexes_ = indexes;
 
     // these *_str will be used when given error key in a query (return to the client as error message)
     for (auto vpk_pair : indexes_->str2vpk) {
@@ -62,6 +66,7 @@ bool Parser::Parse(const string& query, vector<Expert_Object>& vec, string& erro
     Clear();
     bool build_index = false;
     bool set_config = false;
+    bool mutate = false;
     string error_prefix = "Parsing Error: ";
     // check prefix
     if (query.find("g.V().") == 0) {
@@ -76,11 +81,15 @@ bool Parser::Parse(const string& query, vector<Expert_Object>& vec, string& erro
     } else if (query.find("SetConfig") == 0) {
         set_config = true;
         error_prefix = "Set Config error: ";
+    } else if (query.find("AddV") == 0 || query.find("AddE") == 0 || query.find("SetProperty") == 0) {
+        mutate = true;
+        error_prefix = "Update error: ";
     } else {
         error_msg = "1. Execute query with 'g.V()' or 'g.E()'\n";
         error_msg += "2. Set up index by BuildIndex(V/E, propertyname)\n";
         error_msg += "3. Change config by SetConfig(config_name, t/f)\n";
-        error_msg += "4. Run emulator mode with 'emu <file>'";
+        error_msg += "4. Update graph by AddV(label), AddE(label, src, dst) or SetProperty(V/E, id, key, value)\n";
+        error_msg += "5. Run emulator mode with 'emu <file>'";
         return false;
     }
 
@@ -89,6 +98,8 @@ bool Parser::Parse(const string& query, vector<Expert_Object>& vec, string& erro
             ParseIndex(query);
         } else if (set_config) {
             ParseSetConfig(query);
+        } else if (mutate) {
+            ParseMutate(query);
         } else {
             // trim blanks and remove prefix
             string q = query.substr(6);
@@ -281,6 +292,83 @@ void Parser::ParseSetConfig(const string& param) {
     AppendExpert(expert);
 }
 
+// AddV(label), AddE(label, src, dst), SetProperty(V, vid, key, value)
+// and SetProperty(E, src, dst, key, value)
+void Parser::ParseMutate(const string& param) {
+    vector<string> params;
+    Tool::splitWithEscape(param, ",() ", params);
+
+    Expert_Object expert(EXPERT_T::MUTATE);
+    int key = 0;
+    uint8_t vtype = 0;
+    int num_vids;
+    if (params[0] == "AddV") {
+        if (params.size() != 2) {
+            throw ParserException("expect 1 parameter");
+        }
+        io_type_ = IO_T::VERTEX;
+        if (!ParseKeyId(params[1], true, key)) {
+            throw ParserException("unexpected label: " + params[1] + ", expected is " + ExpectedKey(true));
+        }
+        expert.AddParam(Mutate_T::ADD_VTX);
+        expert.AddParam(key);
+        num_vids = 0;
+    } else if (params[0] == "AddE") {
+        if (params.size() != 4) {
+            throw ParserException("expect 3 parameters");
+        }
+        io_type_ = IO_T::EDGE;
+        if (!ParseKeyId(params[1], true, key)) {
+            throw ParserException("unexpected label: " + params[1] + ", expected is " + ExpectedKey(true));
+        }
+        expert.AddParam(Mutate_T::ADD_EDGE);
+        expert.AddParam(key);
+        num_vids = 2;
+    } else if (params[0] == "SetProperty") {
+        if (params.size() < 2) {
+            throw ParserException("expect V/E");
+        }
+        if (params[1] == "V") {
+            io_type_ = IO_T::VERTEX;
+            expert.AddParam(Mutate_T::SET_VP);
+            num_vids = 1;
+        } else if (params[1] == "E") {
+            io_type_ = IO_T::EDGE;
+            expert.AddParam(Mutate_T::SET_EP);
+            num_vids = 2;
+        } else {
+            throw ParserException("expect V/E but get: " + params[1]);
+        }
+        if (params.size() != 4 + num_vids) {
+            throw ParserException("expect " + to_string(3 + num_vids) + " parameters");
+        }
+        if (!ParseKeyId(params[2 + num_vids], false, key, &vtype)) {
+            throw ParserException("unexpected property key: " + params[2 + num_vids] + ", expected is " + ExpectedKey(false));
+        }
+    } else {
+        throw ParserException("unexpected command: " + params[0]);
+    }
+
+    // vids after the label or V/E, then key and value for SetProperty
+    for (int i = 2; i < 2 + num_vids; i++) {
+        if (Tool::checktype(params[i]) != 1) {
+            throw ParserException("expect vid but get: " + params[i]);
+        }
+        expert.AddParam(atoi(params[i].c_str()));
+    }
+    if (vtype != 0) {
+        string & val = params[3 + num_vids];
+        if (Tool::checktype(val) != vtype) {
+            throw ParserException("unexpected value type: " + val);
+        }
+        value_t v;
+        Tool::str2value_t(val, v);
+        expert.AddParam(key);
+        expert.params.push_back(v);
+    }
+    AppendExpert(expert);
+}
+
 string Parser::TokenToStr(pair<Step_T, string> token) {
     string str = "";
     str += "<";
@@ -1063,8 +1151,11 @@ void Parser::ParseHasLabel(const vector<string>& params) {
         pred_params.erase(pred_params.begin());
         PredicateValue pred(pred_type, pred_params);
 
+        // vertices of each label are listed by the memory node, so the init
+        // expert starts from them even without index
         uint64_t count = 0;
-        if (index_store_->IsIndexEnabled(element_type, 0, &pred, &count)) {
+        bool enabled = index_store_->IsIndexEnabled(element_type, 0, &pred, &count);
+        if (enabled || element_type == Element_T::VERTEX) {
             experts_.erase(experts_.end() - 1);
 
             value_t v;
@@ -102,6 +102,9 @@ class Parser {
     // Parse set config
     void ParseSetConfig(const string& param);
 
+    // Parse graph updates
+    void ParseMutate(const string& param);
+
     // Parse query or sub-query
     void DoParse(const string& query);
 
@@ -164,6 +167,7 @@ class Parser {
 
     // load property and label mapping
     void LoadMapping(MetaData* metadata);
+    void LoadMapping(string_index* indexes);
 
     // parsing exception
     struct ParserException {
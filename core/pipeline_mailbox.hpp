@@ -0,0 +1,139 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+         Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "base/core_affinity.hpp"
+#include "base/node.hpp"
+#include "core/abstract_mailbox.hpp"
+#include "core/message.hpp"
+
+#define CLINE 64
+
+// Mailbox handed to experts when pipelining is enabled
+//
+// While a thread is executing a msg, the first local SPAWN msg it produces for a
+// later step is kept in the thread instead of being pushed into the recv queue,
+// and executed right after the current expert returns. Chains of sequential
+// experts on one node then run in a single pass. Msgs to barriers, branch parents
+// or remote nodes, and any further split of the output, go through the mailbox
+// as usual so that other threads can still pick them up.
+//
+// Routing is kept: a msg is only kept if the thread it was routed to is in the
+// same expert division as the current thread, the same set of threads that may
+// steal it, and recver_tid is set to the current thread.
+class PipelineMailbox : public AbstractMailbox {
+ public:
+    PipelineMailbox(Node & node, AbstractMailbox * mailbox, CoreAffinity * core_affinity, int num_thread) : node_(node), mailbox_(mailbox), core_affinity_(core_affinity) {
+        slots_ = new slot_t[num_thread];
+        num_thread_ = num_thread;
+    }
+
+    ~PipelineMailbox() {
+        delete[] slots_;
+    }
+
+    void Init(vector<Node> & nodes, vector<Node> & memory_nodes) override {
+        mailbox_->Init(nodes, memory_nodes);
+    }
+
+    int Send(int tid, const Message & msg) override {
+        if (CanKeep(tid, msg)) {
+            Keep(tid, Message(msg));
+            return 0;
+        }
+        return mailbox_->Send(tid, msg);
+    }
+
+    int Send(int tid, Message && msg) override {
+        if (CanKeep(tid, msg)) {
+            Keep(tid, move(msg));
+            return 0;
+        }
+        return mailbox_->Send(tid, move(msg));
+    }
+
+    bool TryRecv(int tid, Message & msg) override {
+        return mailbox_->TryRecv(tid, msg);
+    }
+
+    void Recv(int tid, Message & msg) override {
+        mailbox_->Recv(tid, msg);
+    }
+
+    void Sweep(int tid) override {
+        mailbox_->Sweep(tid);
+    }
+
+    uint64_t Backlog() override {
+        return mailbox_->Backlog();
+    }
+
+    // start keeping msgs for thread tid
+    void Open(int tid) {
+        slots_[tid].active = true;
+    }
+
+    // stop keeping msgs, any kept msg should be popped before
+    void Close(int tid) {
+        slots_[tid].active = false;
+    }
+
+    // step currently executed by thread tid
+    void SetStep(int tid, int step) {
+        slots_[tid].step = step;
+    }
+
+    // get kept msg of thread tid if any
+    bool Pop(int tid, Message & msg) {
+        slot_t & slot = slots_[tid];
+        if (!slot.has_msg) {
+            return false;
+        }
+        msg = move(slot.msg);
+        slot.has_msg = false;
+        return true;
+    }
+
+ private:
+    bool CanKeep(int tid, const Message & msg) {
+        if (tid >= num_thread_) {
+            return false;
+        }
+        slot_t & slot = slots_[tid];
+        // only forward steps are pipelined,
+        // msgs resent to the same step wait in queue for other msgs
+        return slot.active && !slot.has_msg
+            && msg.meta.msg_type == MSG_T::SPAWN
+            && msg.meta.recver_nid == node_.get_local_rank()
+            && msg.meta.step > slot.step
+            && core_affinity_->InSameDivision(msg.meta.recver_tid, tid);
+    }
+
+    void Keep(int tid, Message && msg) {
+        slot_t & slot = slots_[tid];
+        slot.msg = move(msg);
+        slot.msg.meta.recver_tid = tid;
+        slot.has_msg = true;
+    }
+
+    struct slot_t {
+        bool active;
+        bool has_msg;
+        int step;
+        Message msg;
+        slot_t() : active(false), has_msg(false), step(0) {}
+    } __attribute__((aligned(CLINE)));
+
+    Node & node_;
+    AbstractMailbox * mailbox_;
+    CoreAffinity * core_affinity_;
+
+    slot_t * slots_;
+    int num_thread_;
+};
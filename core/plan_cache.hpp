@@ -0,0 +1,231 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <ctype.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/type.hpp"
+#include "core/expert_object.hpp"
+#include "core/parser.hpp"
+#include "utils/config.hpp"
+#include "utils/tool.hpp"
+
+using namespace std;
+
+// Cache of parsed plans of query templates
+//
+// A template is a query with placeholders "$name", e.g.
+//     g.V().has("name", "$1").out().has("age", $2)
+// Placeholders are numbered by their first appearance and bound to the given
+// parameters in order, the same name always takes the same parameter.
+//
+// A template is parsed once with each placeholder replaced by a unique string,
+// then the parameters found at those strings in the experts are overwritten
+// on each execution. So the plan (step order, index usage) is decided without
+// knowing the parameters, like a generic plan of prepared statements.
+// Templates that cannot be prepared, e.g. with placeholders inside within(),
+// are parsed again with parameters substituted each time.
+//
+// Only used by the thread of Worker::RecvRequest, same as Parser.
+class PlanCache {
+ public:
+    explicit PlanCache(Parser * parser) : parser_(parser) {
+        config_ = Config::GetInstance();
+    }
+
+    // get plan of tmpl with params bound
+    bool Parse(const string& tmpl, const vector<string>& params, vector<Expert_Object>& experts, string& error_msg) {
+        auto itr = plans_.find(tmpl);
+        if (itr == plans_.end() || !IsValid(itr->second)) {
+            if (plans_.size() >= MAX_PLANS) {
+                plans_.clear();
+            }
+            itr = plans_.insert(make_pair(tmpl, Prepare(tmpl))).first;
+        }
+
+        Plan& plan = itr->second;
+        if (params.size() < plan.num_params) {
+            error_msg = "Parsing Error: expect " + to_string(plan.num_params) + " parameters, got " + to_string(params.size());
+            return false;
+        }
+
+        if (!plan.prepared) {
+            return parser_->Parse(Substitute(tmpl, params), experts, error_msg);
+        }
+
+        experts = plan.experts;
+        for (auto& slot : plan.slots) {
+            string literal = slot.quote == 0 ? params[slot.param] : slot.quote + params[slot.param] + slot.quote;
+            value_t& v = experts[slot.expert].params[slot.pos];
+            v.content.clear();
+            if (!Tool::str2value_t(literal, v)) {
+                error_msg = "Parsing Error: unexpected value: " + params[slot.param];
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // plans depend on index and config, drop them when those change
+    void Clear() {
+        plans_.clear();
+    }
+
+    // replace placeholders in tmpl with params
+    static string Substitute(const string& tmpl, const vector<string>& params) {
+        vector<Placeholder> holders;
+        int num_params;
+        FindPlaceholders(tmpl, holders, num_params);
+
+        string query;
+        size_t last = 0;
+        for (auto& h : holders) {
+            query.append(tmpl, last, h.start - last);
+            if (h.param < params.size()) {
+                query += params[h.param];
+            } else {
+                query.append(tmpl, h.start, h.len);
+            }
+            last = h.start + h.len;
+        }
+        query.append(tmpl, last, string::npos);
+        return query;
+    }
+
+ private:
+    static const size_t MAX_PLANS = 1024;
+
+    struct Placeholder {
+        size_t start;
+        size_t len;
+        int param;
+        // quote around the placeholder, 0 if none
+        char quote;
+    };
+
+    // where a parameter goes in the plan
+    struct Slot {
+        int expert;
+        int pos;
+        int param;
+        char quote;
+    };
+
+    struct Plan {
+        bool prepared;
+        int num_params;
+        vector<Expert_Object> experts;
+        vector<Slot> slots;
+
+        // config when the plan is made
+        bool enable_indexing;
+        bool enable_step_reorder;
+    };
+
+    Parser * parser_;
+    Config * config_;
+    unordered_map<string, Plan> plans_;
+
+    bool IsValid(const Plan& plan) {
+        return plan.enable_indexing == config_->global_enable_indexing
+            && plan.enable_step_reorder == config_->global_enable_step_reorder;
+    }
+
+    static void FindPlaceholders(const string& tmpl, vector<Placeholder>& holders, int& num_params) {
+        unordered_map<string, int> name2param;
+        for (size_t i = 0; i < tmpl.size(); i++) {
+            if (tmpl[i] != '$') {
+                continue;
+            }
+            size_t j = i + 1;
+            while (j < tmpl.size() && (isalnum(tmpl[j]) || tmpl[j] == '_')) {
+                j++;
+            }
+            if (j == i + 1) {
+                continue;
+            }
+
+            string name = tmpl.substr(i + 1, j - i - 1);
+            auto itr = name2param.find(name);
+            if (itr == name2param.end()) {
+                itr = name2param.insert(make_pair(name, name2param.size())).first;
+            }
+
+            char quote = 0;
+            if (i > 0 && j < tmpl.size() && (tmpl[i - 1] == '"' || tmpl[i - 1] == '\'') && tmpl[j] == tmpl[i - 1]) {
+                quote = tmpl[j];
+            }
+            holders.push_back(Placeholder{i, j - i, itr->second, quote});
+            i = j - 1;
+        }
+        num_params = name2param.size();
+    }
+
+    // string put at the i-th placeholder when preparing
+    static string Marker(int i) {
+        return "\x01" + to_string(i) + "\x01";
+    }
+
+    Plan Prepare(const string& tmpl) {
+        Plan plan;
+        plan.prepared = false;
+        plan.enable_indexing = config_->global_enable_indexing;
+        plan.enable_step_reorder = config_->global_enable_step_reorder;
+
+        vector<Placeholder> holders;
+        FindPlaceholders(tmpl, holders, plan.num_params);
+
+        // put markers as string literals, keep the quotes of quoted placeholders
+        string query;
+        size_t last = 0;
+        for (int i = 0; i < holders.size(); i++) {
+            Placeholder& h = holders[i];
+            query.append(tmpl, last, h.start - last);
+            query += h.quote == 0 ? "\"" + Marker(i) + "\"" : Marker(i);
+            last = h.start + h.len;
+        }
+        query.append(tmpl, last, string::npos);
+
+        string error_msg;
+        if (!parser_->Parse(query, plan.experts, error_msg)) {
+            return plan;
+        }
+
+        // locate markers in plan
+        vector<bool> found(holders.size(), false);
+        for (int i = 0; i < plan.experts.size(); i++) {
+            vector<value_t>& params = plan.experts[i].params;
+            for (int j = 0; j < params.size(); j++) {
+                if (params[j].type != 4 || params[j].content.empty() || params[j].content[0] != '\x01') {
+                    continue;
+                }
+                string s(params[j].content.begin(), params[j].content.end());
+                for (int k = 0; k < holders.size(); k++) {
+                    if (s == Marker(k)) {
+                        plan.slots.push_back(Slot{i, j, holders[k].param, holders[k].quote});
+                        found[k] = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // some placeholder is not a whole value
+        for (bool f : found) {
+            if (!f) {
+                plan.experts.clear();
+                plan.slots.clear();
+                return plan;
+            }
+        }
+
+        plan.prepared = true;
+        return plan;
+    }
+};
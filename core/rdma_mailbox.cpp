@@ -42,6 +42,7 @@ void RdmaMailbox::Init(vector<Node> & nodes, vector<Node> & memory_nodes) {
 
     // 1 more thread for worker to send init msg
     pending_msgs.resize(config_->global_num_threads + 1);
+    num_pending_ = 0;
 
     local_remote_ratio = 3;
 }
@@ -62,6 +63,7 @@ void RdmaMailbox::Sweep(int tid) {
     for (auto it = pending_msgs[tid].begin(); it != pending_msgs[tid].end();) {
         if (SendData(tid, *it)) {
             it = pending_msgs[tid].erase(it);
+            num_pending_.fetch_sub(1, std::memory_order_relaxed);
         } else {
             it++;
         }
@@ -85,17 +87,26 @@ int RdmaMailbox::Send(int tid, const Message & msg) {
         data.stream << msg;
 
         pending_msgs[tid].push_back(move(data));
+        num_pending_.fetch_add(1, std::memory_order_relaxed);
     }
     return 0;
 }
 
+uint64_t RdmaMailbox::Backlog() {
+    uint64_t num = num_pending_.load(std::memory_order_relaxed);
+    for (int i = 0; i < config_->global_num_threads; i++) {
+        num += local_msgs[i]->Size();
+    }
+    return num;
+}
+
 bool RdmaMailbox::SendData(int tid, mailbox_data_t& data) {
     // Send data to remote machine only
     int dst_nid = data.dst_nid;
     int dst_tid = data.dst_tid;
 
     size_t data_sz = data.stream.size();
-    uint64_t msg_sz = sizeof(uint64_t) + ceil(data_sz, sizeof(uint64_t)) + sizeof(uint64_t);
+    uint64_t msg_sz = RingFrameSize(data_sz);
 
     rbf_rmeta_t *rmeta = &rmetas[GetIndex(dst_tid, dst_nid)];
 
@@ -112,15 +123,7 @@ bool RdmaMailbox::SendData(int tid, mailbox_data_t& data) {
 
     uint64_t rbf_sz = MiB2B(config_->global_per_recv_buffer_sz_mb);
 
-    char *rdma_buf = buffer_->GetSendBuf(tid);
-
-    *((uint64_t *)rdma_buf) = data_sz;  // header
-    rdma_buf += sizeof(uint64_t);
-
-    memcpy(rdma_buf, data.stream.get_buf(), data_sz);    // data
-    rdma_buf += ceil(data_sz, sizeof(uint64_t));
-
-    *((uint64_t*)rdma_buf) = data_sz;   // footer
+    RingEncode(buffer_->GetSendBuf(tid), data.stream.get_buf(), data_sz);
 
     RDMA &rdma = RDMA::get_rdma();
     uint64_t rdma_off = buffer_->GetRecvBufOffset(dst_tid, dst_nid);
@@ -180,57 +183,17 @@ bool RdmaMailbox::CheckRecvBuf(int tid, int nid) {
     rbf_lmeta_t *lmeta = &lmetas[GetIndex(tid, nid)];
     char * rbf = buffer_->GetRecvBuf(tid, nid);
     uint64_t rbf_sz = buffer_->GetRecvBufSize();
-    volatile uint64_t msg_size = *(volatile uint64_t *)(rbf + lmeta->head % rbf_sz);  // header
-    return msg_size != 0;
+    return RingPoll(rbf, rbf_sz, lmeta->head);
 }
 
 void RdmaMailbox::FetchMsgFromRecvBuf(int tid, int nid, obinstream & um) {
     rbf_lmeta_t *lmeta = &lmetas[GetIndex(tid, nid)];
     char * rbf = buffer_->GetRecvBuf(tid, nid);
     uint64_t rbf_sz = buffer_->GetRecvBufSize();
-    volatile uint64_t pop_msg_size = *(volatile uint64_t *)(rbf + lmeta->head % rbf_sz);  // header
-
-    uint64_t to_footer = sizeof(uint64_t) + ceil(pop_msg_size, sizeof(uint64_t));
-    volatile uint64_t * footer = (volatile uint64_t *)(rbf + (lmeta->head  + to_footer) % rbf_sz);  // footer
-
-    if (pop_msg_size) {
-        // Make sure RDMA trans is done
-        while (*footer != pop_msg_size) {
-            _mm_pause();
-            assert(*footer == 0 || *footer == pop_msg_size);
-        }
-
-        // IF it is a ring(rare situation)
-        uint64_t start = (lmeta->head + sizeof(uint64_t)) % rbf_sz;
-        uint64_t end = (lmeta->head + sizeof(uint64_t) + pop_msg_size) % rbf_sz;
-        if (start > end) {
-            char* tmp_buf = new char[pop_msg_size];
-            memcpy(tmp_buf, rbf + start, pop_msg_size - end);
-            memcpy(tmp_buf + pop_msg_size - end, rbf, end);
-
-            // register tmp_buf into obinstream,
-            // the obinstream will charge the memory of buf, including memory release
-            um.assign(tmp_buf, pop_msg_size, 0);
-
-            // clean
-            memset(rbf + start, 0, pop_msg_size - end);
-            memset(rbf, 0, ceil(end, sizeof(uint64_t)));
-        } else {
-            char* tmp_buf = new char[pop_msg_size];
-            memcpy(tmp_buf, rbf + start, pop_msg_size);
-
-            um.assign(tmp_buf, pop_msg_size, 0);
-
-            // clean the data
-            memset(rbf + start, 0, ceil(pop_msg_size, sizeof(uint64_t)));
-        }
-
-        // clear header and footer
-        *(uint64_t *)(rbf + lmeta->head % rbf_sz) = 0;
-        *footer = 0;
 
-        // advance the pointer
-        lmeta->head += 2 * sizeof(uint64_t) + ceil(pop_msg_size, sizeof(uint64_t));
+    uint64_t new_head = RingDecode(rbf, rbf_sz, lmeta->head, um);
+    if (new_head != lmeta->head) {
+        lmeta->head = new_head;
 
         // update heads of ring buffer to writer to help it detect overflow
         // timer::start_timer(tid);
@@ -17,12 +17,14 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include <vector>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <emmintrin.h>
 
 #include "core/buffer.hpp"
 #include "core/message.hpp"
 #include "core/abstract_mailbox.hpp"
 #include "core/abstract_id_mapper.hpp"
+#include "core/ring_buffer.hpp"
 #include "base/node.hpp"
 #include "base/rdma.hpp"
 #include "base/serialization.hpp"
@@ -49,6 +51,7 @@ class RdmaMailbox : public AbstractMailbox {
 
     // When sent to the same recv buffer, the consistency relies on
     // the lock in the id_mapper
+    using AbstractMailbox::Send;
     int Send(int tid, const Message & msg) override;
 
     void Recv(int tid, Message & msg) override;
@@ -57,6 +60,8 @@ class RdmaMailbox : public AbstractMailbox {
 
     void Sweep(int tid) override;
 
+    uint64_t Backlog() override;
+
  private:
     struct rbf_rmeta_t {
         uint64_t tail;  // write from here
@@ -97,6 +102,8 @@ class RdmaMailbox : public AbstractMailbox {
     Buffer * buffer_;
 
     vector<vector<mailbox_data_t>> pending_msgs;
+    // msgs in pending_msgs of all threads
+    std::atomic<uint64_t> num_pending_;
     rbf_rmeta_t *rmetas = NULL;
     rbf_lmeta_t *lmetas = NULL;
     pthread_spinlock_t *recv_locks = NULL;
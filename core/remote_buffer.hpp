@@ -10,22 +10,30 @@
 #include <memory>
 
 #include "glog/logging.h"
+#include "base/cpuinfo_util.hpp"
 #include "utils/config.hpp"
+#include "utils/mem_util.hpp"
 #include "utils/unit.hpp"
 
 class RemoteBuffer {
  public:
     RemoteBuffer() {
         config_ = Config::GetInstance();
-        remote_buffer_ = new char[config_->remote_buffer_sz];
-        memset(remote_buffer_, 0, config_->remote_buffer_sz);
+        remote_buffer_ = MemUtil::Alloc(config_->remote_buffer_sz, config_->global_hugepage_sz_mb, page_sz_);
+        CHECK(remote_buffer_ != NULL) << "Failed to allocate remote buffer";
+        // graph is read by the NIC and all cores alike, spread it over sockets
+        if (config_->global_enable_numa_placement) {
+            MemUtil::Interleave(remote_buffer_, config_->remote_buffer_sz, page_sz_, CPUInfoUtil::GetInstance()->GetTotalSocketCount());
+        }
+        // mapped memory is zeros already, only commit the pages
+        MemUtil::Prefault(remote_buffer_, config_->remote_buffer_sz, page_sz_, config_->global_num_threads);
 
         config_->vtx_store = remote_buffer_ + config_->vertex_offset;
         config_->kvstore = remote_buffer_ + config_->kvstore_offset;
     }
 
     ~RemoteBuffer() {
-        delete[] remote_buffer_;
+        MemUtil::Free(remote_buffer_, config_->remote_buffer_sz, page_sz_);
     }
 
     inline char* GetBuf() {
@@ -38,7 +46,8 @@ class RemoteBuffer {
 
  private:
     // layout: (kv-store) | send_buffer | recv_buffer | local_head_buffer | remote_head_buffer
-    char* remote_buffer_; 
+    char* remote_buffer_;
+    uint64_t page_sz_;
     Config* config_;
     // Node & node_;
 };
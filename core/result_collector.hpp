@@ -10,68 +10,198 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include <ext/hash_map>
 #include <algorithm>
 #include <iostream>
-#include <list>
 #include <vector>
+#include <deque>
 #include <mutex>
 #include <queue>
 #include <string>
 
 #include "base/type.hpp"
 #include "base/thread_safe_queue.hpp"
+#include "utils/config.hpp"
+#include "utils/tool.hpp"
 
 using __gnu_cxx::hash_map;
 using namespace std;
 
 struct reply {
     string hostname;
+    uint64_t req_id;
     uint64_t qid;
+    // results of a query are sent in chunks, numbered from 0
+    uint32_t chunk_id;
+    bool is_last;
     vector<value_t> results;
 };
 
 class Result_Collector {
  public:
-    void Register(uint64_t qid, string hostname) {
+    Result_Collector() {
+        window_ = Config::GetInstance()->result_window;
+        max_held_ = Config::GetInstance()->result_max_held;
+    }
+
+    // req_id is given by the client to match replies of outstanding queries
+    void Register(uint64_t qid, string hostname, uint64_t req_id = 0) {
         lock_guard<mutex> lck(m_mutex_);
-        reply_list_.push_front(move(hostname));
-        mp_[qid] = reply_list_.begin();
+        item & it = mp_[qid];
+        it.hostname = move(hostname);
+        it.req_id = req_id;
+        it.next_chunk = 0;
+        it.in_flight = 0;
+        it.dropped = false;
+        it.pending.clear();
     }
 
-    void InsertResult(uint64_t qid, vector<value_t> & data) {
-        m_mutex_.lock();
+    // push a chunk of results before the query finishes
+    // never waits, chunks beyond window_ unacked ones are held in the
+    // collector and released by Ack() as the client consumes earlier chunks,
+    // if max_held_ chunks are already held the client is too slow, held
+    // chunks are dropped and the query ends with an error
+    void InsertChunk(uint64_t qid, vector<value_t> & data) {
+        lock_guard<mutex> lck(m_mutex_);
         indexItr it = mp_.find(qid);
 
         if (it == mp_.end()) {
             cout << "ERROR: Impossible branch in Result_Collector!\n";
             exit(-1);
         }
+        if (it->second.dropped) {
+            data.clear();
+            return;
+        }
 
-        itemItr re_pos = it->second;
         reply re;
-        re.hostname = move(*re_pos);
+        re.hostname = it->second.hostname;
+        re.req_id = it->second.req_id;
+        re.qid = qid;
+        re.chunk_id = it->second.next_chunk++;
+        re.is_last = false;
         re.results = move(data);
+
+        if (window_ > 0 && it->second.in_flight >= window_) {
+            if (max_held_ > 0 && it->second.pending.size() >= max_held_) {
+                Drop(it, "Result dropped: client consumes chunks too slowly");
+                return;
+            }
+            it->second.pending.push_back(move(re));
+            return;
+        }
+        it->second.in_flight++;
+        reply_queue_.Push(move(re));
+    }
+
+    // push the last chunk of results
+    // it follows the held chunks of the query, if any
+    void InsertResult(uint64_t qid, vector<value_t> & data) {
+        lock_guard<mutex> lck(m_mutex_);
+        indexItr it = mp_.find(qid);
+
+        if (it == mp_.end()) {
+            cout << "ERROR: Impossible branch in Result_Collector!\n";
+            exit(-1);
+        }
+        // the client already got the error as last chunk
+        if (it->second.dropped) {
+            data.clear();
+            mp_.erase(it);
+            return;
+        }
+
+        reply re;
+        re.hostname = it->second.hostname;
+        re.req_id = it->second.req_id;
         re.qid = qid;
-        reply_list_.erase(re_pos);
-        mp_.erase(it);
+        re.chunk_id = it->second.next_chunk;
+        re.is_last = true;
+        re.results = move(data);
 
-        m_mutex_.unlock();
+        if (!it->second.pending.empty()) {
+            it->second.pending.push_back(move(re));
+            return;
+        }
+        mp_.erase(it);
         reply_queue_.Push(move(re));
     }
 
+    // a chunk of qid is consumed by client
+    // release the next held chunk of qid, if any
+    void Ack(uint64_t qid) {
+        lock_guard<mutex> lck(m_mutex_);
+        indexItr it = mp_.find(qid);
+        if (it == mp_.end() || it->second.dropped || it->second.in_flight == 0) {
+            return;
+        }
+        it->second.in_flight--;
+
+        // the last chunk is not counted in the window
+        while (!it->second.pending.empty() && (window_ <= 0 || it->second.in_flight < window_)) {
+            reply re = move(it->second.pending.front());
+            it->second.pending.pop_front();
+            if (re.is_last) {
+                mp_.erase(it);
+                reply_queue_.Push(move(re));
+                return;
+            }
+            it->second.in_flight++;
+            reply_queue_.Push(move(re));
+        }
+    }
+
+    // the query failed, end it with reason as last chunk
+    void Fail(uint64_t qid, const string & reason) {
+        lock_guard<mutex> lck(m_mutex_);
+        indexItr it = mp_.find(qid);
+        if (it == mp_.end() || it->second.dropped) {
+            return;
+        }
+        Drop(it, reason);
+    }
+
     void Pop(reply & result) {
         reply_queue_.WaitAndPop(result);
     }
 
  private:
-    // hostname, result;
-    typedef string item;
-    typedef list<item>::iterator itemItr;
-    typedef hash_map<uint64_t, itemItr> index;
+    struct item {
+        string hostname;
+        uint64_t req_id;
+        uint32_t next_chunk;
+        // chunks sent but not acked
+        int in_flight;
+        // held chunks were dropped, later results of the query are discarded
+        bool dropped;
+        // chunks held back by the window, in chunk order
+        deque<reply> pending;
+    };
+
+    typedef hash_map<uint64_t, item> index;
     typedef index::iterator indexItr;
 
+    // end the query of it with an error as last chunk, the item is kept
+    // until InsertResult() so that later chunks are discarded
+    void Drop(indexItr it, const string & reason) {
+        it->second.dropped = true;
+        it->second.pending.clear();
+
+        value_t v;
+        Tool::str2str(reason, v);
+        reply re;
+        re.hostname = it->second.hostname;
+        re.req_id = it->second.req_id;
+        re.qid = it->first;
+        re.chunk_id = it->second.next_chunk++;
+        re.is_last = true;
+        re.results.push_back(move(v));
+        reply_queue_.Push(move(re));
+    }
+
     mutex m_mutex_;
-    list<item> reply_list_;
     ThreadSafeQueue<reply> reply_queue_;
     index mp_;
+    int window_;
+    // max number of chunks held for one query
+    size_t max_held_;
 };
 
 #endif /* RESULT_COLLECTOR_HPP_ */
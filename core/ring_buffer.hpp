@@ -0,0 +1,94 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+
+#include "base/serialization.hpp"
+#include "utils/unit.hpp"
+
+// Framing of msgs in the recv ring buffers of RdmaMailbox
+//
+// | header: data_sz | data (aligned to 8B) | footer: data_sz |
+//
+// The writer puts a whole frame into the ring with one-sided writes, the reader
+// polls the header and waits until the footer shows up before taking the data.
+// Consumed bytes are reset to 0 so that an empty header means no msg.
+
+// size of the frame for data_sz bytes
+inline uint64_t RingFrameSize(uint64_t data_sz) {
+    return sizeof(uint64_t) + ceil(data_sz, sizeof(uint64_t)) + sizeof(uint64_t);
+}
+
+// write frame of data into buf, buf should hold RingFrameSize(data_sz) bytes
+inline void RingEncode(char * buf, const char * data, uint64_t data_sz) {
+    *((uint64_t *)buf) = data_sz;  // header
+    buf += sizeof(uint64_t);
+
+    memcpy(buf, data, data_sz);    // data
+    buf += ceil(data_sz, sizeof(uint64_t));
+
+    *((uint64_t *)buf) = data_sz;  // footer
+}
+
+// check if there is a frame at head
+inline bool RingPoll(char * rbf, uint64_t rbf_sz, uint64_t head) {
+    volatile uint64_t msg_size = *(volatile uint64_t *)(rbf + head % rbf_sz);  // header
+    return msg_size != 0;
+}
+
+// take the frame at head into um and clear it
+// return the head after the frame, or head itself if there is no frame
+inline uint64_t RingDecode(char * rbf, uint64_t rbf_sz, uint64_t head, obinstream & um) {
+    volatile uint64_t pop_msg_size = *(volatile uint64_t *)(rbf + head % rbf_sz);  // header
+    if (!pop_msg_size) {
+        return head;
+    }
+
+    uint64_t to_footer = sizeof(uint64_t) + ceil(pop_msg_size, sizeof(uint64_t));
+    volatile uint64_t * footer = (volatile uint64_t *)(rbf + (head + to_footer) % rbf_sz);  // footer
+
+    // Make sure RDMA trans is done
+    while (*footer != pop_msg_size) {
+        _mm_pause();
+        assert(*footer == 0 || *footer == pop_msg_size);
+    }
+
+    // IF it is a ring(rare situation)
+    uint64_t start = (head + sizeof(uint64_t)) % rbf_sz;
+    uint64_t end = (head + sizeof(uint64_t) + pop_msg_size) % rbf_sz;
+    if (start > end) {
+        char* tmp_buf = new char[pop_msg_size];
+        memcpy(tmp_buf, rbf + start, pop_msg_size - end);
+        memcpy(tmp_buf + pop_msg_size - end, rbf, end);
+
+        // register tmp_buf into obinstream,
+        // the obinstream will charge the memory of buf, including memory release
+        um.assign(tmp_buf, pop_msg_size, 0);
+
+        // clean
+        memset(rbf + start, 0, pop_msg_size - end);
+        memset(rbf, 0, ceil(end, sizeof(uint64_t)));
+    } else {
+        char* tmp_buf = new char[pop_msg_size];
+        memcpy(tmp_buf, rbf + start, pop_msg_size);
+
+        um.assign(tmp_buf, pop_msg_size, 0);
+
+        // clean the data
+        memset(rbf + start, 0, ceil(pop_msg_size, sizeof(uint64_t)));
+    }
+
+    // clear header and footer
+    *(uint64_t *)(rbf + head % rbf_sz) = 0;
+    *footer = 0;
+
+    // advance the pointer
+    return head + 2 * sizeof(uint64_t) + ceil(pop_msg_size, sizeof(uint64_t));
+}
@@ -138,3 +138,11 @@ bool TCPMailbox::TryRecv(int tid, Message & msg) {
 
 void TCPMailbox::Recv(int tid, Message & msg) { return; }
 void TCPMailbox::Sweep(int tid) { return; }
+
+uint64_t TCPMailbox::Backlog() {
+    uint64_t num = 0;
+    for (int i = 0; i < config_->global_num_threads; i++) {
+        num += local_msgs[i]->Size();
+    }
+    return num;
+}
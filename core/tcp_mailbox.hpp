@@ -66,8 +66,12 @@ class TCPMailbox : public AbstractMailbox {
     ~TCPMailbox();
 
     void Init(vector<Node> & nodes, vector<Node> & remote_nodes) override;
+    using AbstractMailbox::Send;
     int Send(int tid, const Message & msg) override;
     void Recv(int tid, Message & msg) override;
     bool TryRecv(int tid, Message & msg) override;
     void Sweep(int tid) override;
+
+    // local msgs only, zmq keeps remote ones
+    uint64_t Backlog() override;
 };
@@ -10,6 +10,8 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 Client::Client(string cfg_fname) : fname_(cfg_fname) {
     id = -1;
     handler = -1;
+    next_req_id_ = 0;
+    priority_ = PRIORITY_AUTO;
 }
 
 void Client::Init() {
@@ -18,6 +20,10 @@ void Client::Init() {
     master_ = GetNodeById(nodes_, 0);
     nodes_.pop_back();
     cc_.Init(nodes_);
+
+    char hostname[HOST_NAME_MAX];
+    gethostname(hostname, HOST_NAME_MAX);
+    hostname_ = string(hostname);
 }
 
 void Client::RequestWorker() {
@@ -34,40 +40,95 @@ void Client::RequestWorker() {
     cout << "[Client] Client " << id << " recvs a REP: get available worker_node" << handler - 1 << endl << endl;
 }
 
-string Client::CommitQuery(string query) {
+void Client::StartSession() {
+    RequestWorker();
+}
+
+uint64_t Client::SubmitQuery(string query, const vector<string>& params) {
     ibinstream m;
-    obinstream um;
+    uint64_t req_id = next_req_id_++;
 
-    char hostname[HOST_NAME_MAX];
-    gethostname(hostname, HOST_NAME_MAX);
-    string host_str(hostname);
-    m << host_str;
+    m << hostname_;
+    m << (int)REQ_QUERY;
+    m << req_id;
     m << query;
+    m << params;
+    m << priority_;
     cc_.Send(handler, m);
-    cout << "[Client] Client posts the query to worker_node" << handler - 1 << endl << endl;
+    outstanding_[req_id] = query;
+    cout << "[Client] Client posts the query " << req_id << " to worker_node" << handler - 1 << endl << endl;
+    return req_id;
+}
 
+bool Client::FetchPage(uint64_t& req_id, string& query, vector<value_t>& page, uint64_t& time_) {
+    obinstream um;
     cc_.Recv(handler, um);
 
-    string result;
     string hname;
-    uint64_t time_;
-    vector<value_t> values;
+    uint64_t qid;
+    uint32_t chunk_id;
+    bool is_last;
     um >> hname;
-    um >> values;
+    um >> req_id;
+    um >> qid;
+    um >> chunk_id;
+    um >> is_last;
+    um >> page;
     um >> time_;
 
-    result = "";
+    auto itr = outstanding_.find(req_id);
+    if (itr != outstanding_.end()) {
+        query = itr->second;
+        if (is_last) {
+            outstanding_.erase(itr);
+        }
+    }
+
+    if (!is_last) {
+        // let worker send more
+        ibinstream m;
+        m << hostname_;
+        m << (int)REQ_NEXT;
+        m << req_id;
+        m << qid;
+        cc_.Send(handler, m);
+    }
+    return is_last;
+}
+
+uint64_t Client::WaitResult(string& result) {
+    uint64_t req_id;
+    uint64_t time_;
+    string query;
+    vector<value_t> page;
+    while (!FetchPage(req_id, query, page, time_)) {
+        vector<value_t>& values = partial_[req_id];
+        values.insert(values.end(), make_move_iterator(page.begin()), make_move_iterator(page.end()));
+    }
+
+    vector<value_t> values;
+    auto itr = partial_.find(req_id);
+    if (itr != partial_.end()) {
+        values = move(itr->second);
+        partial_.erase(itr);
+    }
+    values.insert(values.end(), make_move_iterator(page.begin()), make_move_iterator(page.end()));
+
+    result = "Query '" + query + "' result: \n";
     if (values.size() == 0) {
-        result = "Query '" + query + "' result: \n";
         result += "=>Empty\n";
     } else {
-        result = "Query '" + query + "' result: \n";
         for (auto& v : values) {
             result += "=>" + Tool::DebugString(v) + "\n";
         }
     }
 
-    result += "[Timer] ";
+    result += format_time(time_);
+    return req_id;
+}
+
+string Client::format_time(uint64_t time_) {
+    string result = "[Timer] ";
     #ifdef RECORDRESULT
         ofstream outputfile;
         outputfile.open("tmp/timerecord.txt", std::ios_base::app);
@@ -81,7 +142,14 @@ string Client::CommitQuery(string query) {
         ss << std::fixed << std::setprecision(2) << (time_ / 1000.0);
         result += ss.str() + " ms for ProcessQuery";
     }
+    return result;
+}
 
+string Client::CommitQuery(string query) {
+    SubmitQuery(query);
+
+    string result;
+    WaitResult(result);
     return result;
 }
 
@@ -98,21 +166,109 @@ void Client::run_query(string query, string& result, bool isBatch) {
     }
 }
 
+// write results into ofname page by page as they arrive
+void Client::run_export(string query, string ofname) {
+    cout << endl;
+    cout << "[Client] Processing query : " << query << endl;
+
+    RequestWorker();
+    SubmitQuery(query);
+
+    std::ofstream ofs(ofname, std::ofstream::out);
+    ofs << "Query '" << query << "' result: " << endl;
+
+    uint64_t req_id;
+    uint64_t time_;
+    uint64_t count = 0;
+    vector<value_t> page;
+    bool is_last = false;
+    while (!is_last) {
+        is_last = FetchPage(req_id, query, page, time_);
+        for (auto& v : page) {
+            ofs << "=>" << Tool::DebugString(v) << endl;
+        }
+        count += page.size();
+        ofs.flush();
+    }
+
+    if (count == 0) {
+        ofs << "=>Empty" << endl;
+    }
+    ofs << format_time(time_);
+    cout << "[Client] " << count << " results written into " << ofname << endl << endl;
+}
+
+// submit queries in fname to one worker, keeping up to concurrency queries outstanding
+void Client::run_batch(string fname, int concurrency, string& result) {
+    ifstream file(fname.c_str());
+    if (!file) {
+        cout << "[Client][ERROR]: " << fname << " does not exist." << endl << endl;
+        return;
+    }
+
+    // query or template with params
+    vector<pair<string, vector<string>>> queries;
+    string query;
+    while (std::getline(file, query)) {
+        if (!trim_str(query)) {
+            cout << "[Client][Error]: Empty Query" << endl << endl;
+            return;
+        }
+
+        vector<string> params;
+        Tool::split(query, "\t", params);
+        query = params[0];
+        params.erase(params.begin());
+        queries.emplace_back(query, params);
+    }
+
+    StartSession();
+
+    // req_id -> index in queries, so that results are in the order of the file
+    map<uint64_t, int> req_idx;
+    vector<string> results(queries.size());
+    int next = 0;
+    while (next < queries.size() || NumOutstanding() > 0) {
+        while (next < queries.size() && NumOutstanding() < concurrency) {
+            req_idx[SubmitQuery(queries[next].first, queries[next].second)] = next;
+            next++;
+        }
+
+        string res;
+        uint64_t req_id = WaitResult(res);
+        auto itr = req_idx.find(req_id);
+        if (itr != req_idx.end()) {
+            results[itr->second] = move(res);
+            req_idx.erase(itr);
+        }
+    }
+
+    for (auto& res : results) {
+        result += res + "\n";
+    }
+}
+
 void Client::print_help() {
     cout << endl;
     cout << "Grasper commands: " << endl;
     cout << "    help                display general help infomation" << endl;
     cout << "    help index          display help infomation for building index" << endl;
     cout << "    help config         display help infomation for setting config" << endl;
+    cout << "    help update         display help infomation for updating graph" << endl;
     cout << "    help emu            display help infomation for running emulation of througput test" << endl;
     cout << "    quit                quit from console" << endl;
     cout << "    Grasper <args>       run Gremlin-Like queries" << endl;
+    cout << "        -p <priority>       high, low or auto, given before -q, default auto" << endl;
+    cout << "                            auto runs queries scanning all vertices/edges as low" << endl;
     cout << "        -q <query> [<args>] a single query input by user" << endl;
     cout << "           -o <file>           output results into <file>" << endl;
     cout << "        -f <file> [<args>]  a single query from <file>" << endl;
     cout << "           -o <file>           output results into <file>" << endl;
     cout << "        -b <file> [<args>]  a set of queries configured by <file> (batch-mode)" << endl;
     cout << "           -o <file>           output results into <file>" << endl;
+    cout << "           -c <num>            keep up to <num> queries running, default 1" << endl;
+    cout << "           a line \"<template>\\t<param>\\t...\" runs a query template, where" << endl;
+    cout << "           placeholders $<name> are bound to params in order of appearance" << endl;
     cout << endl;
 }
 
@@ -153,6 +309,22 @@ void Client::print_set_config_help() {
     cout << endl;
 }
 
+void Client::print_update_help() {
+    cout << endl;
+    cout << "Help information for updating graph:" << endl;
+    cout << endl;
+    cout << "Usage:" << endl;
+    cout << "    AddV(<vertex_label>)" << endl;
+    cout << "    AddE(<edge_label>,<src_vid>,<dst_vid>)" << endl;
+    cout << "    SetProperty(V,<vid>,<property_key>,<value>)" << endl;
+    cout << "    SetProperty(E,<src_vid>,<dst_vid>,<property_key>,<value>)" << endl;
+    cout << endl;
+    cout << "Example:" << endl;
+    cout << "    Grasper -q AddV(person)" << endl;
+    cout << "    Grasper -q SetProperty(V,1,name,\"marko\")" << endl;
+    cout << endl;
+}
+
 void Client::print_run_emu_help() {
     cout << endl;
     cout << "Help information for running emulator mode:" << endl;
@@ -162,10 +334,17 @@ void Client::print_run_emu_help() {
     cout << endl;
     cout << "About the configuration file of emulation:" << endl;
     cout << "    The config file contains at least 3 lines:" << endl;
-    cout << "1       <seconds_of_emulation> <parallel_fexpert>" << endl;
+    cout << "1       <seconds_of_emulation> <parallel_fexpert> [<arrival> <rate> <warmup_seconds>]" << endl;
     cout << "2       <query_count, i.e., n>" << endl;
     cout << "3~n+2   <query_with_$RAND> <property_key_of_rand> <ratio>" << endl;
     cout << endl;
+    cout << "    <arrival> is one of closed (default), fixed, poisson." << endl;
+    cout << "    closed: each node keeps at most <parallel_fexpert> queries running." << endl;
+    cout << "    fixed/poisson: each node sends <rate> queries/sec in open loop," << endl;
+    cout << "        latency is counted from the scheduled time of each query." << endl;
+    cout << "    Queries started within <warmup_seconds> are excluded from statistics." << endl;
+    cout << "    Latency percentiles are written to CDF.txt and Emu_Result.json." << endl;
+    cout << endl;
     cout << "Example command:" << endl;
     cout << "    Grasper -q emu thpt_config_twitter" << endl;
     cout << endl;
@@ -175,6 +354,11 @@ void Client::print_run_emu_help() {
     cout << "g.V().has(\"C\",\"$RAND\").properties(\"A\")  C   20" << endl;
     cout << "g.V().hasKey(\"A\").hasLabel(\"O\").has(\"F\",$RAND)   F    10" << endl;
     cout << endl;
+    cout << "Example config file with open-loop arrival:" << endl;
+    cout << "60 1000 poisson 2000 10" << endl;
+    cout << "1" << endl;
+    cout << "g.V().has(\"C\",\"$RAND\").properties(\"A\")  C   1" << endl;
+    cout << endl;
 }
 
 bool Client::trim_str(string& str) {
@@ -190,23 +374,9 @@ bool Client::trim_str(string& str) {
 
 void Client::run_console(string query_fname) {
     if (query_fname != "") {
-        string query, result;
-
-        ifstream file(query_fname.c_str());
-        if (!file) {
-          cout << "[Client][ERROR]: " << query_fname << " does not exist." << endl << endl;
-          return;
-        }
+        string result;
 
-        while (std::getline(file, query)) {
-            if (!trim_str(query)) {
-              cout << "[Client][Error]: Empty Query" << endl << endl;
-              return;
-            }
-
-            run_query(query, result, true);
-            query.clear();
-        }
+        run_batch(query_fname, 1, result);
 
         cout << "[Client] result: " << result << endl << endl;
         return;
@@ -238,6 +408,11 @@ next:
             continue;
         }
 
+        if (cmd == "help update") {
+            print_update_help();
+            continue;
+        }
+
         if (cmd == "help emu") {
             print_run_emu_help();
             continue;
@@ -261,6 +436,8 @@ next:
                 string query, result;
                 string fname, bname, ofname;
                 bool s_enable = false, f_enable = false, b_enable = false, o_enable = false;
+                int concurrency = 1;
+                int priority = PRIORITY_AUTO;
 
                 // get parameters
                 while (cmd_ss >> token) {
@@ -280,6 +457,23 @@ next:
                         // set of queries
                         cmd_ss >> bname;
                         b_enable = true;
+                    } else if (token == "-c") {
+                        // number of outstanding queries in batch-mode
+                        if (!(cmd_ss >> concurrency) || concurrency <= 0) {
+                            goto failed;
+                        }
+                    } else if (token == "-p") {
+                        // scheduling priority of queries
+                        cmd_ss >> token;
+                        if (token == "high") {
+                            priority = PRIORITY_HIGH;
+                        } else if (token == "low") {
+                            priority = PRIORITY_LOW;
+                        } else if (token == "auto") {
+                            priority = PRIORITY_AUTO;
+                        } else {
+                            goto failed;
+                        }
                     } else if (token == "-o") {
                         // output to file
                         cmd_ss >> ofname;
@@ -290,14 +484,14 @@ next:
                 }  // Grasper_while
 
                 if (!s_enable && !f_enable && !b_enable) goto failed;  // meaningless
+                SetPriority(priority);
 
                 if (s_enable) {  // -s <query>
-                    run_query(query, result, false);
-
                     if (o_enable) {
-                        std::ofstream ofs(ofname, std::ofstream::out);
-                        ofs << result;
+                        // stream results into file
+                        run_export(query, ofname);
                     } else {
+                        run_query(query, result, false);
                         cout << "[Client] result: " << result << endl << endl;
                     }
                 }
@@ -318,12 +512,11 @@ next:
                         goto next;
                     }
 
-                    run_query(query, result, false);
-
                     if (o_enable) {
-                        std::ofstream ofs(ofname, std::ofstream::out);
-                        ofs << result;
+                        // stream results into file
+                        run_export(query, ofname);
                     } else {
+                        run_query(query, result, false);
                         cout << "[Client] result: " << result << endl << endl;
                     }
                 }
@@ -331,22 +524,7 @@ next:
                 if (b_enable) {  // -b <file>
                     cout << "[Client] b_enable" << endl;
 
-                    ifstream file(bname.c_str());
-                    if (!file) {
-                        cout << "[Client][ERROR]: " << bname << " does not exist." << endl << endl;
-                        goto next;
-                    }
-
-                    while (std::getline(file, query)) {
-                        if (!trim_str(query)) {
-                            cout << "[Client][Error]: Empty Query" << endl << endl;
-                            goto next;
-                        }
-
-                        run_query(query, result, true);
-
-                        query.clear();
-                    }
+                    run_batch(bname, concurrency, result);
 
                     if (o_enable) {
                         std::ofstream ofs(ofname, std::ofstream::out);
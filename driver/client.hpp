@@ -11,6 +11,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <map>
 #include <set>
 
 #include <unistd.h>
@@ -36,6 +37,22 @@ class Client {
 
     void run_console(string query_fname);
 
+    // Asynchronous API
+    // StartSession() picks a worker, then queries are submitted to it without
+    // waiting for replies and results come back tagged with their req_id.
+    void StartSession();
+    // with params, query is a template with placeholders "$name" bound to params
+    // in order of appearance, and its parsed plan is cached by the worker
+    uint64_t SubmitQuery(string query, const vector<string>& params = vector<string>());
+    // block until any outstanding query finishes, return its req_id
+    uint64_t WaitResult(string& result);
+    // cursor over results: block for the next page of any outstanding query,
+    // return true if it is the last page of that query
+    bool FetchPage(uint64_t& req_id, string& query, vector<value_t>& page, uint64_t& time_);
+    int NumOutstanding() { return outstanding_.size(); }
+    // Priority_T of queries submitted afterwards, default auto
+    void SetPriority(int priority) { priority_ = priority; }
+
  private:
     int id;
     string fname_;
@@ -44,14 +61,26 @@ class Client {
     ClientConnection cc_;
     int handler;
 
+    string hostname_;
+    uint64_t next_req_id_;
+    int priority_;
+    // req_id -> query
+    map<uint64_t, string> outstanding_;
+    // req_id -> pages received by WaitResult
+    map<uint64_t, vector<value_t>> partial_;
+
     void RequestWorker();
     string CommitQuery(string query);
 
     void run_query(string query, string& result, bool isBatch);
+    void run_export(string query, string ofname);
+    void run_batch(string fname, int concurrency, string& result);
 
+    static string format_time(uint64_t time_);
     static void print_help();
     static void print_build_index_help();
     static void print_set_config_help();
+    static void print_update_help();
     static void print_run_emu_help();
     static bool trim_str(string& str);
 };
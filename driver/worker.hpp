@@ -7,6 +7,10 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #ifndef WORKER_HPP_
 #define WORKER_HPP_
 
+#include <map>
+#include <random>
+#include <sstream>
+
 #include "third_party/zmq.hpp"
 #include "utils/global.hpp"
 #include "utils/config.hpp"
@@ -28,6 +32,8 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "core/progress_monitor.hpp"
 #include "core/result_collector.hpp"
 #include "core/logical_plan.hpp"
+#include "core/admission_control.hpp"
+#include "core/plan_cache.hpp"
 
 #include "storage/metadata.hpp"
 #include "storage/mpi_snapshot.hpp"
@@ -41,6 +47,8 @@ class Worker {
 
         index_store_ = NULL;
         parser_ = NULL;
+        plan_cache_ = NULL;
+        queue_ = NULL;
         receiver_ = NULL;
         // worker_listener_ = NULL;
         remote_listener_ = NULL;
@@ -59,9 +67,15 @@ class Worker {
             delete senders_[i];
         }
 
+        for (auto & kv : result_senders_) {
+            delete kv.second;
+        }
+
         delete receiver_;
         // delete worker_listener_;
         delete remote_listener_;
+        delete plan_cache_;
+        delete queue_;
         delete parser_;
         delete index_store_;
         delete rc_;
@@ -76,6 +90,8 @@ class Worker {
         // init the necessary components
         index_store_ = new IndexStore();
         parser_ = new Parser(index_store_);
+        plan_cache_ = new PlanCache(parser_);
+        queue_ = new AdmissionQueue(config_->global_max_inflight_queries);
         receiver_ = new zmq::socket_t(context_, ZMQ_PULL);
         // worker_listener_ = new zmq::socket_t(context_, ZMQ_REP);
         remote_listener_ = new zmq::socket_t(context_, ZMQ_PULL);
@@ -111,7 +127,7 @@ class Worker {
     }
 
     // evaluate the throughput
-    void RunEMU(string& cmd, string& client_host) {
+    void RunEMU(string& cmd, string& client_host, uint64_t req_id) {
         string emu_host = "EMUHOST";
         qid_t qid;
         bool is_main_worker = false;
@@ -123,7 +139,11 @@ class Worker {
             is_main_worker = true;
             ibinstream in;
             in << emu_host;
+            in << (int)REQ_QUERY;
+            in << (uint64_t)0;
             in << cmd;
+            in << vector<string>();
+            in << (int)PRIORITY_AUTO;
 
             for (int i = 0; i < senders_.size(); i++) {
                 zmq::message_t msg(in.size());
@@ -132,7 +152,7 @@ class Worker {
             }
 
             qid = qid_t(my_node_.get_local_rank(), ++num_query);
-            rc_->Register(qid.value(), client_host);
+            rc_->Register(qid.value(), client_host, req_id);
         }
 
         cmd = cmd.substr(3);
@@ -142,11 +162,27 @@ class Worker {
             cout << "file not found: " << file_name << endl;
             return;
         }
-        uint64_t test_time, parrellfexpert, ratio;
-        ifs >> test_time >> parrellfexpert;
+        // first line: <seconds> <parallel_fexpert> [<arrival> <rate> <warmup_seconds>]
+        uint64_t test_time, parrellfexpert, warmup_time = 0;
+        string arrival = "closed";
+        double rate = 0;
+        string line;
+        getline(ifs, line);
+        istringstream iss(line);
+        iss >> test_time >> parrellfexpert;
+        iss >> arrival >> rate >> warmup_time;
+        if (arrival != "closed" && arrival != "fixed" && arrival != "poisson") {
+            cout << "unknown arrival: " << arrival << endl;
+            return;
+        }
+        if (arrival != "closed" && rate <= 0) {
+            cout << "arrival rate must be positive for " << arrival << " arrival" << endl;
+            return;
+        }
 
         // transfer sec to usec
         test_time *= 1000000;
+        warmup_time *= 1000000;
         int n_type = 0;
         ifs >> n_type;
         assert(n_type > 0);
@@ -188,18 +224,35 @@ class Worker {
 
         is_emu_mode_ = true;
         srand(time(NULL));
-        regex match("\\$RAND");
 
-        vector<string> commited_queries;
+        // inter-arrival time in usec for open-loop arrival
+        mt19937_64 generator(time(NULL) + my_node_.get_local_rank());
+        exponential_distribution<double> poisson_interval(arrival == "poisson" ? rate / 1000000 : 1);
+        double fixed_interval = arrival == "fixed" ? 1000000 / rate : 0;
+
+        // query type and value of $RAND
+        vector<pair<int, string>> commited_queries;
 
         // suppose one query will be generated within 10 us
         commited_queries.reserve(test_time / 10);
         // wait for all nodes
         worker_barrier(my_node_);
 
-        thpt_monitor_->StartEmu();
+        thpt_monitor_->StartEmu(warmup_time);
         uint64_t start = timer::get_usec();
+        double next_arrival = start;
         while (timer::get_usec() - start < test_time) {
+            // in open-loop arrival, queries are scheduled independent of completions,
+            // parallel_fexpert only bounds outstanding queries and the waiting time is
+            // still counted into latency from the scheduled time
+            uint64_t scheduled_time = 0;
+            if (arrival != "closed") {
+                if (timer::get_usec() < next_arrival) {
+                    continue;
+                }
+                scheduled_time = next_arrival;
+            }
+
             if (thpt_monitor_->WorksRemaining() > parrellfexpert) {
                 continue;
             }
@@ -207,7 +260,6 @@ class Worker {
             int query_type = mymath::get_distribution(rand(), ratios);
 
             // get query info
-            string query_temp = queries[query_type];
             Element_T element_type = query_infos[query_type].first;
             int pid = query_infos[query_type].second;
 
@@ -218,13 +270,18 @@ class Worker {
                 break;
             }
 
-            query_temp = regex_replace(query_temp, match, rand_value);
-            // run query
-            ParseAndSendQuery(query_temp, emu_host, query_type);
-            commited_queries.push_back(move(query_temp));
+            // run query, the template is parsed only once
+            ParseAndSendQuery(queries[query_type], {rand_value}, emu_host, 0, query_type, scheduled_time);
+            commited_queries.emplace_back(query_type, move(rand_value));
             if (is_main_worker) {
                 thpt_monitor_->PrintThroughput();
             }
+
+            if (arrival == "fixed") {
+                next_arrival += fixed_interval;
+            } else if (arrival == "poisson") {
+                next_arrival += poisson_interval(generator);
+            }
         }
         thpt_monitor_->StopEmu();
 
@@ -234,33 +291,77 @@ class Worker {
         }
 
         double thpt = thpt_monitor_->GetThroughput();
-        map<int, vector<uint64_t>> latency_map;
-        thpt_monitor_->GetLatencyMap(latency_map);
+        map<int, LatencyHistogram> histograms;
+        thpt_monitor_->GetHistograms(histograms);
 
         if (my_node_.get_local_rank() == 0) {
             vector<double> thpt_list;
-            vector<map<int, vector<uint64_t>>> map_list;
+            vector<map<int, LatencyHistogram>> histograms_list;
             thpt_list.resize(my_node_.get_local_size());
-            map_list.resize(my_node_.get_local_size());
+            histograms_list.resize(my_node_.get_local_size());
             master_gather(my_node_, false, thpt_list);
-            master_gather(my_node_, false, map_list);
+            master_gather(my_node_, false, histograms_list);
+            thpt_list[0] = thpt;
 
+            // merge histograms from all nodes
+            for (int i = 1; i < my_node_.get_local_size(); i++) {
+                for (auto& item : histograms_list[i]) {
+                    histograms[item.first].Merge(item.second);
+                }
+            }
 
             cout << "#################################" << endl;
             cout << "Emulator result with " << n_type << " classes and parrell fexpert: " << parrellfexpert << endl;
-            cout << "Throughput of node 0: " << thpt << " K queries/sec" << endl;
-            for (int i = 1; i < my_node_.get_local_size(); i++) {
-                thpt += thpt_list[i];
+            if (arrival != "closed") {
+                cout << "Open-loop " << arrival << " arrival with rate " << rate << " queries/sec per node" << endl;
+            }
+            double total_thpt = 0;
+            for (int i = 0; i < my_node_.get_local_size(); i++) {
+                total_thpt += thpt_list[i];
                 cout << "Throughput of node " << i << ": " << thpt_list[i] << " K queries/sec" << endl;
             }
-            cout << "Total Throughput : " << thpt << " K queries/sec" << endl;
+            cout << "Total Throughput : " << total_thpt << " K queries/sec" << endl;
+            for (auto& item : histograms) {
+                cout << "Latency of Q" << item.first << " (usec): p50 " << item.second.Percentile(50)
+                     << ", p99 " << item.second.Percentile(99) << ", p999 " << item.second.Percentile(99.9) << endl;
+            }
             cout << "#################################" << endl;
 
-            map_list[0] = move(latency_map);
-            thpt_monitor_->PrintCDF(map_list);
+            thpt_monitor_->PrintCDF(histograms);
+
+            // machine-readable result
+            ofstream jfs("Emu_Result.json", ofstream::out);
+            jfs << "{" << endl;
+            jfs << "  \"arrival\": \"" << arrival << "\"," << endl;
+            jfs << "  \"rate_per_node\": " << rate << "," << endl;
+            jfs << "  \"duration_sec\": " << test_time / 1000000 << "," << endl;
+            jfs << "  \"warmup_sec\": " << warmup_time / 1000000 << "," << endl;
+            jfs << "  \"parallel_fexpert\": " << parrellfexpert << "," << endl;
+            jfs << "  \"throughput_kqps\": {\"total\": " << total_thpt << ", \"per_node\": [";
+            for (int i = 0; i < my_node_.get_local_size(); i++) {
+                jfs << (i == 0 ? "" : ", ") << thpt_list[i];
+            }
+            jfs << "]}," << endl;
+            jfs << "  \"latency_us\": [" << endl;
+            for (auto itr = histograms.begin(); itr != histograms.end(); itr++) {
+                LatencyHistogram& h = itr->second;
+                jfs << "    {\"type\": " << itr->first
+                    << ", \"query\": \"" << Tool::escape_json(queries[itr->first]) << "\""
+                    << ", \"count\": " << h.Count()
+                    << ", \"min\": " << h.Min()
+                    << ", \"mean\": " << h.Mean()
+                    << ", \"p50\": " << h.Percentile(50)
+                    << ", \"p90\": " << h.Percentile(90)
+                    << ", \"p99\": " << h.Percentile(99)
+                    << ", \"p999\": " << h.Percentile(99.9)
+                    << ", \"max\": " << h.Max() << "}"
+                    << (next(itr) == histograms.end() ? "" : ",") << endl;
+            }
+            jfs << "  ]" << endl;
+            jfs << "}" << endl;
         } else {
             slave_gather(my_node_, false, thpt);
-            slave_gather(my_node_, false, latency_map);
+            slave_gather(my_node_, false, histograms);
         }
 
         // output all commited_queries to file
@@ -268,7 +369,7 @@ class Worker {
         ofstream ofs(ofname, ofstream::out);
         ofs << commited_queries.size() << endl;
         for (auto& query : commited_queries) {
-            ofs << query << endl;
+            ofs << PlanCache::Substitute(queries[query.first], {query.second}) << endl;
         }
 
         is_emu_mode_ = false;
@@ -284,20 +385,38 @@ class Worker {
     }
 
     // parse the query string to vector<expert_obj> as the logical query plan
-    void ParseAndSendQuery(string query, string client_host, int query_type = -1) {
+    // with params, query is a template and its plan is cached
+    // priority is Priority_T, auto takes scans of all vertices/edges as low
+    void ParseAndSendQuery(string query, const vector<string>& params, string client_host, uint64_t req_id = 0, int query_type = -1, uint64_t start_time = 0, int priority = PRIORITY_AUTO) {
         qid_t qid(my_node_.get_local_rank(), ++num_query);
-        thpt_monitor_->RecordStart(qid.value(), query_type);
+        thpt_monitor_->RecordStart(qid.value(), query_type, start_time);
 
-        rc_->Register(qid.value(), client_host);
+        rc_->Register(qid.value(), client_host, req_id);
+
+        // cached plans may not use the new index
+        if (query.find("BuildIndex") == 0) {
+            plan_cache_->Clear();
+        }
 
         vector<Expert_Object> experts;
         string error_msg;
-        bool success = parser_->Parse(query, experts, error_msg);
+        bool success;
+        if (params.empty()) {
+            success = parser_->Parse(query, experts, error_msg);
+        } else {
+            success = plan_cache_->Parse(query, params, experts, error_msg);
+        }
 
         if (success) {
             LogicPlan plan(qid);
+            if (priority == PRIORITY_AUTO) {
+                // g.V() or g.E() without index starts from every element
+                bool full_scan = experts[0].expert_type == EXPERT_T::INIT && experts[0].params.size() == 1;
+                priority = full_scan ? PRIORITY_LOW : PRIORITY_HIGH;
+            }
+            plan.priority = priority;
             plan.Feed(experts);
-            queue_.Push(plan);
+            queue_->Push(move(plan));
         } else {
             value_t v;
             Tool::str2str(error_msg, v);
@@ -317,16 +436,33 @@ class Worker {
             obinstream um(buf, request.size());
 
             string client_host;
+            int req_type;
+            uint64_t req_id;
             string query;
+            vector<string> params;
+            int priority;
 
             um >> client_host;  // get the client hostname for returning results.
+            um >> req_type;
+            um >> req_id;       // id of the query in the client session
+
+            if (req_type == REQ_NEXT) {
+                // client is ready for next chunk of qid
+                uint64_t qid;
+                um >> qid;
+                rc_->Ack(qid);
+                continue;
+            }
+
             um >> query;
+            um >> params;       // parameters if query is a template
+            um >> priority;     // Priority_T
             cout << "worker_node" << my_node_.get_local_rank() << " gets one QUERY: \"" << query <<"\" from host " << client_host << endl;
 
             if (query.find("emu") == 0) {
-                RunEMU(query, client_host);
+                RunEMU(query, client_host, req_id);
             } else {
-                ParseAndSendQuery(query, client_host);
+                ParseAndSendQuery(query, params, client_host, req_id, -1, 0, priority);
             }
         }
     }
@@ -334,10 +470,11 @@ class Worker {
     void SendQueryMsg(AbstractMailbox * mailbox, CoreAffinity * core_affinity) {
         while (1) {
             LogicPlan plan;
-            queue_.WaitAndPop(plan);
+            // wait until the number of running queries allows
+            queue_->WaitAndPop(plan);
 
             vector<Message> msgs;
-            Message::CreateInitMsg(plan.qid.value(), my_node_.get_local_rank(), my_node_.get_local_size(), core_affinity->GetThreadIdForExpert(EXPERT_T::INIT), plan.experts, msgs);
+            Message::CreateInitMsg(plan.qid.value(), my_node_.get_local_rank(), my_node_.get_local_size(), core_affinity->GetThreadIdForExpert(EXPERT_T::INIT), plan.priority, plan.experts, msgs);
             for (int i = 0 ; i < my_node_.get_local_size(); i++) {
                 mailbox->Send(config_->global_num_threads, msgs[i]);
             }
@@ -373,7 +510,7 @@ class Worker {
         cout << "Worker" << my_node_.get_local_rank() << ": DONE -> Init Core Affinity" << endl;
 
         // set the in-memory layout for RDMA buf
-        buf_ = new Buffer(my_node_);
+        buf_ = new Buffer(my_node_, core_affinity_);
         cout << "Worker" << my_node_.get_local_rank() << ": DONE -> Register LOCAL MEM, SIZE = " << buf_->GetLocalBufSize() << endl;
 
         mailbox_ = new RdmaMailbox(my_node_, buf_);
@@ -436,29 +573,37 @@ class Worker {
 
             // Node::SingleTrap("rc_->Pop(re);");
 
-            uint64_t time_ = thpt_monitor_->RecordEnd(re.qid);
+            // only the last chunk ends the query
+            uint64_t time_ = 0;
+            if (re.is_last) {
+                time_ = thpt_monitor_->RecordEnd(re.qid);
+                queue_->Release(re.qid);
+            }
 
             if (!is_emu_mode_) {
                 ibinstream m;
                 m << re.hostname;   // client hostname
+                m << re.req_id;     // id of the query in the client session
+                m << re.qid;        // for client to ask for next chunk
+                m << re.chunk_id;
+                m << re.is_last;
                 m << re.results;    // query results
                 m << time_;         // execution time
 
                 zmq::message_t msg(m.size());
                 memcpy((void *)msg.data(), m.get_buf(), m.size());
 
-                zmq::socket_t sender(context_, ZMQ_PUSH);
-                char addr[64];
-                // port calculation is based on our self-defined protocol
-                sprintf(addr, "tcp://%s:%d", re.hostname.c_str(), workers_[my_node_.get_local_rank()].tcp_port + my_node_.get_world_rank() + 1);
-                sender.connect(addr);
+                zmq::socket_t * sender = GetResultSender(re.hostname);
                 cout << "worker_node" << my_node_.get_local_rank() << " sends the results to Client " << re.hostname << endl;
                 #ifdef TEST_WITH_COUNT
                     metadata_->PrintTimeRatio();
                 #endif // DEBUG
-                sender.send(msg);
+                sender->send(msg);
 
                 // monitor.IncreaseCounter(1);
+            } else if (!re.is_last) {
+                // nobody consumes the chunks in emu mode
+                rc_->Ack(re.qid);
             }
         }
 
@@ -478,8 +623,9 @@ class Worker {
     vector<Node> & memory_nodes_;
     Config * config_;
     Parser* parser_;
+    PlanCache* plan_cache_;
     IndexStore* index_store_;
-    ThreadSafeQueue<LogicPlan> queue_;
+    AdmissionQueue* queue_;
     Result_Collector * rc_;
     uint32_t num_query;
 
@@ -497,6 +643,24 @@ class Worker {
 
     vector<zmq::socket_t *> senders_;
     zmq::socket_t * remote_listener_;
+
+    // client hostname -> connection for results, kept across queries
+    map<string, zmq::socket_t *> result_senders_;
+
+    zmq::socket_t * GetResultSender(const string & hostname) {
+        auto itr = result_senders_.find(hostname);
+        if (itr != result_senders_.end()) {
+            return itr->second;
+        }
+
+        zmq::socket_t * sender = new zmq::socket_t(context_, ZMQ_PUSH);
+        char addr[64];
+        // port calculation is based on our self-defined protocol
+        sprintf(addr, "tcp://%s:%d", hostname.c_str(), workers_[my_node_.get_local_rank()].tcp_port + my_node_.get_world_rank() + 1);
+        sender->connect(addr);
+        result_senders_[hostname] = sender;
+        return sender;
+    }
 };
 
 #endif /* WORKER_HPP_ */
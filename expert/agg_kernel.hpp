@@ -0,0 +1,123 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <limits>
+#include <vector>
+
+#include "base/type.hpp"
+
+using namespace std;
+
+// Partial aggregate of numeric values, see AggKernel
+struct AggPartial {
+    uint64_t count = 0;
+    int64_t int_sum = 0;
+    double double_sum = 0;
+    double min = numeric_limits<double>::infinity();
+    double max = -numeric_limits<double>::infinity();
+};
+
+// Typed aggregation kernels of MathExpert
+//
+// Values of a msg are first split by type into contiguous int64 and double
+// columns, then each column is folded by a plain loop the compiler turns into
+// SIMD code, instead of converting and comparing value_t one by one. Every
+// msg is reduced into its own AggPartial, partials are merged into the one of
+// the barrier and the result is built once all msgs are collected. Ints are
+// summed in int64 so that large sums do not overflow, values that are neither
+// int nor double are skipped.
+class AggKernel {
+ public:
+    // fold vals into p, ints and doubles are reused as column buffers
+    static void Update(AggPartial & p, const vector<value_t> & vals, vector<int64_t> & ints, vector<double> & doubles) {
+        Gather(vals, ints, doubles);
+        if (ints.empty() && doubles.empty()) {
+            return;
+        }
+
+        AggPartial part;
+        part.count = ints.size() + doubles.size();
+        part.int_sum = Sum(ints.data(), ints.size());
+        part.double_sum = Sum(doubles.data(), doubles.size());
+        if (!ints.empty()) {
+            part.min = Min(ints.data(), ints.size());
+            part.max = Max(ints.data(), ints.size());
+        }
+        if (!doubles.empty()) {
+            part.min = std::min(part.min, Min(doubles.data(), doubles.size()));
+            part.max = std::max(part.max, Max(doubles.data(), doubles.size()));
+        }
+        Merge(p, part);
+    }
+
+    static void Merge(AggPartial & dst, const AggPartial & src) {
+        dst.count += src.count;
+        dst.int_sum += src.int_sum;
+        dst.double_sum += src.double_sum;
+        dst.min = std::min(dst.min, src.min);
+        dst.max = std::max(dst.max, src.max);
+    }
+
+    static double Sum(const AggPartial & p) {
+        return p.int_sum + p.double_sum;
+    }
+
+    static double Mean(const AggPartial & p) {
+        return Sum(p) / p.count;
+    }
+
+    // split values into columns by type, type 1 is int and 2 is double as in Tool
+    static void Gather(const vector<value_t> & vals, vector<int64_t> & ints, vector<double> & doubles) {
+        ints.clear();
+        doubles.clear();
+        for (auto & v : vals) {
+            if (v.type == 1) {
+                int i;
+                memcpy(&i, v.content.data(), sizeof(int));
+                ints.push_back(i);
+            } else if (v.type == 2) {
+                double d;
+                memcpy(&d, v.content.data(), sizeof(double));
+                doubles.push_back(d);
+            }
+        }
+    }
+
+    template <class T>
+    static T Sum(const T * x, size_t n) {
+        T sum = 0;
+        #pragma omp simd reduction(+:sum)
+        for (size_t i = 0; i < n; i++) {
+            sum += x[i];
+        }
+        return sum;
+    }
+
+    // n > 0
+    template <class T>
+    static T Min(const T * x, size_t n) {
+        T m = x[0];
+        #pragma omp simd reduction(min:m)
+        for (size_t i = 1; i < n; i++) {
+            m = x[i] < m ? x[i] : m;
+        }
+        return m;
+    }
+
+    // n > 0
+    template <class T>
+    static T Max(const T * x, size_t n) {
+        T m = x[0];
+        #pragma omp simd reduction(max:m)
+        for (size_t i = 1; i < n; i++) {
+            m = x[i] > m ? x[i] : m;
+        }
+        return m;
+    }
+};
@@ -41,7 +41,7 @@ class AsExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
      }
 
@@ -8,6 +8,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 #include "core/result_collector.hpp"
 #include "expert/abstract_expert.hpp"
+#include "expert/agg_kernel.hpp"
 #include "expert/expert_cache.hpp"
 #include "storage/metadata.hpp"
 #include "utils/mkl_util.hpp"
@@ -17,7 +18,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 namespace BarrierData {
 struct barrier_data_base {
-    map<string, int> path_counter;
+    CreditCounter credit_counter;
 };
 }  // namespace BarrierData
 
@@ -36,13 +37,13 @@ class BarrierExpertBase :  public AbstractExpert {
 
         // get msg info
         mkey_t key;
-        string end_path;
-        GetMsgInfo(msg, key, end_path);
+        credit_t end_credit;
+        GetMsgInfo(msg, key, end_credit);
 
         typename BarrierDataTable::accessor ac;
         data_table_.insert(ac, key);
 
-        bool isReady = IsReady(ac, msg.meta, end_path);
+        bool isReady = IsReady(ac, msg.meta, end_credit);
 
         do_work(tid, experts, msg, ac, isReady);
 
@@ -92,7 +93,7 @@ class BarrierExpertBase :  public AbstractExpert {
                 branch_value = Tool::value_t2int(his_itr->second);
                 // some barrier experts will remove hisotry after branch key
                 if (erase_his) {
-                    his.erase(his_itr + 1, his.end());
+                    his.EraseAfter(his_itr);
                 }
             }
         }
@@ -118,11 +119,11 @@ class BarrierExpertBase :  public AbstractExpert {
             return metadata->GetPropertyForEdge(tid, ep_id, val);
         } else {
             bool found = true;
-            if (!cache->get_property_from_cache(ep_id.value(), val)) {
+            if (!cache->get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                 // not found in cache
                 found = metadata->GetPropertyForEdge(tid, ep_id, val);
                 if (found) {
-                    cache->insert_properties(ep_id.value(), val);
+                    cache->insert_properties(Element_T::EDGE, ep_id.value(), val);
                 }
             }
             return found;
@@ -140,11 +141,11 @@ class BarrierExpertBase :  public AbstractExpert {
             return metadata->GetPropertyForVertex(tid, vp_id, val);
         } else {
             bool found = true;
-            if (!cache->get_property_from_cache(vp_id.value(), val)) {
+            if (!cache->get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                 // not found in cache
                 found = metadata->GetPropertyForVertex(tid, vp_id, val);
                 if (found) {
-                    cache->insert_properties(vp_id.value(), val);
+                    cache->insert_properties(Element_T::VERTEX, vp_id.value(), val);
                 }
             }
             return found;
@@ -162,10 +163,10 @@ class BarrierExpertBase :  public AbstractExpert {
             found = metadata->GetLabelForEdge(tid, e_id, label);
         } else {
             found = true;
-            if (!cache->get_label_from_cache(e_id.value(), label)) {
+            if (!cache->get_label_from_cache(Element_T::EDGE, e_id.value(), label)) {
                 found = metadata->GetLabelForEdge(tid, e_id, label);
                 if (found) {
-                    cache->insert_label(e_id.value(), label);
+                    cache->insert_label(Element_T::EDGE, e_id.value(), label);
                 }
             }
         }
@@ -189,10 +190,10 @@ class BarrierExpertBase :  public AbstractExpert {
             found = metadata->GetLabelForVertex(tid, v_id, label);
         } else {
             found = true;
-            if (!cache->get_label_from_cache(v_id.value(), label)) {
+            if (!cache->get_label_from_cache(Element_T::VERTEX, v_id.value(), label)) {
                 found = metadata->GetLabelForVertex(tid, v_id, label);
                 if (found) {
-                    cache->insert_label(v_id.value(), label);
+                    cache->insert_label(Element_T::VERTEX, v_id.value(), label);
                 }
             }
         }
@@ -214,50 +215,32 @@ class BarrierExpertBase :  public AbstractExpert {
     BarrierDataTable data_table_;
 
     // Check if msg all collected
-    static bool IsReady(typename BarrierDataTable::accessor& ac, Meta& m, string end_path) {
-        map<string, int>& counter = ac->second.path_counter;
-        string msg_path = m.msg_path;
-        // check if all msg are collected
-        while (msg_path != end_path) {
-            int i = msg_path.find_last_of("\t");
-            // "\t" should not be the the last char
-            assert(i + 1 < msg_path.size());
-            // get last number
-            int num = atoi(msg_path.substr(i + 1).c_str());
-
-            // check key
-            if (counter.count(msg_path) != 1) {
-                counter[msg_path] = 0;
-            }
+    static bool IsReady(typename BarrierDataTable::accessor& ac, Meta& m, credit_t end_credit) {
+        CreditCounter& counter = ac->second.credit_counter;
+        counter.Add(m.msg_credit);
 
-            // current branch is ready
-            if ((++counter[msg_path]) == num) {
-                // reset count to 0
-                counter[msg_path] = 0;
-                // remove last number
-                msg_path = msg_path.substr(0, i == string::npos ? 0 : i);
-            } else {
-                return false;
-            }
+        // check if all msg are collected
+        if (counter.IsComplete(end_credit)) {
+            m.msg_credit = end_credit;
+            return true;
         }
-        m.msg_path = end_path;
-        return true;
+        return false;
     }
 
     // get msg info
     // key : mkey_t, identifier of msg
-    // end_path: identifier of msg collection completed
-    static void GetMsgInfo(Message& msg, mkey_t &key, string &end_path) {
+    // end_credit: credit of current scope, msg collection completed when reached
+    static void GetMsgInfo(Message& msg, mkey_t &key, credit_t &end_credit) {
         // init info
         uint64_t msg_id = 0;
         int index = 0;
-        end_path = "";
+        end_credit = 0;
 
         int branch_depth = msg.meta.branch_infos.size() - 1;
         if (branch_depth >= 0) {
             msg_id = msg.meta.branch_infos[branch_depth].msg_id;
             index = msg.meta.branch_infos[branch_depth].index;
-            end_path = msg.meta.branch_infos[branch_depth].msg_path;
+            end_credit = msg.meta.branch_infos[branch_depth].msg_credit;
         }
         key = mkey_t(msg.meta.qid, msg_id, index);
     }
@@ -271,12 +254,15 @@ struct end_data : barrier_data_base {
 
 class EndExpert : public BarrierExpertBase<BarrierData::end_data> {
  public:
-    EndExpert(int id, MetaData* metadata, int num_nodes, Result_Collector * rc, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::end_data>(id, metadata, core_affinity), num_nodes_(num_nodes), rc_(rc), mailbox_(mailbox) {}
+    EndExpert(int id, MetaData* metadata, int num_nodes, Result_Collector * rc, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::end_data>(id, metadata, core_affinity), num_nodes_(num_nodes), rc_(rc), mailbox_(mailbox) {
+        chunk_size_ = Config::GetInstance()->result_chunk_size;
+    }
 
  private:
     Result_Collector * rc_;
     AbstractMailbox * mailbox_;
     int num_nodes_;
+    int chunk_size_;
 
     void do_work(int tid, const vector<Expert_Object> & experts, Message & msg, BarrierExpertBase::BarrierDataTable::accessor& ac, bool isReady) {
         #ifdef EXPERT_PROCESS_PRINT
@@ -286,11 +272,24 @@ class EndExpert : public BarrierExpertBase<BarrierData::end_data> {
 
         auto& data = ac->second.result;
 
+        // a part of the query failed, results of other parts are discarded
+        if (msg.meta.msg_type == MSG_T::ABORT) {
+            rc_->Fail(msg.meta.qid, Tool::value_t2string(msg.data[0].second[0]));
+            msg.data.clear();
+        }
+
         // move msg data to data table
         for (auto& pair : msg.data) {
             data.insert(data.end(), std::make_move_iterator(pair.second.begin()), std::make_move_iterator(pair.second.end()));
         }
 
+        // stream full chunks to client before all msgs arrive,
+        // chunks keep the order in which data arrives
+        if (!isReady && chunk_size_ > 0 && data.size() >= chunk_size_) {
+            rc_->InsertChunk(msg.meta.qid, data);
+            data.clear();
+        }
+
         // all msg are collected
         if (isReady) {
             // insert data to result collector
@@ -299,7 +298,7 @@ class EndExpert : public BarrierExpertBase<BarrierData::end_data> {
             vector<Message> vec;
             msg.CreateExitMsg(num_nodes_, vec);
             for (auto& m : vec) {
-                mailbox_->Send(tid, m);
+                mailbox_->Send(tid, move(m));
             }
         }
     }
@@ -358,7 +357,7 @@ class AggregateExpert : public BarrierExpertBase<BarrierData::agg_data> {
             }
 
             for (auto& m : v) {
-                mailbox_->Send(tid, m);
+                mailbox_->Send(tid, move(m));
             }
         }
     }
@@ -423,7 +422,7 @@ class CapExpert : public BarrierExpertBase<> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -483,7 +482,7 @@ class CountExpert : public BarrierExpertBase<BarrierData::count_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -549,14 +548,9 @@ class DedupExpert : public BarrierExpertBase<BarrierData::dedup_data> {
 
             if (key_set.size() > 0 && p.second.size() != 0) {
                 auto& dedup_set = dedup_his_map[branch_value];
-                history_t his;
                 // dedup history
                 // construct history with given key
-                for (auto& val : p.first) {
-                    if (key_set.find(val.first) != key_set.end()) {
-                        his.push_back(move(val));
-                    }
-                }
+                history_t his = p.first.Project(key_set);
                 // insert constructed history and check if exists
                 if (dedup_set.insert(move(his)).second) {
                     itr_dp->second.push_back(move(p.second[0]));
@@ -586,7 +580,7 @@ class DedupExpert : public BarrierExpertBase<BarrierData::dedup_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -600,12 +594,14 @@ struct group_data : barrier_data_base {
     //        history_t:                 histroy of data
     //        map<string,value_t>:    record key and values of grouped data
     unordered_map<int, pair<history_t, map<string, vector<value_t>>>> data_map;
+    // groupCount only counts keys, values are not projected nor kept
+    unordered_map<int, map<string, uint64_t>> count_map;
 };
 }  // namespace BarrierData
 
 class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
  public:
-    GroupExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::group_data>(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox) {
+    GroupExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::group_data>(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox), cache_(EXPERT_T::GROUP) {
         config_ = Config::GetInstance();
     }
 
@@ -646,6 +642,7 @@ class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
         if (config_->global_enable_caching) {
             cache = &cache_;
         }
+        bool isCount = Tool::value_t2int(expert.params[0]);
 
         // process msg data
         for (auto& p : msg.data) {
@@ -657,24 +654,32 @@ class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
                 itr_data = data_map.insert(itr_data, {branch_value, {move(p.first), map<string, vector<value_t>>()}});
             }
             auto& map_ = itr_data->second.second;
+            auto& counts = ac->second.count_map[branch_value];
 
             for (auto& val : p.second) {
                 value_t k = val;
-                value_t v = val;
                 if (!kp(tid, k, keyProjection, metadata_, cache)) {
                     continue;
                 }
+                if (isCount && valueProjection < 0) {
+                    counts[Tool::DebugString(k)]++;
+                    continue;
+                }
+                value_t v = val;
                 if (!vp(tid, v, valueProjection, metadata_, cache)) {
                     continue;
                 }
                 string key = Tool::DebugString(k);
-                map_[key].push_back(move(v));
+                if (isCount) {
+                    counts[key]++;
+                } else {
+                    map_[key].push_back(move(v));
+                }
             }
         }
 
         // all msg are collected
         if (isReady) {
-            bool isCount = Tool::value_t2int(expert.params[0]);
             vector<pair<history_t, vector<value_t>>> msg_data;
 
             for (auto& p : data_map) {
@@ -683,13 +688,15 @@ class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
                 size_t max_size = msg.max_data_size - MemSize(msg_data) - MemSize(p.second.first) - MemSize(value_t());
 
                 vector<value_t> vec_val;
-                for (auto& item : p.second.second) {
-                    string map_string;
-                    // construct string
-                    if (isCount) {
-                        map_string = item.first + ":" + to_string(item.second.size());
-                    } else {
-                        map_string = item.first + ":[";
+                // construct string
+                vector<string> map_strings;
+                if (isCount) {
+                    for (auto& item : ac->second.count_map[p.first]) {
+                        map_strings.push_back(item.first + ":" + to_string(item.second));
+                    }
+                } else {
+                    for (auto& item : p.second.second) {
+                        string map_string = item.first + ":[";
                         for (auto& v : item.second) {
                             map_string += Tool::DebugString(v) + ", ";
                         }
@@ -699,8 +706,11 @@ class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
                             map_string.pop_back();
                         }
                         map_string += "]";
+                        map_strings.push_back(move(map_string));
                     }
+                }
 
+                for (auto& map_string : map_strings) {
                     while (1) {
                         value_t v;
                         // each value_t should have at most max_size
@@ -723,7 +733,7 @@ class GroupExpert : public BarrierExpertBase<BarrierData::group_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -745,7 +755,7 @@ struct order_data : barrier_data_base {
 
 class OrderExpert : public BarrierExpertBase<BarrierData::order_data> {
  public:
-    OrderExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::order_data>(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox) {
+    OrderExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : BarrierExpertBase<BarrierData::order_data>(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox), cache_(EXPERT_T::ORDER) {
         config_ = Config::GetInstance();
     }
 
@@ -851,7 +861,7 @@ class OrderExpert : public BarrierExpertBase<BarrierData::order_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -951,7 +961,7 @@ class RangeExpert : public BarrierExpertBase<BarrierData::range_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -1038,7 +1048,7 @@ class CoinExpert : public BarrierExpertBase<BarrierData::range_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
@@ -1047,8 +1057,7 @@ class CoinExpert : public BarrierExpertBase<BarrierData::range_data> {
 
 namespace BarrierData {
 struct math_meta_t {
-    int count;
-    value_t value;
+    AggPartial agg;
     history_t history;
 };
 
@@ -1075,16 +1084,10 @@ class MathExpert : public BarrierExpertBase<BarrierData::math_data> {
         const Expert_Object& expert = experts[msg.meta.step];
         assert(expert.params.size() == 1);
         Math_T math_type = (Math_T)Tool::value_t2int(expert.params[0]);
-        void (*op)(BarrierData::math_meta_t&, value_t&);
-        switch (math_type) {
-            case Math_T::SUM:
-            case Math_T::MEAN:   op = sum; break;
-            case Math_T::MAX:    op = max; break;
-            case Math_T::MIN:    op = min; break;
-            default:             cout << "Unexpected math type in MathExpert" << endl;
-        }
 
-        // process msg data
+        // process msg data, each pair is reduced by typed kernels
+        vector<int64_t> ints;
+        vector<double> doubles;
         for (auto& p : msg.data) {
             int branch_value = get_branch_value(p.first, branch_key);
 
@@ -1093,25 +1096,21 @@ class MathExpert : public BarrierExpertBase<BarrierData::math_data> {
             if (itr_data == data_map.end()) {
                 itr_data = data_map.insert(itr_data, {branch_value, BarrierData::math_meta_t()});
                 itr_data->second.history = move(p.first);
-                itr_data->second.count = 0;
             }
 
-            for (auto& val : p.second) {
-                op(itr_data->second, val);    // operate on new value
-            }
+            AggKernel::Update(itr_data->second.agg, p.second, ints, doubles);
         }
 
         // all msg are collected
         if (isReady) {
-            bool isMean = math_type == Math_T::MEAN;
             vector<pair<history_t, vector<value_t>>> msg_data;
             for (auto& p : data_map) {
                 BarrierData::math_meta_t& data = p.second;
                 vector<value_t> val_vec;
-                if (data.count > 0) {
-                    // convert value to double
-                    to_double(data, isMean);
-                    val_vec.push_back(move(data.value));
+                if (data.agg.count > 0) {
+                    value_t v;
+                    Tool::str2double(to_string(result(data.agg, math_type)), v);
+                    val_vec.push_back(move(v));
                 }
                 msg_data.emplace_back(move(data.history), move(val_vec));
             }
@@ -1122,58 +1121,20 @@ class MathExpert : public BarrierExpertBase<BarrierData::math_data> {
                 vector<Message> v;
                 msg.CreateNextMsg(experts, msg_data, num_thread_, metadata_, core_affinity_, v);
                 for (auto& m : v) {
-                    mailbox_->Send(tid, m);
+                    mailbox_->Send(tid, move(m));
                 }
             }
         }
     }
 
-    static void sum(BarrierData::math_meta_t& data, value_t& v) {
-        data.count++;
-        if (data.count == 1) {
-            data.value = move(v);
-            return;
-        }
-        value_t temp = data.value;
-        data.value.content.clear();
-        switch (v.type) {
-            case 1:
-                Tool::str2int(to_string(Tool::value_t2int(temp) + Tool::value_t2int(v)), data.value);
-                break;
-            case 2:
-                Tool::str2double(to_string(Tool::value_t2double(temp) + Tool::value_t2double(v)), data.value);
-                break;
-        }
-    }
-
-    static void max(BarrierData::math_meta_t& data, value_t& v) {
-        if (data.count == 0 || data.value < v) {
-            data.value = move(v);
-        }
-        data.count++;
-    }
-
-    static void min(BarrierData::math_meta_t& data, value_t& v) {
-        if (data.count == 0 || data.value > v) {
-            data.value = move(v);
-        }
-        data.count++;
-    }
-
-    static void to_double(BarrierData::math_meta_t& data, bool isMean) {
-        value_t temp = data.value;
-
-        // divide value by count if isMean
-        int count = isMean ? data.count : 1;
-
-        data.value.content.clear();
-        switch (data.value.type) {
-            case 1:
-                Tool::str2double(to_string((double)Tool::value_t2int(temp) / count), data.value);
-                break;
-            case 2:
-                Tool::str2double(to_string(Tool::value_t2double(temp) / count), data.value);
-                break;
+    static double result(const AggPartial& agg, Math_T math_type) {
+        switch (math_type) {
+            case Math_T::SUM:    return AggKernel::Sum(agg);
+            case Math_T::MEAN:   return AggKernel::Mean(agg);
+            case Math_T::MAX:    return agg.max;
+            case Math_T::MIN:    return agg.min;
+            default:             cout << "Unexpected math type in MathExpert" << endl;
         }
+        return 0;
     }
 };
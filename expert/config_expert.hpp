@@ -13,6 +13,7 @@ Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
 #include "core/abstract_mailbox.hpp"
 #include "base/type.hpp"
 #include "expert/abstract_expert.hpp"
+#include "expert/expert_cache.hpp"
 #include "storage/metadata.hpp"
 #include "utils/config.hpp"
 #include "utils/tool.hpp"
@@ -76,6 +77,15 @@ class ConfigExpert : public AbstractExpert {
         s += "Indexing : " + string(config_->global_enable_indexing ? "True" : "False") + "\n";
         s += "Stealing : " + string(config_->global_enable_workstealing ? "True" : "False") + "\n";
         s += "Max Data Size: " + to_string(config_->max_data_size) + "\n";
+        if (config_->global_enable_caching) {
+            s += PropertyCache::GetInstance()->DebugString();
+        }
+        if (config_->global_enable_expert_division) {
+            s += core_affinity_->DivisionString();
+        }
+        if (config_->global_use_rdma && config_->global_rdma_coalesce_gap > 0) {
+            s += RDMA::get_rdma().dev->ReadStatString();
+        }
         if (m.recver_nid == m.parent_nid) {
             value_t v;
             Tool::str2str(s, v);
@@ -90,7 +100,7 @@ class ConfigExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
@@ -7,180 +7,312 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 #ifndef EXPERT_CACHE_HPP_
 #define EXPERT_CACHE_HPP_
 
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <type_traits>
+#include <emmintrin.h>
 #include <pthread.h>
 
-#include "core/message.hpp"
+#include "base/type.hpp"
+#include "utils/config.hpp"
+#include "utils/mymath.hpp"
+#include "utils/tool.hpp"
+#include "utils/unit.hpp"
+
+#define CACHE_NUM_SHARDS     64
+#define CACHE_ASSOCIATIVITY  4
+// bytes of budget spent on slots, the rest holds values
+#define CACHE_SLOT_RATIO     25
+
+// Cache of remote labels and properties shared by all experts of a worker
+//
+// The budget of GLOBAL_CACHE_SZ_MB bytes is split into shards, each shard has
+// a set-associative slot table and a value log. Values are appended to the log
+// as raw bytes and overwritten in FIFO order when the log wraps around, so the
+// memory used never exceeds the budget whatever the value sizes are.
+//
+// Writers of a shard are serialized by a spinlock and bump a sequence number
+// before and after modifying it. Readers take no lock: they copy the value and
+// retry if the sequence number shows a concurrent write (seqlock).
+//
+// With a budget of 0, nothing is allocated and every lookup misses.
+class PropertyCache {
+ public:
+    enum Kind : uint8_t { EMPTY, V_LABEL, E_LABEL, V_PROPERTY, E_PROPERTY };
 
-#define MASK 0xFFFFFFFFFFFFFFFF
-#define USE_BLOCK_KEY_CACHE  1
-#define BLOCK_KEY_SIZE       8
-#define EXPERT_NUM_CACHE      1000000
+    // the instance of the worker, only gets memory if ENABLE_CACHE is set
+    static PropertyCache* GetInstance() {
+        Config * config = Config::GetInstance();
+        static PropertyCache cache_single_instance(config->global_enable_caching ? MiB2B((uint64_t)config->global_cache_sz_mb) : 0);
+        return &cache_single_instance;
+    }
 
-class ExpertCache {
- public:
-    bool get_label_from_cache(uint64_t id, label_t & label) {
-        value_t val;
-        if (!lookup(id, val)) {
-            return false;
+    explicit PropertyCache(uint64_t budget) : budget_(budget), num_buckets_(0), arena_sz_(0) {
+        for (int i = 0; i < CACHE_NUM_SHARDS; i++) {
+            Shard & shard = shards_[i];
+            shard.seq = 0;
+            pthread_spin_init(&shard.lock, 0);
+            shard.tail = 0;
+            shard.slots = NULL;
+            shard.arena = NULL;
+        }
+        if (budget == 0) {
+            return;
         }
 
-        label = Tool::value_t2int(val);
-        return true;
+        uint64_t shard_sz = budget / CACHE_NUM_SHARDS;
+        num_buckets_ = max((uint64_t)1, shard_sz * CACHE_SLOT_RATIO / 100 / (sizeof(Slot) * CACHE_ASSOCIATIVITY));
+        arena_sz_ = max((uint64_t)64, shard_sz - num_buckets_ * CACHE_ASSOCIATIVITY * sizeof(Slot));
+        for (int i = 0; i < CACHE_NUM_SHARDS; i++) {
+            // zeroed pages are only committed when touched
+            shards_[i].slots = (Slot *)calloc(num_buckets_ * CACHE_ASSOCIATIVITY, sizeof(Slot));
+            shards_[i].arena = (char *)malloc(arena_sz_);
+        }
     }
 
-    bool get_property_from_cache(uint64_t id, value_t & val) {
-        if (!lookup(id, val)) {
-            return false;
+    ~PropertyCache() {
+        for (int i = 0; i < CACHE_NUM_SHARDS; i++) {
+            free(shards_[i].slots);
+            free(shards_[i].arena);
         }
-        return true;
     }
 
-    void insert_properties(uint64_t id, value_t & val) {
-        insert(id, val);
-    }
+    bool Lookup(Kind kind, uint64_t id, uint8_t & type, vector<char> & content) {
+        if (budget_ == 0) {
+            return false;
+        }
+        Shard & shard = shards_[ShardId(kind, id)];
+        uint64_t bucket_id = BucketId(kind, id);
+
+        // retry a few times on conflict, then report a miss
+        for (int retry = 0; retry < 4; retry++) {
+            uint64_t seq = shard.seq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                _mm_pause();
+                continue;
+            }
+
+            bool found = false;
+            Slot * bucket = &shard.slots[bucket_id * CACHE_ASSOCIATIVITY];
+            for (int i = 0; i < CACHE_ASSOCIATIVITY; i++) {
+                Slot slot = bucket[i];
+                if (slot.kind != kind || slot.id != id) {
+                    continue;
+                }
 
-    void insert_label(uint64_t id, label_t & label) {
-        value_t val;
-        Tool::str2int(to_string(label), val);
+                uint64_t tail = shard.tail;
+                uint64_t off = slot.pos % arena_sz_;
+                // overwritten or torn by a concurrent write
+                if (tail - slot.pos > arena_sz_ || off + slot.len > arena_sz_) {
+                    break;
+                }
+                type = slot.type;
+                content.assign(shard.arena + off, shard.arena + off + slot.len);
+                found = true;
+                break;
+            }
 
-        insert(id, val);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (shard.seq.load(std::memory_order_relaxed) == seq) {
+                return found;
+            }
+        }
+        return false;
     }
 
- private:
-    static_assert(USE_BLOCK_KEY_CACHE == 0 || USE_BLOCK_KEY_CACHE == 1, "wrong macro USE_BLOCK_KEY_CACHE value");
+    void Insert(Kind kind, uint64_t id, uint8_t type, const char * content, uint32_t len) {
+        // too large values would flush a large part of shard
+        if (budget_ == 0 || len > arena_sz_ / 8) {
+            return;
+        }
 
-#if USE_BLOCK_KEY_CACHE == 0
+        Shard & shard = shards_[ShardId(kind, id)];
+        Slot * bucket = &shard.slots[BucketId(kind, id) * CACHE_ASSOCIATIVITY];
 
-    struct CacheItem {
-        pthread_spinlock_t lock;
-        uint64_t id;  // epid_t, vpid_t, eid_t, vid_t
-        value_t value;  // properties or labels
-        bool isEmpty;
+        pthread_spin_lock(&shard.lock);
+        uint64_t seq = shard.seq.load(std::memory_order_relaxed);
+        shard.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
 
-        CacheItem() {
-            isEmpty = true;
-            pthread_spin_init(&lock, 0);
+        // allocate in log, skip the end of log if the value does not fit
+        uint64_t pos = shard.tail;
+        if (pos % arena_sz_ + len > arena_sz_) {
+            pos = ceil(pos, arena_sz_);
         }
-    };
+        shard.tail = pos + len;
+        memcpy(shard.arena + pos % arena_sz_, content, len);
+
+        // replace same key, or empty, or overwritten, or the oldest slot
+        Slot * victim = &bucket[0];
+        for (int i = 0; i < CACHE_ASSOCIATIVITY; i++) {
+            Slot & slot = bucket[i];
+            if (slot.kind == kind && slot.id == id) {
+                victim = &slot;
+                break;
+            }
+            if (victim->kind != EMPTY && (slot.kind == EMPTY || slot.pos < victim->pos)) {
+                victim = &slot;
+            }
+        }
+        victim->id = id;
+        victim->pos = pos;
+        victim->len = len;
+        victim->type = type;
+        victim->kind = kind;
+
+        shard.seq.store(seq + 2, std::memory_order_release);
+        pthread_spin_unlock(&shard.lock);
+    }
 
-    static const int NUM_CACHE = EXPERT_NUM_CACHE;
-    CacheItem items[NUM_CACHE];
+    // drop the value of key, e.g. after it is updated remotely
+    void Invalidate(Kind kind, uint64_t id) {
+        if (budget_ == 0) {
+            return;
+        }
 
-    bool lookup(uint64_t id, value_t & val) {
-        bool isFound = false;
+        Shard & shard = shards_[ShardId(kind, id)];
+        Slot * bucket = &shard.slots[BucketId(kind, id) * CACHE_ASSOCIATIVITY];
 
-        int key = mymath::hash_u64(id) % NUM_CACHE;
+        pthread_spin_lock(&shard.lock);
+        uint64_t seq = shard.seq.load(std::memory_order_relaxed);
+        shard.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
 
-        pthread_spin_lock(&(items[key].lock));
-        if (items[key].id == id) {
-            val = items[key].value;
-            isFound = true;
+        for (int i = 0; i < CACHE_ASSOCIATIVITY; i++) {
+            Slot & slot = bucket[i];
+            if (slot.kind == kind && slot.id == id) {
+                slot.kind = EMPTY;
+                break;
+            }
         }
-        pthread_spin_unlock(&(items[key].lock));
 
-        return isFound;
+        shard.seq.store(seq + 2, std::memory_order_release);
+        pthread_spin_unlock(&shard.lock);
     }
 
-    void insert(uint64_t id, value_t & val) {
-        int key = mymath::hash_u64(id) % NUM_CACHE;
-        pthread_spin_lock(&(items[key].lock));
-        items[key].id = id;
-        items[key].value = val;
-        items[key].isEmpty = false;
-        pthread_spin_unlock(&(items[key].lock));
-    }
-#else
+    // hit statistics, one per expert type
+    struct CacheStat {
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        CacheStat() : hits(0), misses(0) {}
+    } __attribute__((aligned(64)));
 
-    // keys that fill in a cache line
-    // data in a specific cache block will be able to be fetched
-    struct CacheBlock {
-        // so this takes actually 128B
-        // wasting 52B, to make sure that only one spin lock inside of one cache line
-        // pthread_spinlock_t lock __attribute__((aligned(64)));
-
-        // cacheline 0
-        pthread_spinlock_t lock;
-        int pos;
-
-        // cacheline 1
-        uint64_t id_block[BLOCK_KEY_SIZE] __attribute__((aligned(64)));
+    CacheStat & GetStat(EXPERT_T type) {
+        return stats_[static_cast<int>(type)];
+    }
 
-        // CacheBlock(){memset(0, id_block, 64);}
-        CacheBlock() {
-            for (int i = 0; i < BLOCK_KEY_SIZE; i++) { id_block[i] = MASK; }
-            pos = 0;
-            pthread_spin_init(&lock, 0);
+    string DebugString() {
+        uint64_t used = 0;
+        for (int i = 0; i < CACHE_NUM_SHARDS; i++) {
+            used += min(shards_[i].tail, arena_sz_);
         }
-    };
 
-    static_assert(sizeof(CacheBlock) == (BLOCK_KEY_SIZE * 8 + 64), "CacheBlock not aligned to 64B");
+        stringstream ss;
+        ss << "Cache : " << B2MiB(budget_) << " MB budget, " << B2MiB(used) << " MB values" << endl;
+        for (int i = 0; i < NUM_EXPERT_TYPES; i++) {
+            uint64_t hits = stats_[i].hits.load(std::memory_order_relaxed);
+            uint64_t misses = stats_[i].misses.load(std::memory_order_relaxed);
+            if (hits + misses == 0) {
+                continue;
+            }
+            ss << "    " << ExpertType[i] << " : " << hits << " hits, " << misses << " misses, hit rate "
+               << 100.0 * hits / (hits + misses) << "%" << endl;
+        }
+        return ss.str();
+    }
 
-    static const int NUM_CACHE = EXPERT_NUM_CACHE / BLOCK_KEY_SIZE;
+ private:
+    struct Slot {
+        uint64_t id;
+        // position in value log, increasing forever
+        uint64_t pos;
+        uint32_t len;
+        uint8_t type;
+        uint8_t kind;
+    };
 
-    CacheBlock blocks[NUM_CACHE];
-    value_t values[NUM_CACHE][BLOCK_KEY_SIZE];
+    struct Shard {
+        std::atomic<uint64_t> seq;
+        pthread_spinlock_t lock;
+        uint64_t tail;
+        Slot * slots;
+        char * arena;
+    } __attribute__((aligned(64)));
 
-    bool lookup(uint64_t id, value_t & val) {
-        int key = mymath::hash_u64(id) % NUM_CACHE;
+    static const int NUM_EXPERT_TYPES = static_cast<int>(EXPERT_T::END) + 1;
 
-        // int ret = pthread_spin_trylock(&(blocks[key].lock));
-        // if(ret == EBUSY)
-        //     return false;
+    PropertyCache(const PropertyCache&);
+    PropertyCache& operator=(const PropertyCache&);
 
-        pthread_spin_lock(&(blocks[key].lock));
+    inline uint64_t Hash(Kind kind, uint64_t id) {
+        return mymath::hash_u64(id + kind);
+    }
 
-        // then, traversal inside the block
-        for (int i = 0; i < BLOCK_KEY_SIZE; i++) {
-            if (blocks[key].id_block[i] == id) {
-                // found
-                val = values[key][i];
+    inline int ShardId(Kind kind, uint64_t id) {
+        return Hash(kind, id) % CACHE_NUM_SHARDS;
+    }
 
-#ifdef NATIVE_ARRANGE_LRU
-#warning "NATIVE_ARRANGE_LRU defined"
-                // shuffle the block to archive LRU feature inside the block
-                if ((i + 1) % BLOCK_KEY_SIZE != blocks[key].pos) {
-                    int mod_pos = i, mod_pos_next;
-                    while (true) {
-                        mod_pos_next = (mod_pos + 1) % BLOCK_KEY_SIZE;
+    inline uint64_t BucketId(Kind kind, uint64_t id) {
+        return (Hash(kind, id) / CACHE_NUM_SHARDS) % num_buckets_;
+    }
 
-                        if (mod_pos_next == blocks[key].pos)
-                            break;
+    uint64_t budget_;
+    uint64_t num_buckets_;
+    uint64_t arena_sz_;
 
-                        blocks[key].id_block[mod_pos] = blocks[key].id_block[mod_pos_next];
+    Shard shards_[CACHE_NUM_SHARDS];
+    CacheStat stats_[NUM_EXPERT_TYPES];
+};
 
-                        mod_pos = mod_pos_next;
-                    }
+// Handle of the shared PropertyCache held by each expert
+class ExpertCache {
+ public:
+    explicit ExpertCache(EXPERT_T type, PropertyCache * cache = PropertyCache::GetInstance()) : cache_(cache), stat_(cache_->GetStat(type)) {}
 
-                    blocks[key].id_block[mod_pos] = id;
-                }
-#endif
-                pthread_spin_unlock(&(blocks[key].lock));
-                return true;
-            }
+    bool get_label_from_cache(Element_T type, uint64_t id, label_t & label) {
+        uint8_t value_type;
+        vector<char> content;
+        if (!Lookup(type == Element_T::VERTEX ? PropertyCache::V_LABEL : PropertyCache::E_LABEL, id, value_type, content)) {
+            return false;
         }
 
-        pthread_spin_unlock(&(blocks[key].lock));
+        memcpy(&label, &content[0], sizeof(label_t));
+        return true;
+    }
 
-        return false;
+    bool get_property_from_cache(Element_T type, uint64_t id, value_t & val) {
+        return Lookup(type == Element_T::VERTEX ? PropertyCache::V_PROPERTY : PropertyCache::E_PROPERTY, id, val.type, val.content);
     }
 
-    void insert(uint64_t id, value_t & val) {
-        int key = mymath::hash_u64(id) % NUM_CACHE;
-        pthread_spin_lock(&(blocks[key].lock));
-        // insert into the key map
-        blocks[key].id_block[blocks[key].pos] = id;
-        // insert into the value map
-        values[key][blocks[key].pos] = val;
-        // modify the tail
-        blocks[key].pos = (blocks[key].pos + 1) % BLOCK_KEY_SIZE;
+    void insert_properties(Element_T type, uint64_t id, value_t & val) {
+        cache_->Insert(type == Element_T::VERTEX ? PropertyCache::V_PROPERTY : PropertyCache::E_PROPERTY,
+                       id, val.type, val.content.data(), val.content.size());
+    }
 
-        pthread_spin_unlock(&(blocks[key].lock));
+    void insert_label(Element_T type, uint64_t id, label_t & label) {
+        cache_->Insert(type == Element_T::VERTEX ? PropertyCache::V_LABEL : PropertyCache::E_LABEL,
+                       id, 0, (const char *)&label, sizeof(label_t));
     }
 
-#endif
+    void invalidate_properties(Element_T type, uint64_t id) {
+        cache_->Invalidate(type == Element_T::VERTEX ? PropertyCache::V_PROPERTY : PropertyCache::E_PROPERTY, id);
+    }
+
+ private:
+    PropertyCache * cache_;
+    PropertyCache::CacheStat & stat_;
+
+    bool Lookup(PropertyCache::Kind kind, uint64_t id, uint8_t & type, vector<char> & content) {
+        if (cache_->Lookup(kind, id, type, content)) {
+            stat_.hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        stat_.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
 };
 
 #endif /* EXPERT_CACHE_HPP_ */
@@ -22,7 +22,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 class HasExpert : public AbstractExpert {
  public:
-    HasExpert(int id, MetaData * metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::HAS) {
+    HasExpert(int id, MetaData * metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::HAS), cache(type_) {
         config_ = Config::GetInstance();
     }
 
@@ -83,7 +83,7 @@ class HasExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
@@ -246,11 +246,11 @@ class HasExpert : public AbstractExpert {
             // No Need to check Cache for local or cache is disabled
             metadata_->GetPropertyForVertex(tid, vp_id, val);
         } else {
-            if (!cache.get_property_from_cache(vp_id.value(), val)) {
+            if (!cache.get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                 ////////////////////
                 cout << "Get Property for vertex and is not cached" << endl;
                 metadata_->GetPropertyForVertex(tid, vp_id, val);
-                cache.insert_properties(vp_id.value(), val);
+                cache.insert_properties(Element_T::VERTEX, vp_id.value(), val);
             }
         }
     }
@@ -259,9 +259,9 @@ class HasExpert : public AbstractExpert {
         if (metadata_->EPKeyIsLocal(ep_id) || !config_->global_enable_caching) {
             metadata_->GetPropertyForEdge(tid, ep_id, val);
         } else {
-            if (!cache.get_property_from_cache(ep_id.value(), val)) {
+            if (!cache.get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                 metadata_->GetPropertyForEdge(tid, ep_id, val);
-                cache.insert_properties(ep_id.value(), val);
+                cache.insert_properties(Element_T::EDGE, ep_id.value(), val);
             }
         }
     }
@@ -20,7 +20,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 class HasLabelExpert : public AbstractExpert {
  public:
-    HasLabelExpert(int id, MetaData * metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::HASLABEL) {
+    HasLabelExpert(int id, MetaData * metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::HASLABEL), cache(type_) {
         config_ = Config::GetInstance();
     }
 
@@ -63,7 +63,7 @@ class HasLabelExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
      }
 
@@ -88,11 +88,13 @@ class HasLabelExpert : public AbstractExpert {
 
             label_t label;
             if (metadata_->VPKeyIsLocal(vpid_t(v_id, 0)) || !config_->global_enable_caching) {
-                metadata_->GetLabelForVertex(tid, v_id, label);
+                if (!metadata_->GetLabelForVertex(tid, v_id, label))
+                    return true;
             } else {
-                if (!cache.get_label_from_cache(v_id.value(), label)) {
-                    metadata_->GetLabelForVertex(tid, v_id, label);
-                    cache.insert_label(v_id.value(), label);
+                if (!cache.get_label_from_cache(Element_T::VERTEX, v_id.value(), label)) {
+                    if (!metadata_->GetLabelForVertex(tid, v_id, label))
+                        return true;
+                    cache.insert_label(Element_T::VERTEX, v_id.value(), label);
                 }
             }
 
@@ -118,9 +120,9 @@ class HasLabelExpert : public AbstractExpert {
             if (metadata_->EPKeyIsLocal(epid_t(e_id, 0)) || !config_->global_enable_caching) {
                 metadata_->GetLabelForEdge(tid, e_id, label);
             } else {
-                if (!cache.get_label_from_cache(e_id.value(), label)) {
+                if (!cache.get_label_from_cache(Element_T::EDGE, e_id.value(), label)) {
                     metadata_->GetLabelForEdge(tid, e_id, label);
-                    cache.insert_label(e_id.value(), label);
+                    cache.insert_label(Element_T::EDGE, e_id.value(), label);
                 }
             }
 
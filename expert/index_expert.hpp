@@ -10,6 +10,8 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include "expert/abstract_expert.hpp"
 #include "core/message.hpp"
@@ -36,33 +38,15 @@ class IndexExpert : public AbstractExpert {
         assert(expert_obj.params.size() == 2);  // make sure input format
         Element_T inType = (Element_T) Tool::value_t2int(expert_obj.params[0]);
         int pid = Tool::value_t2int(expert_obj.params[1]);
-
-        bool enabled = false;
-        switch (inType) {
-            case Element_T::VERTEX:
-                enabled = BuildIndexVtx(tid, pid);
-                break;
-            case Element_T::EDGE:
-                enabled = BuildIndexEdge(tid, pid);
-                break;
-            default:
-                cout << "Wrong inType" << endl;
-                return;
+        if (inType != Element_T::VERTEX && inType != Element_T::EDGE) {
+            cout << "Wrong inType" << endl;
+            return;
         }
 
-        string ena = (enabled? "enabled":"disabled");
-        string s = "Index is " + ena + " in node" + to_string(m.recver_nid);
-        std::cout << "Index size = " << index_store_->GetIndexSize() / 1024 << " KB" << std::endl;
-        value_t v;
-        Tool::str2str(s, v);
-        msg.data.emplace_back(history_t(), vector<value_t>{v});
-        // Create Message
-        vector<Message> msg_vec;
-        msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, msg_vec);
-
-        // Send Message
-        for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+        if (m.msg_type == MSG_T::INIT) {
+            StartBuild(tid, expert_objs, msg, inType, pid);
+        } else {
+            BuildLane(tid, expert_objs, msg, inType, pid);
         }
     }
 
@@ -81,74 +65,175 @@ class IndexExpert : public AbstractExpert {
     map<int, bool> vtx_enabled_map;
     map<int, bool> edge_enabled_map;
 
-    bool BuildIndexVtx(int tid, int pid) {
-        if (vtx_enabled_map.find(pid) != vtx_enabled_map.end()) {
-            return index_store_->SetIndexMapEnable(Element_T::VERTEX, pid, true);
-        }
-        vector<vid_t> vid_list;
-        metadata_->GetAllVertices(tid, vid_list);
+    // An index is built from all slots of the vertex array split into lanes,
+    // one per index thread as in InitExpert, each lane scans its slots into
+    // a partial index merged into the build of the query, the lane finishing
+    // the last slots sets the index and replies
+    static const uint64_t MIN_LANE_SLOTS = 1 << 16;
 
+    struct IndexBuild {
         map<value_t, vector<value_t>> index_map;
         vector<value_t> no_key_vec;
-
-        for (auto& vid : vid_list) {
-            value_t vtx_v;
-            Tool::str2int(to_string(vid.value()), vtx_v);
-            label_t v_label;
-            metadata_->GetLabelForVertex(tid, vid, v_label);
-            vector<label_t> vp_list;
-            metadata_->GetVPList(v_label, vp_list);
-
-
-            if (pid != 0 && find(vp_list.begin(), vp_list.end(), pid) == vp_list.end()) {
-                no_key_vec.push_back(move(vtx_v));
-            } else {
-                vpid_t vp_id(vid, pid);
-                value_t val_v;
-                metadata_->GetPropertyForVertex(tid, vp_id, val_v);
-                index_map[val_v].push_back(move(vtx_v));
+        // slots not scanned yet
+        uint64_t slots_left;
+        // a partial index would give wrong results
+        bool failed;
+    };
+    // builds in progress, by qid
+    unordered_map<uint64_t, IndexBuild> builds_;
+    mutex build_mutex_;
+
+    void StartBuild(int tid, const vector<Expert_Object> & expert_objs, Message & msg, Element_T inType, int pid) {
+        {
+            lock_guard<mutex> lk(build_mutex_);
+            map<int, bool> & enabled_map = inType == Element_T::VERTEX ? vtx_enabled_map : edge_enabled_map;
+            if (enabled_map.find(pid) != enabled_map.end()) {
+                bool enabled = index_store_->SetIndexMapEnable(inType, pid, true);
+                Reply(tid, expert_objs, msg, true, enabled);
+                return;
             }
         }
 
-        index_store_->SetIndexMap(Element_T::VERTEX, pid, index_map, no_key_vec);
-        vtx_enabled_map[pid] = true;
+        uint64_t num_slots = metadata_->NumVertexSlots(tid);
+        int num_lanes = max(1, min(core_affinity_->GetNumThreadsForExpert(EXPERT_T::INDEX), (int)(num_slots / MIN_LANE_SLOTS)));
+        {
+            lock_guard<mutex> lk(build_mutex_);
+            IndexBuild & build = builds_[msg.meta.qid];
+            build.slots_left = num_slots;
+            build.failed = false;
+        }
 
-        // TODO(future): set index enable after all node done building
-        return index_store_->SetIndexMapEnable(Element_T::VERTEX, pid);
+        Meta m = msg.meta;
+        m.msg_type = MSG_T::SPAWN;
+        for (int i = 0; i < num_lanes; i++) {
+            value_t begin, end;
+            Tool::str2uint64_t(to_string(num_slots * i / num_lanes), begin);
+            Tool::str2uint64_t(to_string(num_slots * (i + 1) / num_lanes), end);
+
+            Message lane(m);
+            lane.meta.recver_tid = core_affinity_->GetThreadIdForExpert(EXPERT_T::INDEX);
+            lane.meta.msg_credit = SplitCredit(m.msg_credit, num_lanes, i);
+            lane.data.emplace_back(history_t(), vector<value_t>{begin, end});
+            mailbox_->Send(tid, move(lane));
+        }
     }
 
-    bool BuildIndexEdge(int tid, int pid) {
-        if (edge_enabled_map.find(pid) != edge_enabled_map.end()) {
-            return index_store_->SetIndexMapEnable(Element_T::EDGE, pid, true);
-        }
-        vector<eid_t> eid_list;
-        metadata_->GetAllEdges(tid, eid_list);
+    void BuildLane(int tid, const vector<Expert_Object> & expert_objs, Message & msg, Element_T inType, int pid) {
+        uint64_t begin = Tool::value_t2uint64_t(msg.data[0].second[0]);
+        uint64_t end = Tool::value_t2uint64_t(msg.data[0].second[1]);
 
         map<value_t, vector<value_t>> index_map;
         vector<value_t> no_key_vec;
+        bool scanned;
+        if (inType == Element_T::VERTEX) {
+            scanned = ScanIndexVtx(tid, pid, begin, end, index_map, no_key_vec);
+        } else {
+            scanned = ScanIndexEdge(tid, pid, begin, end, index_map, no_key_vec);
+        }
+
+        IndexBuild build;
+        bool finished = false;
+        {
+            lock_guard<mutex> lk(build_mutex_);
+            auto itr = builds_.find(msg.meta.qid);
+            IndexBuild & shared = itr->second;
+            for (auto & item : index_map) {
+                vector<value_t> & vec = shared.index_map[item.first];
+                vec.insert(vec.end(), make_move_iterator(item.second.begin()), make_move_iterator(item.second.end()));
+            }
+            shared.no_key_vec.insert(shared.no_key_vec.end(), make_move_iterator(no_key_vec.begin()), make_move_iterator(no_key_vec.end()));
+            shared.failed = shared.failed || !scanned;
+            shared.slots_left -= end - begin;
+            if (shared.slots_left == 0) {
+                build = move(shared);
+                builds_.erase(itr);
+                finished = true;
+            }
+        }
+
+        if (!finished) {
+            Reply(tid, expert_objs, msg, false, false);
+            return;
+        }
 
-        for (auto& eid : eid_list) {
-            value_t edge_v;
-            Tool::str2uint64_t(to_string(eid.value()), edge_v);
-            label_t label;
-            metadata_->GetLabelForEdge(tid, eid, label);
-            vector<label_t> ep_list;
-            metadata_->GetEPList(label, ep_list);
-            if (find(ep_list.begin(), ep_list.end(), pid) == ep_list.end()) {
-                no_key_vec.push_back(move(edge_v));
-            } else {
-                epid_t ep_id(eid, pid);
-                value_t val_v;
-                metadata_->GetPropertyForEdge(tid, ep_id, val_v);
-                index_map[val_v].push_back(move(edge_v));
+        bool enabled = false;
+        if (!build.failed) {
+            index_store_->SetIndexMap(inType, pid, build.index_map, build.no_key_vec);
+            {
+                lock_guard<mutex> lk(build_mutex_);
+                (inType == Element_T::VERTEX ? vtx_enabled_map : edge_enabled_map)[pid] = true;
             }
+            // TODO(future): set index enable after all node done building
+            enabled = index_store_->SetIndexMapEnable(inType, pid);
+        }
+        Reply(tid, expert_objs, msg, true, enabled);
+    }
+
+    // send the state of index to end expert if has_result, or empty data
+    void Reply(int tid, const vector<Expert_Object> & expert_objs, Message & msg, bool has_result, bool enabled) {
+        msg.data.clear();
+        if (has_result) {
+            string ena = (enabled? "enabled":"disabled");
+            string s = "Index is " + ena + " in node" + to_string(msg.meta.recver_nid);
+            std::cout << "Index size = " << index_store_->GetIndexSize() / 1024 << " KB" << std::endl;
+            value_t v;
+            Tool::str2str(s, v);
+            msg.data.emplace_back(history_t(), vector<value_t>{v});
+        } else {
+            msg.data.emplace_back(history_t(), vector<value_t>());
         }
 
-        index_store_->SetIndexMap(Element_T::EDGE, pid, index_map, no_key_vec);
-        edge_enabled_map[pid] = true;
+        // Create Message
+        vector<Message> msg_vec;
+        msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, msg_vec);
 
-        // TODO(future): set index enable after all node done building
-        return index_store_->SetIndexMapEnable(Element_T::EDGE, pid);
+        // Send Message
+        for (auto& msg : msg_vec) {
+            mailbox_->Send(tid, move(msg));
+        }
+    }
+
+    bool ScanIndexVtx(int tid, int pid, uint64_t begin, uint64_t end, map<value_t, vector<value_t>> & index_map, vector<value_t> & no_key_vec) {
+        return metadata_->ScanVertices(tid, begin, end, 1 << 16, [&](vector<vid_t>& vids) {
+            for (auto& vid : vids) {
+                value_t vtx_v;
+                Tool::str2int(to_string(vid.value()), vtx_v);
+                label_t v_label;
+                metadata_->GetLabelForVertex(tid, vid, v_label);
+                vector<label_t> vp_list;
+                metadata_->GetVPList(v_label, vp_list);
+
+                if (pid != 0 && find(vp_list.begin(), vp_list.end(), pid) == vp_list.end()) {
+                    no_key_vec.push_back(move(vtx_v));
+                } else {
+                    vpid_t vp_id(vid, pid);
+                    value_t val_v;
+                    metadata_->GetPropertyForVertex(tid, vp_id, val_v);
+                    index_map[val_v].push_back(move(vtx_v));
+                }
+            }
+        });
+    }
+
+    // labels come with the scan, no lookup per edge
+    bool ScanIndexEdge(int tid, int pid, uint64_t begin, uint64_t end, map<value_t, vector<value_t>> & index_map, vector<value_t> & no_key_vec) {
+        return metadata_->ScanEdges(tid, begin, end, 1 << 16, [&](vector<eid_t>& eids, vector<label_t>& labels) {
+            for (int i = 0; i < eids.size(); i++) {
+                eid_t & eid = eids[i];
+                value_t edge_v;
+                Tool::str2uint64_t(to_string(eid.value()), edge_v);
+                vector<label_t> ep_list;
+                metadata_->GetEPList(labels[i], ep_list);
+                if (find(ep_list.begin(), ep_list.end(), pid) == ep_list.end()) {
+                    no_key_vec.push_back(move(edge_v));
+                } else {
+                    epid_t ep_id(eid, pid);
+                    value_t val_v;
+                    metadata_->GetPropertyForEdge(tid, ep_id, val_v);
+                    index_map[val_v].push_back(move(edge_v));
+                }
+            }
+        });
     }
 };
 
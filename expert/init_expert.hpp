@@ -8,7 +8,9 @@ Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
 #define INIT_EXPERT_HPP_
 
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include "glog/logging.h"
 
 #include "core/message.hpp"
@@ -25,36 +27,12 @@ Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
 #include "utils/timer.hpp"
 
 
-#include "storage/mpi_snapshot.hpp"
-#include "storage/snapshot_func.hpp"
-
 using namespace std;
 
 class InitExpert : public AbstractExpert {
  public:
-    InitExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity, IndexStore * index_store, int num_nodes) : AbstractExpert(id, metadata, core_affinity), index_store_(index_store), num_thread_(num_thread), mailbox_(mailbox), num_nodes_(num_nodes), type_(EXPERT_T::INIT), is_ready_(false) {
+    InitExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity, IndexStore * index_store, int num_nodes) : AbstractExpert(id, metadata, core_affinity), index_store_(index_store), num_thread_(num_thread), mailbox_(mailbox), num_nodes_(num_nodes), type_(EXPERT_T::INIT) {
         config_ = Config::GetInstance();
-
-        // read snapshot here
-        // write snapshot @ InitData
-
-        MPISnapshot* snapshot = MPISnapshot::GetInstance();
-
-        int snapshot_read_cnt = 0;
-
-        snapshot_read_cnt += ((snapshot->ReadData("init_expert_vtx_msgs", vtx_msgs, ReadMailboxMsgImpl)) ? 1 : 0);
-        snapshot_read_cnt += ((snapshot->ReadData("init_expert_edge_msgs", edge_msgs, ReadMailboxMsgImpl)) ? 1 : 0);
-        snapshot_read_cnt += ((snapshot->ReadData("init_expert_vtx_count_msgs", vtx_count_msgs, ReadMailboxMsgImpl)) ? 1 : 0);
-        snapshot_read_cnt += ((snapshot->ReadData("init_expert_edge_count_msgs", edge_count_msgs, ReadMailboxMsgImpl)) ? 1 : 0);
-        if (snapshot_read_cnt == 4) {
-            is_ready_ = true;
-        } else {
-            // atomic, all fail
-            vtx_msgs.resize(0);
-            edge_msgs.resize(0);
-            vtx_count_msgs.resize(0);
-            edge_count_msgs.resize(0);
-        }
     }
 
     virtual ~InitExpert() {}
@@ -72,11 +50,46 @@ class InitExpert : public AbstractExpert {
         }
     }
 
+    // sorted vertices with labels of all groups, each group is the labels of
+    // one hasLabel step, get_by_label(label, vid_list) appends its vertices
+    template <class GetByLabel>
+    static void GetVerticesByLabelGroups(const vector<vector<value_t>> & groups, GetByLabel get_by_label, vector<value_t> & vtxs) {
+        for (int i = 0; i < groups.size(); i++) {
+            vector<vid_t> vid_list;
+            for (auto & label : groups[i]) {
+                get_by_label((label_t)Tool::value_t2int(label), vid_list);
+            }
+
+            vector<value_t> group_vtxs;
+            group_vtxs.reserve(vid_list.size());
+            for (auto& vid : vid_list) {
+                value_t v;
+                Tool::str2int(to_string(vid.value()), v);
+                group_vtxs.push_back(v);
+            }
+            sort(group_vtxs.begin(), group_vtxs.end());
+
+            if (i == 0) {
+                vtxs.swap(group_vtxs);
+            } else {
+                IntersectSorted(vtxs, group_vtxs);
+            }
+        }
+    }
+
+    // keep elements of sorted vtxs that are in sorted other
+    static void IntersectSorted(vector<value_t> & vtxs, vector<value_t> & other) {
+        vector<value_t> temp;
+        set_intersection(make_move_iterator(vtxs.begin()), make_move_iterator(vtxs.end()),
+                        make_move_iterator(other.begin()), make_move_iterator(other.end()),
+                        back_inserter(temp));
+        vtxs.swap(temp);
+    }
+
  private:
     // Number of threads
     int num_thread_;
     int num_nodes_;
-    bool is_ready_;
 
     Config * config_;
 
@@ -89,119 +102,19 @@ class InitExpert : public AbstractExpert {
     // Pointer of index store
     IndexStore * index_store_;
 
-    // Ensure only one thread ever runs the expert
-    std::mutex thread_mutex_;
-
-    // Cached data
-    vector<Message> vtx_msgs;
-    vector<Message> edge_msgs;
-
-    // msg for count expert
-    vector<Message> vtx_count_msgs;
-    vector<Message> edge_count_msgs;
-
-    void InitData() {
-        if (is_ready_) {
-            return;
-        }
-        MPISnapshot* snapshot = MPISnapshot::GetInstance();
-
-        // convert id to msg
-        Meta m;
-        m.step = 1;
-        m.msg_path = to_string(num_nodes_);
-
-        uint64_t start_t = timer::get_usec();
-
-        InitVtxData(m);
-        snapshot->WriteData("init_expert_vtx_msgs", vtx_msgs, WriteMailboxMsgImpl);
-        snapshot->WriteData("init_expert_vtx_count_msgs", vtx_count_msgs, WriteMailboxMsgImpl);
-        uint64_t end_t = timer::get_usec();
-        cout << "[Timer] " << (end_t - start_t) / 1000 << " ms for initV_Msg in init_expert" << endl;
-
-        start_t = timer::get_usec();
-        InitEdgeData(m);
-        snapshot->WriteData("init_expert_edge_msgs", edge_msgs, WriteMailboxMsgImpl);
-        snapshot->WriteData("init_expert_edge_count_msgs", edge_count_msgs, WriteMailboxMsgImpl);
-        end_t = timer::get_usec();
-        cout << "[Timer] " << (end_t - start_t) / 1000 << " ms for initE_Msg in init_expert" << endl;
-    }
-
-    void InitVtxData(Meta& m) {
-        int tid = TidMapper::GetInstance()->GetTid();
-
-        vector<vid_t> vid_list;
-        metadata_->GetAllVertices(tid, vid_list);
-        uint64_t count = vid_list.size();
-
-        vector<pair<history_t, vector<value_t>>> data;
-        data.emplace_back(history_t(), vector<value_t>());
-        data[0].second.reserve(count);
-        for (auto& vid : vid_list) {
-            value_t v;
-            Tool::str2int(to_string(vid.value()), v);
-            data[0].second.push_back(v);
-        }
-        vector<vid_t>().swap(vid_list);
-
-        vtx_msgs.clear();
-        do {
-            Message msg(m);
-            msg.max_data_size = config_->max_data_size;
-            msg.InsertData(data);
-            vtx_msgs.push_back(move(msg));
-        } while ((data.size() != 0));
-
-        string num = "\t" + to_string(vtx_msgs.size());
-        for (auto & msg_ : vtx_msgs) {
-            msg_.meta.msg_path += num;
-        }
-
-        Message vtx_count_msg(m);
-        vtx_count_msg.max_data_size = config_->max_data_size;
-        value_t v;
-        Tool::str2int(to_string(count), v);
-        vtx_count_msg.data.emplace_back(history_t(), vector<value_t>{v});
-        vtx_count_msgs.push_back(move(vtx_count_msg));
-    }
-
-    void InitEdgeData(Meta& m) {
-        int tid = TidMapper::GetInstance()->GetTid();
-
-        vector<eid_t> eid_list;
-        metadata_->GetAllEdges(tid, eid_list);
-        uint64_t count = eid_list.size();
-
-        vector<pair<history_t, vector<value_t>>> data;
-        data.emplace_back(history_t(), vector<value_t>());
-        data[0].second.reserve(count);
-        for (auto& eid : eid_list) {
-            value_t v;
-            Tool::str2uint64_t(to_string(eid.value()), v);
-            data[0].second.push_back(v);
-        }
-        vector<eid_t>().swap(eid_list);
-
-        edge_msgs.clear();
-        do {
-            Message msg(m);
-            msg.max_data_size = config_->max_data_size;
-            msg.InsertData(data);
-            edge_msgs.push_back(move(msg));
-        } while ((data.size() != 0));
-
-        string num = "\t" + to_string(edge_msgs.size());
-        for (auto & msg_ : edge_msgs) {
-            msg_.meta.msg_path += num;
-        }
-
-        Message edge_count_msg(m);
-        edge_count_msg.max_data_size = config_->max_data_size;
-        value_t v;
-        Tool::str2int(to_string(count), v);
-        edge_count_msg.data.emplace_back(history_t(), vector<value_t>{v});
-        edge_count_msgs.push_back(move(edge_count_msg));
-    }
+    // V()/E() without index is a lazy source of slot ranges of the vertex
+    // array, split into lanes, one per init thread. A lane msg carries its
+    // remaining [begin, end), the thread picking it scans the first range
+    // only, sends out the elements and queues the rest of the lane behind
+    // them, so ids are generated on demand at the pace init threads are
+    // scheduled instead of being cached for the whole graph. A lane waits in
+    // queue while more than MAX_BACKLOG_PER_THREAD msgs per thread of this
+    // node are not taken by receivers, so that scans never run ahead of
+    // downstream experts or of the recv buffers of other nodes
+    static const uint64_t VTX_RANGE_SLOTS = 1 << 16;
+    // out edges of a range are collected at once, keep it small
+    static const uint64_t EDGE_RANGE_SLOTS = 1 << 12;
+    static const uint64_t MAX_BACKLOG_PER_THREAD = 8;
 
     void InitWithIndex(int tid, const vector<Expert_Object> & expert_objs, Message & msg) {
         Meta m = msg.meta;
@@ -215,6 +128,9 @@ class InitExpert : public AbstractExpert {
         Element_T inType = (Element_T) Tool::value_t2int(expert_obj.params.at(0));
         int numParamsGroup = (expert_obj.params.size() - 1) / 3;  // number of groups of params
 
+        // labels of hasLabel steps, when labels are not indexed
+        vector<vector<value_t>> label_groups;
+
         // Create predicate chain for this query
         for (int i = 0; i < numParamsGroup; i++) {
             int pos = i * 3 + 1;
@@ -223,83 +139,225 @@ class InitExpert : public AbstractExpert {
             Predicate_T pred_type = (Predicate_T) Tool::value_t2int(expert_obj.params.at(pos + 1));
             vector<value_t> pred_params;
             Tool::value_t2vec(expert_obj.params.at(pos + 2), pred_params);
+            if (inType == Element_T::VERTEX && pid == 0 && !index_store_->IsIndexEnabled(inType, 0)) {
+                label_groups.push_back(move(pred_params));
+                continue;
+            }
             pred_chain.emplace_back(pid, PredicateValue(pred_type, pred_params));
         }
 
         msg.max_data_size = config_->max_data_size;
         msg.data.clear();
         msg.data.emplace_back(history_t(), vector<value_t>());
-        index_store_->GetElements(inType, pred_chain, msg.data[0].second);
+        vector<value_t>& data = msg.data[0].second;
+        if (!pred_chain.empty()) {
+            index_store_->GetElements(inType, pred_chain, data);
+        }
+        bool by_label = !label_groups.empty();
+        vector<value_t> label_vtxs;
+        if (by_label) {
+            GetVerticesByLabelGroups(label_groups, [&](label_t label, vector<vid_t> & vid_list) {
+                metadata_->GetVerticesByLabel(tid, label, vid_list);
+            }, label_vtxs);
+        }
+        if (by_label && pred_chain.empty()) {
+            data.swap(label_vtxs);
+        } else if (by_label) {
+            // elements of a single predicate are not sorted
+            if (pred_chain.size() == 1) {
+                sort(data.begin(), data.end());
+            }
+            IntersectSorted(data, label_vtxs);
+        }
 
         vector<Message> vec;
         msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, vec);
 
         // Send Message
         for (auto& msg_ : vec) {
-            mailbox_->Send(tid, msg_);
+            mailbox_->Send(tid, move(msg_));
         }
     }
 
+    // V().count() and E().count() are answered by the count of the last scan
+    // while the graph is unchanged, each count query that scans updates it.
+    // A vertex whose id is claimed by AddVertex but whose record is not
+    // written yet is missed until the next update
+    struct ScanCount {
+        uint64_t version;
+        uint64_t count;
+        // slots not scanned yet, counts are complete at 0
+        uint64_t slots_left;
+    };
+    // by Element_T, slots_left of 0 once counted
+    ScanCount last_counts_[2] = {{0, 0, 1}, {0, 0, 1}};
+    // count queries being scanned, by qid
+    unordered_map<uint64_t, ScanCount> scan_counts_;
+    mutex count_mutex_;
+
+    static bool IsCount(const vector<Expert_Object> & expert_objs, int step) {
+        return expert_objs[expert_objs[step].next_expert].expert_type == EXPERT_T::COUNT;
+    }
+
     void InitWithoutIndex(int tid, const vector<Expert_Object> & expert_objs, Message & msg) {
-        if (!is_ready_) {
-            if (thread_mutex_.try_lock()) {
-                InitData();
-                is_ready_ = true;
-                thread_mutex_.unlock();
-            } else {
-                // wait until InitMsg finished
-                while (!thread_mutex_.try_lock()) {}
-                thread_mutex_.unlock();
+        if (msg.meta.msg_type == MSG_T::INIT) {
+            SendLanes(tid, expert_objs, msg);
+        } else {
+            ScanLane(tid, expert_objs, msg);
+        }
+    }
+
+    // send the count of the last scan to count expert, if it is still valid
+    bool SendLastCount(int tid, const vector<Expert_Object> & expert_objs, Message & msg, Element_T inType, uint64_t version) {
+        uint64_t count;
+        {
+            lock_guard<mutex> lk(count_mutex_);
+            ScanCount & last = last_counts_[inType];
+            if (last.slots_left != 0 || last.version != version) {
+                return false;
             }
+            count = last.count;
         }
+
         Meta m = msg.meta;
-        const Expert_Object& expert_obj = expert_objs[m.step];
+        m.step = expert_objs[m.step].next_expert;
+        m.msg_type = MSG_T::BARRIER;
+        m.recver_nid = m.parent_nid;
+        m.recver_tid = core_affinity_->GetThreadIdForExpert(EXPERT_T::COUNT);
+
+        Message count_msg(m);
+        value_t v;
+        Tool::str2int(to_string(count), v);
+        count_msg.data.emplace_back(history_t(), vector<value_t>{v});
+        mailbox_->Send(tid, move(count_msg));
+        return true;
+    }
 
-        // Get init element type
-        Element_T inType = (Element_T)Tool::value_t2int(expert_obj.params.at(0));
-        vector<Message>* msg_vec;
+    // add the count of [begin, end) scanned for a count query
+    void AddScanCount(uint64_t qid, Element_T inType, uint64_t begin, uint64_t end, uint64_t count) {
+        lock_guard<mutex> lk(count_mutex_);
+        auto itr = scan_counts_.find(qid);
+        if (itr == scan_counts_.end()) {
+            return;
+        }
+        itr->second.count += count;
+        itr->second.slots_left -= end - begin;
+        if (itr->second.slots_left == 0) {
+            last_counts_[inType] = itr->second;
+            scan_counts_.erase(itr);
+        }
+    }
 
-        if (expert_objs[m.step + 1].expert_type == EXPERT_T::COUNT) {
-            if (inType == Element_T::VERTEX) {
-                msg_vec = &vtx_count_msgs;
-            } else if (inType == Element_T::EDGE) {
-                msg_vec = &edge_count_msgs;
-            }
-        } else {
-            if (inType == Element_T::VERTEX) {
-                msg_vec = &vtx_msgs;
-            } else if (inType == Element_T::EDGE) {
-                msg_vec = &edge_msgs;
-            }
+    // split all slots into lanes sent to init threads of this node
+    void SendLanes(int tid, const vector<Expert_Object> & expert_objs, Message & msg) {
+        Element_T inType = (Element_T)Tool::value_t2int(expert_objs[msg.meta.step].params.at(0));
+        bool is_count = IsCount(expert_objs, msg.meta.step);
+        // read before the slots, so that a count never covers less than its version
+        uint64_t version = is_count ? metadata_->GraphVersion(tid) : 0;
+        if (is_count && SendLastCount(tid, expert_objs, msg, inType, version)) {
+            return;
         }
 
-        // update meta
-        m.step++;
+        uint64_t num_slots = metadata_->NumVertexSlots(tid);
+        if (is_count && num_slots > 0) {
+            lock_guard<mutex> lk(count_mutex_);
+            scan_counts_[msg.meta.qid] = ScanCount{version, 0, num_slots};
+        }
+        int num_lanes = max(1, min(core_affinity_->GetNumThreadsForExpert(type_), (int)(num_slots / VTX_RANGE_SLOTS)));
+
+        Meta m = msg.meta;
         m.msg_type = MSG_T::SPAWN;
-        if (expert_objs[m.step].IsBarrier()) {
-            m.msg_type = MSG_T::BARRIER;
-            m.recver_nid = m.parent_nid;
+        for (int i = 0; i < num_lanes; i++) {
+            value_t begin, end;
+            Tool::str2uint64_t(to_string(num_slots * i / num_lanes), begin);
+            Tool::str2uint64_t(to_string(num_slots * (i + 1) / num_lanes), end);
+
+            Message lane(m);
+            lane.meta.recver_tid = core_affinity_->GetThreadIdForExpert(type_);
+            lane.meta.msg_credit = SplitCredit(m.msg_credit, num_lanes, i);
+            lane.data.emplace_back(history_t(), vector<value_t>{begin, end});
+            mailbox_->Send(tid, lane);
         }
+    }
 
-        thread_mutex_.lock();
-        // Send Message
-        for (auto& msg : *msg_vec) {
-            msg.meta.qid = m.qid;
-            msg.meta.msg_type = m.msg_type;
-            msg.meta.recver_nid = m.recver_nid;          
-            msg.meta.recver_tid = core_affinity_->GetThreadIdForExpert(expert_objs[m.step].expert_type);      
-            msg.meta.parent_nid = m.parent_nid;
-            msg.meta.parent_tid = m.parent_tid;
-             #ifdef DEBUG
-                cout << "Start send" << endl;            
-            #endif // DEBUG
-            mailbox_->Send(tid, msg);
-            #ifdef DEBUG
-                cout << "Send success" << endl;            
-            #endif // DEBUG
+    // scan the first range of the lane, then send the rest of it
+    void ScanLane(int tid, const vector<Expert_Object> & expert_objs, Message & msg) {
+        // msgs resent to the same step are queued, not pipelined
+        if (mailbox_->Backlog() > MAX_BACKLOG_PER_THREAD * num_thread_) {
+            mailbox_->Send(tid, move(msg));
+            return;
+        }
+
+        Element_T inType = (Element_T)Tool::value_t2int(expert_objs[msg.meta.step].params.at(0));
+        uint64_t begin = Tool::value_t2uint64_t(msg.data[0].second[0]);
+        uint64_t end = Tool::value_t2uint64_t(msg.data[0].second[1]);
+        uint64_t range_end = min(end, begin + (inType == Element_T::VERTEX ? VTX_RANGE_SLOTS : EDGE_RANGE_SLOTS));
+
+        msg.max_data_size = config_->max_data_size;
+        msg.data.clear();
+        msg.data.emplace_back(history_t(), vector<value_t>());
+        vector<value_t>& data = msg.data[0].second;
+        bool scanned = false;
+        if (inType == Element_T::VERTEX) {
+            scanned = metadata_->ScanVertices(tid, begin, range_end, 1 << 20, [&](vector<vid_t>& vids) {
+                for (auto& vid : vids) {
+                    value_t v;
+                    Tool::str2int(to_string(vid.value()), v);
+                    data.push_back(move(v));
+                }
+            });
+        } else if (inType == Element_T::EDGE) {
+            scanned = metadata_->ScanEdges(tid, begin, range_end, 1 << 20, [&](vector<eid_t>& eids, vector<label_t>& labels) {
+                for (auto& eid : eids) {
+                    value_t v;
+                    Tool::str2uint64_t(to_string(eid.value()), v);
+                    data.push_back(move(v));
+                }
+            });
+        }
+
+        // partial results would look complete, fail the query instead, the
+        // rest of the lane is dropped with its credit
+        bool is_count = IsCount(expert_objs, msg.meta.step);
+        if (!scanned) {
+            if (is_count) {
+                lock_guard<mutex> lk(count_mutex_);
+                scan_counts_.erase(msg.meta.qid);
+            }
+            Message abort;
+            msg.CreateAbortMsg(expert_objs, "Init error: failed to read the memory node", core_affinity_, abort);
+            mailbox_->Send(tid, move(abort));
+            return;
+        }
+
+        if (is_count) {
+            AddScanCount(msg.meta.qid, inType, begin, range_end, data.size());
+        }
+
+        // the rest of the lane takes half of the credit
+        credit_t credit = msg.meta.msg_credit;
+        bool has_rest = range_end < end;
+        if (has_rest) {
+            msg.meta.msg_credit = SplitCredit(credit, 2, 0);
+        }
+
+        vector<Message> vec;
+        msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, vec);
+        for (auto& msg_ : vec) {
+            mailbox_->Send(tid, move(msg_));
+        }
+
+        if (has_rest) {
+            value_t rest_begin, rest_end;
+            Tool::str2uint64_t(to_string(range_end), rest_begin);
+            Tool::str2uint64_t(to_string(end), rest_end);
 
+            Message lane(msg.meta);
+            lane.meta.recver_tid = core_affinity_->GetThreadIdForExpert(type_);
+            lane.meta.msg_credit = SplitCredit(credit, 2, 1);
+            lane.data.emplace_back(history_t(), vector<value_t>{rest_begin, rest_end});
+            mailbox_->Send(tid, lane);
         }
-        thread_mutex_.unlock();
     }
 };
 
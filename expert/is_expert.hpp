@@ -55,7 +55,7 @@ class IsExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
      }
 
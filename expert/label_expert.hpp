@@ -21,7 +21,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 class LabelExpert : public AbstractExpert {
  public:
-    LabelExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::LABEL) {
+    LabelExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::LABEL), cache(type_) {
         config_ = Config::GetInstance();
     }
     // Label:
@@ -55,7 +55,7 @@ class LabelExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
      }
 
@@ -84,9 +84,9 @@ class LabelExpert : public AbstractExpert {
                 if (metadata_->VPKeyIsLocal(vpid_t(v_id, 0)) || !config_->global_enable_caching) {
                     metadata_->GetLabelForVertex(tid, v_id, label);
                 } else {
-                    if (!cache.get_label_from_cache(v_id.value(), label)) {
+                    if (!cache.get_label_from_cache(Element_T::VERTEX, v_id.value(), label)) {
                         metadata_->GetLabelForVertex(tid, v_id, label);
-                        cache.insert_label(v_id.value(), label);
+                        cache.insert_label(Element_T::VERTEX, v_id.value(), label);
                     }
                 }
 
@@ -113,9 +113,9 @@ class LabelExpert : public AbstractExpert {
                 if (metadata_->EPKeyIsLocal(epid_t(e_id, 0)) || !config_->global_enable_caching) {
                     metadata_->GetLabelForEdge(tid, e_id, label);
                 } else {
-                    if (!cache.get_label_from_cache(e_id.value(), label)) {
+                    if (!cache.get_label_from_cache(Element_T::EDGE, e_id.value(), label)) {
                         metadata_->GetLabelForEdge(tid, e_id, label);
-                        cache.insert_label(e_id.value(), label);
+                        cache.insert_label(Element_T::EDGE, e_id.value(), label);
                     }
                 }
 
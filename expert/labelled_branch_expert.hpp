@@ -20,7 +20,8 @@ struct msg_id_alloc {
 
 namespace BranchData {
 struct branch_data_base {
-    map<string, int> path_counter;
+    // <branch index, received credits>
+    unordered_map<int, CreditCounter> credit_counters;
     pair<int, int> branch_counter;
 };
 }  // namespace BranchData
@@ -60,13 +61,13 @@ class LabelledBranchExpertBase :  public AbstractExpert {
         } else if (msg.meta.msg_type == MSG_T::BRANCH) {
             // get branch message key
             mkey_t key;
-            string end_path;
-            GetMsgInfo(msg, key, end_path);
+            credit_t end_credit;
+            GetMsgInfo(msg, key, end_credit);
 
             typename BranchDataTable::accessor ac;
             data_table_.find(ac, key);
 
-            bool isReady = IsReady(ac, msg.meta, end_path);
+            bool isReady = IsReady(ac, msg.meta, end_credit);
 
             process_branch(tid, experts, msg, ac, isReady);
 
@@ -107,43 +108,27 @@ class LabelledBranchExpertBase :  public AbstractExpert {
         vector<Message> msg_vec;
         msg.CreateBranchedMsgWithHisLabel(experts, step_vec, msg_id, num_thread_, metadata_, core_affinity_, msg_vec);
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
     // check if all branched steps are collected
-    static bool IsReady(typename BranchDataTable::accessor& ac, Meta& m, string end_path) {
-        map<string, int>& counter = ac->second.path_counter;
+    static bool IsReady(typename BranchDataTable::accessor& ac, Meta& m, credit_t end_credit) {
         pair<int, int>& branch_counter = ac->second.branch_counter;
-        string msg_path = m.msg_path;
-
-        // check if all msg are collected
-        while (msg_path != end_path) {
-            int i = msg_path.find_last_of("\t");
-            // "\t" should not be the the last char
-            assert(i + 1 < msg_path.size());
-            // get last number
-            int num = atoi(msg_path.substr(i + 1).c_str());
-
-            // check key
-            if (counter.count(msg_path) != 1) {
-                counter[msg_path] = 0;
-            }
 
-            // current branch is ready
-            if ((++counter[msg_path]) == num) {
-                // reset count to 0
-                counter[msg_path] = 0;
-                // remove last number
-                msg_path = msg_path.substr(0, i == string::npos ? 0 : i);
-            } else {
-                return false;
-            }
+        // each branch carries the full credit of parent msg
+        int branch_index = m.branch_infos[m.branch_infos.size() - 1].index;
+        CreditCounter& counter = ac->second.credit_counters[branch_index];
+        counter.Add(m.msg_credit);
+
+        // check if all msg of current branch are collected
+        if (!counter.IsComplete(end_credit)) {
+            return false;
         }
 
         branch_counter.second++;
         if (branch_counter.first == branch_counter.second) {
-            m.msg_path = end_path;
+            m.msg_credit = end_credit;
             return true;
         }
         return false;
@@ -151,18 +136,18 @@ class LabelledBranchExpertBase :  public AbstractExpert {
 
     // get msg info
     // key : mkey_t, identifier of msg
-    // end_path: identifier of msg collection completed
-    static void GetMsgInfo(Message& msg, mkey_t &key, string &end_path) {
+    // end_credit: credit of parent msg, msg collection completed when reached
+    static void GetMsgInfo(Message& msg, mkey_t &key, credit_t &end_credit) {
         // init info
         uint64_t msg_id = 0;
         int index = 0;
-        end_path = "";
+        end_credit = 0;
 
         int branch_depth = msg.meta.branch_infos.size() - 1;
         if (branch_depth >= 0) {
             // msg info given by current expert
             msg_id = msg.meta.branch_infos[branch_depth].msg_id;
-            end_path = msg.meta.branch_infos[branch_depth].msg_path;
+            end_credit = msg.meta.branch_infos[branch_depth].msg_credit;
         }
 
         if (branch_depth >= 1) {
@@ -250,7 +235,7 @@ class BranchFilterExpert : public LabelledBranchExpertBase<BranchData::branch_fi
             vector<Message> v;
             msg.CreateNextMsg(experts, data, num_thread_, metadata_, core_affinity_, v);
             for (auto& m : v) {
-                mailbox_->Send(tid, m);
+                mailbox_->Send(tid, move(m));
             }
         }
     }
@@ -0,0 +1,122 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+#ifndef MUTATE_EXPERT_HPP_
+#define MUTATE_EXPERT_HPP_
+
+#include <string>
+#include <vector>
+
+#include "core/message.hpp"
+#include "core/abstract_mailbox.hpp"
+#include "base/type.hpp"
+#include "expert/abstract_expert.hpp"
+#include "expert/expert_cache.hpp"
+#include "storage/metadata.hpp"
+#include "utils/tool.hpp"
+
+// Updates the graph on the memory node, see Parser::ParseMutate
+// The init msg reaches every node: the parent applies the update, the others
+// drop what they cached of the updated elements. A query running on another
+// node while the update is applied may still cache the old value.
+class MutateExpert : public AbstractExpert {
+ public:
+    MutateExpert(int id, MetaData * metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::MUTATE), cache(type_) {}
+
+    void process(const vector<Expert_Object> & expert_objs, Message & msg) {
+        int tid = TidMapper::GetInstance()->GetTid();
+
+        // Get Expert_Object
+        Meta & m = msg.meta;
+        Expert_Object expert_obj = expert_objs[m.step];
+
+        // Get Params
+        Mutate_T mutate_type = (Mutate_T)Tool::value_t2int(expert_obj.params[0]);
+        bool is_parent = m.recver_nid == m.parent_nid;
+
+        string s;
+        switch (mutate_type) {
+            case Mutate_T::ADD_VTX:
+                if (is_parent) {
+                    label_t label = Tool::value_t2int(expert_obj.params[1]);
+                    vid_t v_id;
+                    if (metadata_->AddVertex(tid, label, v_id)) {
+                        s = "Added vertex " + to_string(v_id.value());
+                    } else {
+                        s = "Add vertex failed, vertex array is full";
+                    }
+                }
+                break;
+            case Mutate_T::ADD_EDGE: {
+                label_t label = Tool::value_t2int(expert_obj.params[1]);
+                vid_t src(Tool::value_t2int(expert_obj.params[2]));
+                vid_t dst(Tool::value_t2int(expert_obj.params[3]));
+                if (is_parent) {
+                    if (metadata_->AddEdge(tid, src, dst, label)) {
+                        s = "Added edge " + to_string(src.value()) + " -> " + to_string(dst.value());
+                    } else {
+                        s = "Add edge failed, no such vertex or ext region is full";
+                    }
+                } else {
+                    // the parent updates its own index in AppendNbs
+                    metadata_->RefreshVertexIndex(tid, src);
+                    metadata_->RefreshVertexIndex(tid, dst);
+                }
+                break;
+            }
+            case Mutate_T::SET_VP: {
+                vpid_t vp_id(Tool::value_t2int(expert_obj.params[1]), Tool::value_t2int(expert_obj.params[2]));
+                if (is_parent) {
+                    bool ok = metadata_->SetPropertyForVertex(tid, vp_id, expert_obj.params[3]);
+                    s = ok ? "Set property done" : "Set property failed, property store is full";
+                }
+                cache.invalidate_properties(Element_T::VERTEX, vp_id.value());
+                break;
+            }
+            case Mutate_T::SET_EP: {
+                // the edge is kept as (in_v, out_v), i.e. (dst, src)
+                eid_t e_id(Tool::value_t2int(expert_obj.params[2]), Tool::value_t2int(expert_obj.params[1]));
+                epid_t ep_id(e_id, Tool::value_t2int(expert_obj.params[3]));
+                if (is_parent) {
+                    bool ok = metadata_->SetPropertyForEdge(tid, ep_id, expert_obj.params[4]);
+                    s = ok ? "Set property done" : "Set property failed, property store is full";
+                }
+                cache.invalidate_properties(Element_T::EDGE, ep_id.value());
+                break;
+            }
+        }
+
+        if (is_parent) {
+            value_t v;
+            Tool::str2str(s, v);
+            msg.data.emplace_back(history_t(), vector<value_t>{v});
+        } else {
+            msg.data.emplace_back(history_t(), vector<value_t>());
+        }
+
+        // Create Message
+        vector<Message> msg_vec;
+        msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, msg_vec);
+
+        // Send Message
+        for (auto& msg : msg_vec) {
+            mailbox_->Send(tid, move(msg));
+        }
+    }
+
+ private:
+    // Number of Threads
+    int num_thread_;
+
+    // Expert type
+    EXPERT_T type_;
+
+    // Pointer of mailbox
+    AbstractMailbox * mailbox_;
+
+    // Cache
+    ExpertCache cache;
+};
+
+#endif /* MUTATE_EXPERT_HPP_ */
@@ -21,7 +21,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 class PropertiesExpert : public AbstractExpert {
  public:
-    PropertiesExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::PROPERTY) {
+    PropertiesExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity* core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::PROPERTY), cache(type_) {
         config_ = Config::GetInstance();
     }
 
@@ -54,7 +54,7 @@ class PropertiesExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
@@ -98,9 +98,9 @@ class PropertiesExpert : public AbstractExpert {
                             if (metadata_->VPKeyIsLocal(vp_id) || !config_->global_enable_caching) {
                                 metadata_->GetPropertyForVertex(tid, vp_id, val);
                             } else {
-                                if (!cache.get_property_from_cache(vp_id.value(), val)) {
+                                if (!cache.get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                                     metadata_->GetPropertyForVertex(tid, vp_id, val);
-                                    cache.insert_properties(vp_id.value(), val);
+                                    cache.insert_properties(Element_T::VERTEX, vp_id.value(), val);
                                 }
                             }
                         }
@@ -127,10 +127,10 @@ class PropertiesExpert : public AbstractExpert {
                             if (metadata_->VPKeyIsLocal(vp_id) || !config_->global_enable_caching) {
                                 metadata_->GetPropertyForVertex(tid, vp_id, val);
                             } else {
-                                if (!cache.get_property_from_cache(vp_id.value(), val)) {
+                                if (!cache.get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                                     // not found in cache
                                     metadata_->GetPropertyForVertex(tid, vp_id, val);
-                                    cache.insert_properties(vp_id.value(), val);
+                                    cache.insert_properties(Element_T::VERTEX, vp_id.value(), val);
                                 }
                             }
                         }                      
@@ -168,10 +168,10 @@ class PropertiesExpert : public AbstractExpert {
                         if (metadata_->EPKeyIsLocal(ep_id) || !config_->global_enable_caching) {
                             metadata_->GetPropertyForEdge(tid, ep_id, val);
                         } else {
-                            if (!cache.get_property_from_cache(ep_id.value(), val)) {
+                            if (!cache.get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                                 // not found in cache
                                 metadata_->GetPropertyForEdge(tid, ep_id, val);
-                                cache.insert_properties(ep_id.value(), val);
+                                cache.insert_properties(Element_T::EDGE, ep_id.value(), val);
                             }
                         }
 
@@ -191,10 +191,10 @@ class PropertiesExpert : public AbstractExpert {
                         if (metadata_->EPKeyIsLocal(ep_id) || !config_->global_enable_caching) {
                             metadata_->GetPropertyForEdge(tid, ep_id, val);
                         } else {
-                            if (!cache.get_property_from_cache(ep_id.value(), val)) {
+                            if (!cache.get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                                 // not found in cache
                                 metadata_->GetPropertyForEdge(tid, ep_id, val);
-                                cache.insert_properties(ep_id.value(), val);
+                                cache.insert_properties(Element_T::EDGE, ep_id.value(), val);
                             }
                         }
 
@@ -24,7 +24,7 @@ class RepeatExpert : public AbstractExpert {
             msg.CreateBranchedMsg(experts, step_vec, num_thread_, metadata_, core_affinity_, msg_vec);
 
             for (auto& m : msg_vec) {
-                mailbox_->Send(tid, m);
+                mailbox_->Send(tid, move(m));
             }
         } else {
             cout << "Unexpected msg type in repeat expert." << endl;
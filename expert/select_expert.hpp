@@ -36,9 +36,10 @@ class SelectExpert : public AbstractExpert {
             label_step_list.emplace_back(Tool::value_t2int(expert_obj.params.at(i)), Tool::value_t2string(expert_obj.params.at(i + 1)));
         }
 
-        // sort label_step_list for quick search
+        // sort label_step_list in descending order
+        // to match history_t, which is iterated from the latest label
         sort(label_step_list.begin(), label_step_list.end(),
-            [](const pair<int, string>& l, const pair<int, string>& r){ return l.first < r.first;});
+            [](const pair<int, string>& l, const pair<int, string>& r){ return l.first > r.first;});
 
         //  Grab history_t
         if (label_step_list.size() != 1) {
@@ -53,7 +54,7 @@ class SelectExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
      }
 
@@ -71,39 +72,41 @@ class SelectExpert : public AbstractExpert {
         vector<value_t> result;
 
         for (auto & data_pair : data) {
-            int value_size = data_pair.second.size();
-            string res = "[";
-            bool isResultEmpty = true;
+            // matched "label:value" in descending order of label step
+            vector<string> items;
 
             auto l_itr = label_step_list.begin();
 
             if (!data_pair.first.empty()) {
-                vector<pair<int, value_t>>::iterator p_itr = data_pair.first.begin();
+                history_t::const_iterator p_itr = data_pair.first.begin();
 
                 // once there is one list ends, end search
                 do {
-                    // cout << "label_step_list_item & history_list_item : " << *l_itr << " & " << (*p_itr).first << endl;
                     if (l_itr->first == p_itr->first) {
-                        res += l_itr->second + ":" + Tool::DebugString(p_itr->second) + ", ";
-                        isResultEmpty = false;
+                        items.push_back(l_itr->second + ":" + Tool::DebugString(p_itr->second));
 
                         l_itr++;
                         p_itr++;
-                    } else if (l_itr->first < p_itr->first) {
-                        l_itr++;
                     } else if (l_itr->first > p_itr->first) {
+                        l_itr++;
+                    } else if (l_itr->first < p_itr->first) {
                         p_itr++;
                     }
                 } while (l_itr != label_step_list.end() && p_itr != data_pair.first.end());
             }
 
+            bool isResultEmpty = items.empty();
+            string res = "[";
+            for (auto itr = items.rbegin(); itr != items.rend(); itr++) {
+                res += *itr + ", ";
+            }
+
             if (!isResultEmpty) {
                 res.pop_back();
                 res.pop_back();
             }
             res += "]";
 
-            // cout << "Copy " << data_pair.second.size() << " times for " << res << endl;
             if (!data_pair.first.empty() && !isResultEmpty) {
                 for (int i = 0; i < data_pair.second.size(); i++) {
                     value_t val;
@@ -121,7 +124,7 @@ class SelectExpert : public AbstractExpert {
         for (auto & data_pair : data) {
             vector<value_t> result;
             if (!data_pair.first.empty()) {
-                vector<pair<int, value_t>>::iterator p_itr = data_pair.first.begin();
+                history_t::const_iterator p_itr = data_pair.first.begin();
                 do {
                     if (label_step == (*p_itr).first) {
                         for (int i = 0; i < data_pair.second.size(); i++) {
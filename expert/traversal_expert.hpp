@@ -26,7 +26,7 @@ using namespace std::placeholders;
 
 class TraversalExpert : public AbstractExpert {
  public:
-    TraversalExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity * core_affinity) : AbstractExpert(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::TRAVERSAL) {
+    TraversalExpert(int id, MetaData* metadata, int num_thread, AbstractMailbox * mailbox, CoreAffinity * core_affinity) : AbstractExpert(id, metadata, core_affinity), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::TRAVERSAL), cache(type_) {
         config_ = Config::GetInstance();
     }
 
@@ -84,9 +84,17 @@ class TraversalExpert : public AbstractExpert {
         vector<Message> msg_vec;
         msg.CreateNextMsg(expert_objs, msg.data, num_thread_, metadata_, core_affinity_, msg_vec);
 
+        // reads of the next hop are in flight while msgs are sent
+        bool prefetching = config_->global_enable_prefetch && outType == Element_T::VERTEX
+                           && PostPrefetchNextHop(tid, expert_objs, m.recver_nid, msg_vec);
+
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
+        }
+
+        if (prefetching) {
+            metadata_->CompletePrefetch(tid);
         }
     }
 
@@ -104,6 +112,40 @@ class TraversalExpert : public AbstractExpert {
     ExpertCache cache;
     Config* config_;
 
+    // Start reading headers of output vertices if the next expert on this
+    // node looks up their labels or nbs, so that it hits vertex index instead
+    // of reading them one by one. Msgs kept by pipelining run on this thread
+    // after the reads complete.
+    bool PostPrefetchNextHop(int tid, const vector<Expert_Object> & expert_objs, int nid, const vector<Message> & msg_vec) {
+        vector<vid_t> vids;
+        for (auto & msg : msg_vec) {
+            if (msg.meta.recver_nid != nid || (size_t)msg.meta.step >= expert_objs.size()
+                || !ReadsVertex(expert_objs[msg.meta.step].expert_type)) {
+                continue;
+            }
+            for (auto & pair : msg.data) {
+                for (auto & value : pair.second) {
+                    vids.emplace_back(Tool::value_t2int(value));
+                }
+            }
+        }
+        return !vids.empty() && metadata_->PostPrefetch(tid, vids);
+    }
+
+    static bool ReadsVertex(EXPERT_T type) {
+        switch (type) {
+        case EXPERT_T::HAS:
+        case EXPERT_T::HASLABEL:
+        case EXPERT_T::KEY:
+        case EXPERT_T::LABEL:
+        case EXPERT_T::PROPERTY:
+        case EXPERT_T::TRAVERSAL:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     // ============Vertex===============
     // Get IN/OUT/BOTH of Vertex
     void GetNeighborOfVertex(int tid, int lid, Direction_T dir, vector<pair<history_t, vector<value_t>>> & data) {
@@ -370,9 +412,9 @@ class TraversalExpert : public AbstractExpert {
         if (metadata_->EPKeyIsLocal(epid_t(e_id, 0)) || !config_->global_enable_caching) {
             metadata_->GetLabelForEdge(tid, e_id, label);
         } else {
-            if (!cache.get_label_from_cache(e_id.value(), label)) {
+            if (!cache.get_label_from_cache(Element_T::EDGE, e_id.value(), label)) {
                 metadata_->GetLabelForEdge(tid, e_id, label);
-                cache.insert_label(e_id.value(), label);
+                cache.insert_label(Element_T::EDGE, e_id.value(), label);
             }
         }
     }
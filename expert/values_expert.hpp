@@ -20,7 +20,7 @@ Authors: Aaron Li (cjli@cse.cuhk.edu.hk)
 
 class ValuesExpert : public AbstractExpert {
  public:
-    ValuesExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity * core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::VALUES) {
+    ValuesExpert(int id, MetaData* metadata, int machine_id, int num_thread, AbstractMailbox * mailbox, CoreAffinity * core_affinity) : AbstractExpert(id, metadata, core_affinity), machine_id_(machine_id), num_thread_(num_thread), mailbox_(mailbox), type_(EXPERT_T::VALUES), cache(type_) {
         config_ = Config::GetInstance();
     }
 
@@ -53,7 +53,7 @@ class ValuesExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
@@ -96,10 +96,10 @@ class ValuesExpert : public AbstractExpert {
                             if (metadata_->VPKeyIsLocal(vp_id) || !config_->global_enable_caching) {
                                 metadata_->GetPropertyForVertex(tid, vp_id, val);
                             } else {
-                                if (!cache.get_property_from_cache(vp_id.value(), val)) {
+                                if (!cache.get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                                     // not found in cache
                                     metadata_->GetPropertyForVertex(tid, vp_id, val);
-                                    cache.insert_properties(vp_id.value(), val);
+                                    cache.insert_properties(Element_T::VERTEX, vp_id.value(), val);
                                 }
                             } 
                         }                        
@@ -121,9 +121,9 @@ class ValuesExpert : public AbstractExpert {
                             if (metadata_->VPKeyIsLocal(vp_id) || !config_->global_enable_caching) {
                                 metadata_->GetPropertyForVertex(tid, vp_id, val);
                             } else {
-                                if (!cache.get_property_from_cache(vp_id.value(), val)) {
+                                if (!cache.get_property_from_cache(Element_T::VERTEX, vp_id.value(), val)) {
                                     metadata_->GetPropertyForVertex(tid, vp_id, val);
-                                    cache.insert_properties(vp_id.value(), val);
+                                    cache.insert_properties(Element_T::VERTEX, vp_id.value(), val);
                                 }
                             }
                         }                        
@@ -157,10 +157,10 @@ class ValuesExpert : public AbstractExpert {
                         if (metadata_->EPKeyIsLocal(ep_id) || !config_->global_enable_caching) {
                             metadata_->GetPropertyForEdge(tid, ep_id, val);
                         } else {
-                            if (!cache.get_property_from_cache(ep_id.value(), val)) {
+                            if (!cache.get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                                 // not found in cache
                                 metadata_->GetPropertyForEdge(tid, ep_id, val);
-                                cache.insert_properties(ep_id.value(), val);
+                                cache.insert_properties(Element_T::EDGE, ep_id.value(), val);
                             }
                         }
 
@@ -177,10 +177,10 @@ class ValuesExpert : public AbstractExpert {
                         if (metadata_->EPKeyIsLocal(ep_id) || !config_->global_enable_caching) {
                             metadata_->GetPropertyForEdge(tid, ep_id, val);
                         } else {
-                            if (!cache.get_property_from_cache(ep_id.value(), val)) {
+                            if (!cache.get_property_from_cache(Element_T::EDGE, ep_id.value(), val)) {
                                 // not found in cache
                                 metadata_->GetPropertyForEdge(tid, ep_id, val);
-                                cache.insert_properties(ep_id.value(), val);
+                                cache.insert_properties(Element_T::EDGE, ep_id.value(), val);
                             }
                         }
 
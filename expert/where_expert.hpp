@@ -95,7 +95,7 @@ class WhereExpert : public AbstractExpert {
 
         // Send Message
         for (auto& msg : msg_vec) {
-            mailbox_->Send(tid, msg);
+            mailbox_->Send(tid, move(msg));
         }
     }
 
@@ -209,7 +209,7 @@ class WhereExpert : public AbstractExpert {
     bool GetHistoryValue(history_t & data_his, vector<int> step_labels, vector<value_t> & his_val) {
         int counter = step_labels.size();
         for (auto & step_label : step_labels) {
-            history_t::iterator his_itr = data_his.begin();
+            history_t::const_iterator his_itr = data_his.begin();
             do {
                 if ((*his_itr).first == step_label) {
                     his_val.push_back((*his_itr).second);
@@ -6,6 +6,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "storage/data_store.hpp"
 #include "storage/mpi_snapshot.hpp"
 #include "storage/snapshot_func.hpp"
+#include "storage/vertex_order.hpp"
 
 DataStore::DataStore(Node & node, AbstractIdMapper * id_mapper, RemoteBuffer * buf): node_(node), id_mapper_(id_mapper), remote_buffer_(buf) {
     // TODO(big) new datastore both in remote and local server
@@ -98,11 +99,32 @@ void DataStore::LoadDataFromHDFS() {
 // }
 
 void DataStore::DataConverter() {
+    uint64_t v_next;
     // MPISnapshot* snapshot = MPISnapshot::GetInstance();
     // if (!snapshot->TestRead("datastore_v_table")) {
-        for (int i = 0 ; i < vertices.size(); ++i) {
+        // place vertices and their ext nbs in order
+        vector<int> placement;
+        VertexOrder::Compute(config_->global_vertex_order, vertices, in_nbs_list, out_nbs_list, vtx_label, placement);
+        if (config_->global_vertex_order != ORDER_NONE) {
+            VertexOrder::ToSlots(vertices, placement, graph_meta_.v_slots);
+            v_table_->set_slots(graph_meta_.v_slots);
+        }
+
+        // first nbs of each vertex are inline in its record, the rest in ext
+        graph_meta_.v_in_nbs = pick_inline_nbs(config_->global_vertex_in_nbs, in_nbs_list);
+        graph_meta_.v_out_nbs = pick_inline_nbs(config_->global_vertex_out_nbs, out_nbs_list);
+        fit_inline_nbs();
+        v_table_->set_inline_nbs(graph_meta_.v_in_nbs, graph_meta_.v_out_nbs);
+
+        for (int i : placement) {
             Vertex* m_v = v_table_->insert(vertices[i]->id);
             memcpy((void *)m_v, (void *)vertices[i], sizeof(Vertex));
+            m_v->num_in_inline = to_inline_nbs(in_nbs_list[i], graph_meta_.v_in_nbs, m_v->inline_in_nbs());
+            m_v->num_out_inline = to_inline_nbs(out_nbs_list[i], graph_meta_.v_out_nbs, m_v->inline_out_nbs(graph_meta_.v_in_nbs));
+            m_v->ext_in_nbs_ptr = to_ext_nbs(in_nbs_list[i]);
+            m_v->ext_out_nbs_ptr = to_ext_nbs(out_nbs_list[i]);
+            vector<Nbs_pair>().swap(in_nbs_list[i]);
+            vector<Nbs_pair>().swap(out_nbs_list[i]);
         }
 
         //==================insert vtx label to struct vertex
@@ -111,10 +133,28 @@ void DataStore::DataConverter() {
             m_v->label = it->second;
         }
 
+        // vertices added by compute nodes take vids after loaded ones
+        v_next = graph_meta_.v_num;
+        for (auto v : vertices)
+            v_next = max(v_next, (uint64_t)v->id.value() + 1);
+        graph_meta_.v_loaded_next = v_next;
+
+        //==================vids of each label for hasLabel at init
+        for (auto v : vertices) {
+            uint32_t vid = v->id.value();
+            auto itr = vtx_label.find(vid);
+            graph_meta_.v_label_vids[itr == vtx_label.end() ? 0 : itr->second].push_back(vid);
+        }
+        for (auto & item : graph_meta_.v_label_vids)
+            sort(item.second.begin(), item.second.end());
+
         // clean the vp_buf
         for (int i = 0 ; i < vp_buf.size(); i++) delete vp_buf[i];
         vector<vp_list*>().swap(vp_buf);
+        for (int i = 0 ; i < vertices.size(); i++) delete vertices[i];
         vector<Vertex*>().swap(vertices);   
+        vector<vector<Nbs_pair>>().swap(in_nbs_list);
+        vector<vector<Nbs_pair>>().swap(out_nbs_list);
     // } else {
     //     if (node_.get_local_rank() == MASTER_RANK)
     //         printf("DataConverter snapshot->TestRead('datastore_v_table')\n");
@@ -144,6 +184,15 @@ void DataStore::DataConverter() {
         }
         vector<EProperty*>().swap(eplist);
     // }
+
+    // hand allocation over to compute nodes, see AllocHeader
+    AllocHeader * alloc = (AllocHeader *)(remote_buffer_->GetBuf() + config_->alloc_header_offset);
+    alloc->v_next = v_next;
+    alloc->v_ext_last = v_table_->get_ext_used();
+    alloc->vp_ext_last = vpstore_->get_last_ext();
+    alloc->vp_entry_last = vpstore_->get_last_entry();
+    alloc->ep_ext_last = epstore_->get_last_ext();
+    alloc->ep_entry_last = epstore_->get_last_entry();
 }
 
 void DataStore::get_string_indexes() {
@@ -324,56 +373,113 @@ Vertex* DataStore::to_vertex(char* line) {
 
     pch = strtok(NULL, "\t");
     int num_in_nbs = atoi(pch);
-    int in_ext_num = num_in_nbs - IN_NBS;
-    uint64_t in_ext_offset;
-    Nbs_pair* m_in_ext;
-    if (in_ext_num > 0) {
-        in_ext_offset = v_table_->sync_alloc_ext(sizeof(Nbs_pair)*in_ext_num);
-        v->ext_in_nbs_ptr = ptr_t(sizeof(Nbs_pair)*in_ext_num, in_ext_offset);
-        m_in_ext = (Nbs_pair*)(v_table_->get_ext() + in_ext_offset);
-    }
+    vector<Nbs_pair> in_nbs;
     for (int i = 0 ; i < num_in_nbs; ++i) {
         pch = strtok(NULL, " ");
         int nb_vid = atoi(pch);
         eid_t nb_eid(nb_vid, vid.value());
         label_t nb_label = edges_label[nb_eid.value()];
-        if (i < IN_NBS) {
-            v->in_nbs[i].vid = nb_vid; 
-            v->in_nbs[i].label = nb_label;
-        }
-        else {
-            m_in_ext[i-IN_NBS].vid = nb_vid;
-            m_in_ext[i-IN_NBS].label = nb_label;
-        }
+        in_nbs.push_back(Nbs_pair{vid_t(nb_vid), nb_label});
     }
+    in_nbs_list.push_back(move(in_nbs));
 
     pch = strtok(NULL, "\t");
     int num_out_nbs = atoi(pch);
-    int out_ext_num = num_out_nbs - OUT_NBS;
-    uint64_t out_ext_offset;
-    Nbs_pair* m_out_ext;
-    if (out_ext_num > 0) {
-        out_ext_offset = v_table_->sync_alloc_ext(sizeof(Nbs_pair)*out_ext_num);
-        v->ext_out_nbs_ptr = ptr_t(sizeof(Nbs_pair)*out_ext_num, out_ext_offset);
-        m_out_ext = (Nbs_pair *)(v_table_->get_ext() + out_ext_offset);
-    }
+    vector<Nbs_pair> out_nbs;
     for (int i = 0 ; i < num_out_nbs; ++i) {
         pch = strtok(NULL, " ");
         int nb_vid = atoi(pch);
         eid_t nb_eid(vid.value(), nb_vid);
         label_t nb_label = edges_label[nb_eid.value()];
-        if (i < OUT_NBS) {
-            v->out_nbs[i].vid = nb_vid;
-            v->out_nbs[i].label = nb_label;
-        }
-        else {
-            m_out_ext[i-OUT_NBS].vid = nb_vid;
-            m_out_ext[i-OUT_NBS].label = nb_label;
-        }
+        out_nbs.push_back(Nbs_pair{vid_t(nb_vid), nb_label});
     }
+    out_nbs_list.push_back(move(out_nbs));
     return v;
 }
 
+// write nbs into ext of vertex table, raw or encoded by NbsCodec
+ptr_t DataStore::to_ext_nbs(vector<Nbs_pair>& nbs) {
+    if (nbs.empty())
+        return ptr_t();
+
+    if (!graph_meta_.nbs_compressed) {
+        uint64_t sz = sizeof(Nbs_pair) * nbs.size();
+        uint64_t offset = v_table_->sync_alloc_ext(sz);
+        memcpy(v_table_->get_ext() + offset, &nbs[0], sz);
+        return ptr_t(sz, offset);
+    }
+
+    vector<char> encoded;
+    NbsCodec::Encode(nbs, encoded);
+    uint64_t offset = v_table_->sync_alloc_ext(encoded.size());
+    memcpy(v_table_->get_ext() + offset, &encoded[0], encoded.size());
+    return ptr_t(encoded.size(), offset);
+}
+
+// number of inline nbs in each vertex record, conf < 0 picks the smallest
+// number that holds all nbs of INLINE_NBS_COVERAGE percent of vertices,
+// others are in [0, MAX_INLINE_NBS] as checked by Config
+int DataStore::pick_inline_nbs(int conf, const vector<vector<Nbs_pair>>& nbs_list) {
+    if (conf >= 0)
+        return conf;
+    if (nbs_list.empty())
+        return 0;
+
+    vector<int> count(MAX_INLINE_NBS + 2, 0);
+    for (auto & nbs : nbs_list)
+        count[min(nbs.size(), (size_t)MAX_INLINE_NBS + 1)]++;
+
+    uint64_t covered = 0;
+    for (int cap = 0; cap <= MAX_INLINE_NBS; cap++) {
+        covered += count[cap];
+        if (covered * 100 >= nbs_list.size() * INLINE_NBS_COVERAGE)
+            return cap;
+    }
+    return MAX_INLINE_NBS;
+}
+
+// lower the auto picked numbers of inline nbs until records of all vids fit
+// in the main region of VertexTable, the larger one first
+void DataStore::fit_inline_nbs() {
+    uint32_t max_vid = 0;
+    for (auto v : vertices)
+        max_vid = max(max_vid, (uint32_t)v->id.value());
+    uint64_t num_slots = vertices.empty() ? 0 : (uint64_t)max_vid + 1;
+    uint64_t main_size = v_table_->get_main_size();
+
+    bool in_auto = config_->global_vertex_in_nbs < 0;
+    bool out_auto = config_->global_vertex_out_nbs < 0;
+    int & in_nbs = graph_meta_.v_in_nbs;
+    int & out_nbs = graph_meta_.v_out_nbs;
+    while (num_slots * VertexRecordSize(in_nbs, out_nbs) > main_size) {
+        bool can_in = in_auto && in_nbs > 0;
+        bool can_out = out_auto && out_nbs > 0;
+        if (can_in && (!can_out || in_nbs >= out_nbs)) {
+            in_nbs--;
+        } else if (can_out) {
+            out_nbs--;
+        } else {
+            break;
+        }
+    }
+
+    cout << "INFO: inline nbs per vertex record, in = " << in_nbs << (in_auto ? " (auto)" : "")
+         << ", out = " << out_nbs << (out_auto ? " (auto)" : "") << endl;
+    if (num_slots * VertexRecordSize(in_nbs, out_nbs) > main_size) {
+        cout << "Vertex Table ERROR: " << num_slots << " vertex records do not fit in " << main_size << " bytes." << endl;
+    }
+}
+
+// move the first cap nbs into the record at dst, return the number moved
+uint8_t DataStore::to_inline_nbs(vector<Nbs_pair>& nbs, int cap, Nbs_pair* dst) {
+    int n = min((int)nbs.size(), cap);
+    if (n == 0)
+        return 0;
+    memcpy(dst, &nbs[0], n * sizeof(Nbs_pair));
+    nbs.erase(nbs.begin(), nbs.begin() + n);
+    return n;
+}
+
 void DataStore::get_vplist() {
     // check path + arrangement
     const char * indir = config_->HDFS_VP_SUBFOLDER.c_str();
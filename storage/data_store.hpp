@@ -20,6 +20,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "core/remote_buffer.hpp"
 #include "storage/vkvstore.hpp"
 #include "storage/ekvstore.hpp"
+#include "storage/nbs_codec.hpp"
 #include "storage/vertex.hpp"
 #include "utils/hdfs_core.hpp"
 #include "utils/config.hpp"
@@ -99,9 +100,15 @@ class DataStore {
 
     GraphMeta graph_meta_;    
 
+    // percent of vertices whose nbs are all inline when VTX_IN/OUT_NBS < 0
+    static const int INLINE_NBS_COVERAGE = 80;
+
     // =========tmp usage=========
     // will not be used after data loading
     vector<Vertex*> vertices;
+    // nbs of vertices, written inline and to ext in the order of placement
+    vector<vector<Nbs_pair>> in_nbs_list;
+    vector<vector<Nbs_pair>> out_nbs_list;
     vector<VProperty*> vplist;
     vector<EProperty*> eplist;
     vector<vp_list*> vp_buf;
@@ -114,6 +121,10 @@ class DataStore {
     void get_vertices();
     void load_vertices(const char* inpath);
     Vertex* to_vertex(char* line);
+    ptr_t to_ext_nbs(vector<Nbs_pair>& nbs);
+    int pick_inline_nbs(int conf, const vector<vector<Nbs_pair>>& nbs_list);
+    void fit_inline_nbs();
+    uint8_t to_inline_nbs(vector<Nbs_pair>& nbs, int cap, Nbs_pair* dst);
 
     void get_vplist();
     void load_vplist(const char* inpath);
@@ -163,10 +163,7 @@ EKVStore::EKVStore(RemoteBuffer * buf) : buf_(buf) {
 }
 
 void EKVStore::init(GraphMeta * graph_meta, vector<Node> & nodes) {
-    // initiate keys to 0 which means empty key
-    for (uint64_t i = 0; i < num_slots; i++) {
-        keys[i] = ikey_t();
-    }
+    // keys are 0 (empty key) already, as RemoteBuffer is freshly mapped
 
     // if (!config_->global_use_rdma) {
     //     requesters.resize(config_->global_num_workers);
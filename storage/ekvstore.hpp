@@ -63,6 +63,10 @@ class EKVStore {
     // analysis
     void print_mem_usage();
 
+    // indirect buckets and entry bytes used by loading, see AllocHeader
+    uint64_t get_last_ext() { return last_ext; }
+    uint64_t get_last_entry() { return last_entry; }
+
     void ReadSnapshot();
     void WriteSnapshot();
 
@@ -20,6 +20,8 @@
 #include "base/serialization.hpp"
 #include "base/node_util.hpp"
 #include "core/buffer.hpp"
+#include "storage/kv_bucket.hpp"
+#include "storage/kv_bucket_remote.hpp"
 #include "storage/layout.hpp"
 #include "utils/mymath.hpp"
 #include "third_party/zmq.hpp"
@@ -59,6 +61,10 @@ class EKVStore_Local {
     // Get key remotely
     void get_key_remote(int tid, int dst_nid, uint64_t pid, ikey_t & key);
 
+    // Insert or update property by key remotely, see PutKeyRemote
+    // return false if the remote region is used up
+    bool put_property_remote(int tid, int dst_nid, uint64_t pid, const value_t & val);
+
  private:
    //  Config * config_;
     Buffer * buf_;
@@ -92,6 +98,9 @@ class EKVStore_Local {
 
     uint64_t num_slots;        // 1 bucket = ASSOCIATIVITY slots
     uint64_t num_buckets;      // main-header region (static)
+    uint64_t num_buckets_ext;  // indirect-header region (dynamical)
+    uint64_t num_entries;      // entry region (dynamical)
+    uint64_t alloc_offset;     // AllocHeader of the remote region
     // uint64_t num_buckets_ext;  // indirect-header region (dynamical)
    //  uint64_t num_entries;      // entry region (dynamical)
 
@@ -0,0 +1,30 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Changji Li (cjli@cse.cuhk.edu.hk)
+         Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "base/type.hpp"
+
+// Probe one bucket of the cluster chaining hash-table in VKVStore and EKVStore
+// The last slot of each bucket stores the bucket_id of its indirect header in pid,
+// bucket_id 0 is never an indirect header so it marks the end of chain
+//
+// return true if pid is found in bucket and copy the slot into key,
+// otherwise next_bucket is set to the chained bucket, or 0 if not found
+template <int ASSOCIATIVITY>
+inline bool ProbeBucket(ikey_t * bucket, uint64_t pid, ikey_t & key, uint64_t & next_bucket) {
+    for (int i = 0; i < ASSOCIATIVITY - 1; i++) {
+        if (bucket[i].pid == pid) {
+            key = bucket[i];
+            return true;
+        }
+    }
+
+    next_bucket = bucket[ASSOCIATIVITY - 1].is_empty() ? 0 : bucket[ASSOCIATIVITY - 1].pid;
+    return false;
+}
@@ -0,0 +1,77 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/type.hpp"
+#include "storage/remote_ops.hpp"
+
+// Put pid with value at ptr into the hash-table at off of the remote region,
+// from a compute node by atomics of Remote, see RdmaRemote
+//
+// Slots of a bucket are filled in order and never become empty again, so the
+// pid is either before the first empty slot of its chain or not in the table,
+// and a bucket with an empty slot ends its chain. The first empty slot is
+// claimed by CAS of its pid from 0, a racing put of the same pid loses the
+// CAS, reads the bucket again and finds the pid, so a pid never takes two
+// slots. The value is then published by CAS of the ptr. A claimed pid whose
+// ptr is still 0 is read as missing, a crash in between leaks the slot until
+// the next put of that pid. A full chain is extended by a bucket of the
+// indirect-header region allocated by FAA on ext_cursor and linked by CAS of
+// the last slot, a bucket allocated by a loser of the CAS is leaked.
+//
+// buffer is a registered local buffer of ASSOCIATIVITY + 1 slots, return false
+// if the indirect-header region is used up
+template <int ASSOCIATIVITY, class Remote>
+bool PutKeyRemote(Remote & remote, char * buffer, uint64_t off, uint64_t num_buckets, uint64_t num_buckets_ext,
+                  uint64_t ext_cursor, uint64_t pid, ptr_t ptr) {
+    ikey_t * keys = (ikey_t *)buffer;
+    uint64_t * result = (uint64_t *)(buffer + ASSOCIATIVITY * sizeof(ikey_t));
+    uint64_t bucket_id = pid % num_buckets;
+
+    while (true) {
+        uint64_t bucket_off = off + bucket_id * ASSOCIATIVITY * sizeof(ikey_t);
+        remote.Read(buffer, ASSOCIATIVITY * sizeof(ikey_t), bucket_off);
+
+        int slot = -1;
+        for (int i = 0; i < ASSOCIATIVITY - 1 && slot < 0; i++) {
+            if (keys[i].pid == pid || keys[i].is_empty())
+                slot = i;
+        }
+
+        if (slot >= 0) {
+            uint64_t slot_off = bucket_off + slot * sizeof(ikey_t);
+            if (keys[slot].is_empty()) {
+                remote.CompareAndSwap((char *)result, 0, pid, slot_off + offsetof(ikey_t, pid));
+                if (*result != 0)
+                    continue;  // claimed by another writer, read the bucket again
+            }
+
+            // ptr of a slot just claimed is still 0
+            uint64_t expected = PtrWord(keys[slot].ptr);
+            remote.CompareAndSwap((char *)result, expected, PtrWord(ptr), slot_off + offsetof(ikey_t, ptr));
+            if (*result != expected)
+                continue;  // raced with another put of pid, read the bucket again
+            return true;
+        }
+
+        if (!keys[ASSOCIATIVITY - 1].is_empty()) {
+            bucket_id = keys[ASSOCIATIVITY - 1].pid;
+            continue;
+        }
+
+        remote.FetchAndAdd((char *)result, 1, ext_cursor);
+        if (*result >= num_buckets_ext)
+            return false;
+        uint64_t new_bucket = num_buckets + *result;
+
+        uint64_t link_off = bucket_off + (ASSOCIATIVITY - 1) * sizeof(ikey_t) + offsetof(ikey_t, pid);
+        remote.CompareAndSwap((char *)result, 0, new_bucket, link_off);
+        bucket_id = *result == 0 ? new_bucket : *result;
+    }
+}
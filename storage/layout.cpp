@@ -35,13 +35,9 @@ obinstream& operator>>(obinstream& m, Nbs_pair& pair) {
 ibinstream& operator<<(ibinstream& m, const Vertex& v) {
     m << v.id;
     m << v.label;
-    for(int i = 0; i<IN_NBS; ++i) {
-        m << v.in_nbs[i];
-    }
+    m << v.num_in_inline;
+    m << v.num_out_inline;
     m << v.ext_in_nbs_ptr;
-    for(int i = 0; i<OUT_NBS; ++i) {
-        m << v.out_nbs[i];
-    }
     m << v.ext_out_nbs_ptr;
     return m;
 }
@@ -49,13 +45,9 @@ ibinstream& operator<<(ibinstream& m, const Vertex& v) {
 obinstream& operator>>(obinstream& m, Vertex& v) {
     m >> v.id;
     m >> v.label;
-    for(int i = 0; i<IN_NBS; ++i) {
-        m >> v.in_nbs[i];
-    }
+    m >> v.num_in_inline;
+    m >> v.num_out_inline;
     m >> v.ext_in_nbs_ptr;
-    for(int i = 0; i<OUT_NBS; ++i) {
-        m >> v.out_nbs[i];
-    }
     m >> v.ext_out_nbs_ptr;
     return m;
 }
@@ -154,7 +146,8 @@ obinstream& operator>>(obinstream& m, EProperty& ep) {
 
 string GraphMeta::DebugString() const {
     stringstream ss;
-    ss << "v_array_off = " << v_array_off << " v_ext_off = " << v_ext_off << " v_num = " << v_num << endl;
+    ss << "v_array_off = " << v_array_off << " v_ext_off = " << v_ext_off << " v_num = " << v_num << " nbs_compressed = " << nbs_compressed << " v_reordered = " << !v_slots.empty() << endl;
+    ss << "v_in_nbs = " << v_in_nbs << " v_out_nbs = " << v_out_nbs << " v_num_labels = " << v_label_vids.size() << " v_loaded_next = " << v_loaded_next << endl;
     ss << "vp_off = " << vp_off << " vp_num_slots = " << vp_num_slots << " vp_num_buckets = " << vp_num_buckets << endl;
     ss << "ep_off = " << ep_off << " ep_num_slots = " << ep_num_slots << " ep_num_buckets = " << ep_num_buckets << endl;
     return ss.str();
@@ -164,6 +157,12 @@ ibinstream& operator<<(ibinstream& m, const GraphMeta& graphmeta) {
     m << graphmeta.v_array_off;
     m << graphmeta.v_ext_off;
     m << graphmeta.v_num;
+    m << graphmeta.nbs_compressed;
+    m << graphmeta.v_slots;
+    m << graphmeta.v_in_nbs;
+    m << graphmeta.v_out_nbs;
+    m << graphmeta.v_label_vids;
+    m << graphmeta.v_loaded_next;
     m << graphmeta.vp_off;
     m << graphmeta.vp_num_slots;
     m << graphmeta.vp_num_buckets;
@@ -177,6 +176,12 @@ obinstream& operator>>(obinstream& m, GraphMeta& graphmeta) {
     m >> graphmeta.v_array_off;
     m >> graphmeta.v_ext_off;
     m >> graphmeta.v_num;
+    m >> graphmeta.nbs_compressed;
+    m >> graphmeta.v_slots;
+    m >> graphmeta.v_in_nbs;
+    m >> graphmeta.v_out_nbs;
+    m >> graphmeta.v_label_vids;
+    m >> graphmeta.v_loaded_next;
     m >> graphmeta.vp_off;
     m >> graphmeta.vp_num_slots;
     m >> graphmeta.vp_num_buckets;
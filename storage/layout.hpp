@@ -6,6 +6,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -13,8 +14,6 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 #include "base/type.hpp"
 #include "base/serialization.hpp"
 
-#define IN_NBS 0
-#define OUT_NBS 0
 #define EP_NBS 1
 
 using namespace std;
@@ -28,16 +27,32 @@ ibinstream& operator<<(ibinstream& m, const Nbs_pair& pair);
 
 obinstream& operator>>(obinstream& m, Nbs_pair& pair);
 
+// Header of a vertex record in VertexTable
+//
+// A record is the header followed by GraphMeta::v_in_nbs in nbs then
+// GraphMeta::v_out_nbs out nbs inline, so its size is only known at runtime,
+// see VertexRecordSize(). The first num_in_inline/num_out_inline nbs of the
+// vertex are inline, the rest are in ext.
 struct Vertex {
     vid_t id;
     label_t label;
-    Nbs_pair in_nbs[IN_NBS];
+    uint8_t num_in_inline;
+    uint8_t num_out_inline;
     ptr_t ext_in_nbs_ptr;
-    Nbs_pair out_nbs[OUT_NBS] ;
     ptr_t ext_out_nbs_ptr;
     // string DebugString() const;
+
+    Vertex() : num_in_inline(0), num_out_inline(0) {}
+
+    // inline nbs of a vertex in its record
+    Nbs_pair * inline_in_nbs() { return (Nbs_pair *)(this + 1); }
+    Nbs_pair * inline_out_nbs(int in_cap) { return inline_in_nbs() + in_cap; }
 };
 
+inline uint64_t VertexRecordSize(int in_cap, int out_cap) {
+    return sizeof(Vertex) + (in_cap + out_cap) * sizeof(Nbs_pair);
+}
+
 ibinstream& operator<<(ibinstream& m, const Vertex& v);
 
 obinstream& operator>>(obinstream& m, Vertex& v);
@@ -89,6 +104,17 @@ struct GraphMeta {
     uint64_t v_array_off;
     uint64_t v_ext_off;
     uint64_t v_num;
+    // neighbor lists in ext are encoded by NbsCodec
+    bool nbs_compressed;
+    // vertex vid is at slot v_slots[vid] of the array, empty for slot vid
+    vector<uint32_t> v_slots;
+    // number of inline in/out nbs in each vertex record
+    int v_in_nbs;
+    int v_out_nbs;
+    // sorted vids of loaded vertices of each label, vids from v_loaded_next
+    // are added by compute nodes, see AllocHeader
+    map<label_t, vector<uint32_t>> v_label_vids;
+    uint64_t v_loaded_next;
 
     // vp
     uint64_t vp_off;
@@ -112,6 +138,10 @@ struct GraphMeta {
             v_array_off(v_array_off),
             v_ext_off(v_ext_off),
             v_num(v_num),
+            nbs_compressed(false),
+            v_in_nbs(0),
+            v_out_nbs(0),
+            v_loaded_next(0),
             vp_off(vp_off),
             vp_num_slots(vp_num_slots),
             vp_num_buckets(vp_num_buckets),
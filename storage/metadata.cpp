@@ -6,7 +6,10 @@
  */
 
 
+#include <unordered_set>
+
 #include "storage/metadata.hpp"
+#include "storage/vertex_order.hpp"
 #include "storage/mpi_snapshot.hpp"
 #include "storage/snapshot_func.hpp"
 
@@ -32,6 +35,17 @@ void MetaData::Init(vector<Node> & nodes, GraphMeta& graphmeta) {
     v_array_off_ = graphmeta.v_array_off;
     v_ext_off_ = graphmeta.v_ext_off;
     v_num_ = graphmeta.v_num;
+    nbs_compressed_ = graphmeta.nbs_compressed;
+    v_slots_ = graphmeta.v_slots;
+    v_in_nbs_ = graphmeta.v_in_nbs;
+    v_out_nbs_ = graphmeta.v_out_nbs;
+    v_rec_sz_ = VertexRecordSize(v_in_nbs_, v_out_nbs_);
+    v_ext_sz_ = v_array_off_ + GiB2B(config_->global_vertex_sz_gb) - v_ext_off_;
+    alloc_off_ = buffer_->GetAllocHeaderOffset();
+    v_label_vids_ = graphmeta.v_label_vids;
+    v_loaded_next_ = graphmeta.v_loaded_next;
+    if (config_->global_enable_prefetch)
+        prefetches_.resize(config_->global_num_threads);
     
     vpstore_ = new VKVStore_Local(buffer_);
     epstore_ = new EKVStore_Local(buffer_);
@@ -52,10 +66,31 @@ void MetaData::BuildVertexIndex(vid_t v_id, Vertex& v) {
     if(vertex_index.find(v_id.value()) == vertex_index.end()) {
         // TODO: code to limit size of vertex index
         vertex_index[v_id.value()].label = v.label;
+        vertex_index[v_id.value()].num_in_inline = v.num_in_inline;
+        vertex_index[v_id.value()].num_out_inline = v.num_out_inline;
         vertex_index[v_id.value()].in_nbs_ptr = v.ext_in_nbs_ptr;
         vertex_index[v_id.value()].out_nbs_ptr = v.ext_out_nbs_ptr;
     }
 }
+// re-read the record of an indexed vertex, e.g. after nbs are appended by
+// another compute node, entries are updated in place like AppendNbs does
+void MetaData::RefreshVertexIndex(int tid, vid_t v_id) {
+    auto res = vertex_index.find(v_id.value());
+    if (res == vertex_index.end())
+        return;
+
+    char * send_buf = buffer_->GetSendBuf(tid);
+    uint64_t v_off;
+    if (!VertexOff(v_id, v_off))
+        return;
+    RDMA &rdma = RDMA::get_rdma();
+    rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, v_rec_sz_, v_off);
+
+    Vertex * rec = (Vertex *)send_buf;
+    res->second.in_nbs_ptr = rec->ext_in_nbs_ptr;
+    res->second.out_nbs_ptr = rec->ext_out_nbs_ptr;
+}
+
 // index format
 // string \t index [int]
 /*
@@ -68,42 +103,74 @@ void MetaData::BuildVertexIndex(vid_t v_id, Vertex& v) {
  *    unordered_map<string, label_t> str2vpk; //map to vtx's property key
  *    unordered_map<label_t, string> vpk2str;
  */
-void MetaData::GetVertex(int tid, vid_t v_id, Vertex& v) {
+// remote offset of vertex v_id, at its slot if vertices are reordered
+// return false if v_id has no slot, i.e. a hole in reordered vids, or its
+// record would be beyond the vertex array
+bool MetaData::VertexOff(vid_t v_id, uint64_t & off) {
+    uint64_t slot = v_id.value();
+    if (!v_slots_.empty() && slot < v_slots_.size()) {
+        if (v_slots_[slot] == VertexOrder::NO_SLOT)
+            return false;
+        slot = v_slots_[slot];
+    }
+    off = v_array_off_ + slot * v_rec_sz_;
+    return off + v_rec_sz_ <= v_ext_off_;
+}
+
+// read the record of v_id with its inline nbs into send buf
+// return NULL if v_id is not a vertex
+Vertex * MetaData::ReadVertexRecord(int tid, vid_t v_id) {
     char * send_buf = buffer_->GetSendBuf(tid);
-    uint64_t v_off = v_array_off_ + v_id.value() * sizeof(Vertex); // LCY: check vid start from
+    uint64_t v_off;
+    if (!VertexOff(v_id, v_off))
+        return NULL;
 
     RDMA &rdma = RDMA::get_rdma();
-    rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, sizeof(Vertex), v_off);
+    rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, v_rec_sz_, v_off);
 
-    memcpy(&v, send_buf, sizeof(Vertex));
+    Vertex * rec = (Vertex *)send_buf;
+    BuildVertexIndex(v_id, *rec);
+    return rec;
+}
 
-    BuildVertexIndex(v_id, v);
+bool MetaData::GetVertex(int tid, vid_t v_id, Vertex& v) {
+    Vertex * rec = ReadVertexRecord(tid, v_id);
+    if (rec == NULL)
+        return false;
+    memcpy(&v, rec, sizeof(Vertex));
 
     #ifdef TEST_WITH_COUNT
         // RecordVtx(sizeof(Vertex));
         RecordAccess(ACCESS_T::VTX);
     #endif // DEBUG
-    return;
+    return true;
 }
 
 void MetaData::GetVertexBatch(int tid, vector<vid_t> v_ids, vector<Vertex>& vertice) {
     char * send_buf = buffer_->GetSendBuf(tid);
     vector<uint64_t> off;
     for(auto vid: v_ids) {
-        off.push_back(v_array_off_ + vid.value() * sizeof(Vertex));
+        uint64_t v_off;
+        if (VertexOff(vid, v_off))
+            off.push_back(v_off);
     }
 
     RDMA &rdma = RDMA::get_rdma();
     int len, begin = 0;
     int remain = off.size();   
     while(remain > 0) {
-        len = remain > MTU/sizeof(Vertex) ? MTU/sizeof(Vertex): remain;
+        int per_batch = max(MTU/v_rec_sz_, (uint64_t)1);
+        len = remain > per_batch ? per_batch : remain;
 
-        rdma.dev->RdmaReadBatch(tid, REMOTE_NID, send_buf, sizeof(Vertex), off, begin, len);
+        if (config_->global_rdma_coalesce_gap > 0) {
+            rdma.dev->RdmaReadCoalesced(tid, REMOTE_NID, send_buf, buffer_->GetSendBufSize(), v_rec_sz_, off, begin, len, config_->global_rdma_coalesce_gap);
+        } else {
+            rdma.dev->RdmaReadBatch(tid, REMOTE_NID, send_buf, v_rec_sz_, off, begin, len);
+        }
 
         for(int i = 0; i < len; ++i) {
             Vertex tmp;
-            memcpy(&tmp, send_buf + i * sizeof(Vertex), sizeof(Vertex));
+            memcpy(&tmp, send_buf + i * v_rec_sz_, sizeof(Vertex));
             vertice.emplace_back(tmp);
             BuildVertexIndex(tmp.id, tmp);
         }
@@ -118,46 +185,126 @@ void MetaData::GetVertexBatch(int tid, vector<vid_t> v_ids, vector<Vertex>& vert
     return;
 }
 
-int MetaData::GetInNbs(int tid, vid_t v, vector<Nbs_pair>& in_nbs) {
+// records are merged by the coalesce gap as in GetVertexBatch, they land in
+// the prefetch buffer since send buf is written by mailbox meanwhile
+bool MetaData::PostPrefetch(int tid, const vector<vid_t>& v_ids) {
+    prefetch_t & p = prefetches_[tid];
+    char * buf = buffer_->GetPrefetchBuf(tid);
+    uint64_t buf_sz = buffer_->GetPrefetchBufSize();
+    // records in the first half, merged reads are staged in the rest
+    uint64_t max_num = min(PREFETCH_MAX_VTX, buf_sz / 2 / v_rec_sz_);
+
+    p.vids.clear();
+    p.off.clear();
+    unordered_set<uint32_t> seen;
+    for (auto vid : v_ids) {
+        if (p.vids.size() >= max_num)
+            break;
+        uint64_t v_off;
+        if (vertex_index.find(vid.value()) != vertex_index.end() || !seen.insert(vid.value()).second || !VertexOff(vid, v_off))
+            continue;
+        p.vids.push_back(vid);
+        p.off.push_back(v_off);
+    }
+    if (p.vids.empty())
+        return false;
+
+    uint64_t rec_sz = p.vids.size() * v_rec_sz_;
+    p.planner.Plan(&p.off[0], p.off.size(), v_rec_sz_, buf, config_->global_rdma_coalesce_gap, buf + rec_sz, buf_sz - rec_sz, p.spans);
+    RDMA &rdma = RDMA::get_rdma();
+    return rdma.dev->RdmaPostReadSpans(tid, REMOTE_NID, p.spans) == 0;
+}
+
+void MetaData::CompletePrefetch(int tid) {
+    prefetch_t & p = prefetches_[tid];
+    RDMA &rdma = RDMA::get_rdma();
+    if (rdma.dev->RdmaPollCompletion(tid, REMOTE_NID) != 0) {
+        cout << "ERROR: MetaData::CompletePrefetch failed to read " << p.vids.size() << " vertices" << endl;
+        return;
+    }
+    p.planner.Scatter();
+
+    char * buf = buffer_->GetPrefetchBuf(tid);
+    for (size_t i = 0; i < p.vids.size(); i++) {
+        Vertex * v = (Vertex *)(buf + i * v_rec_sz_);
+        // slots of vertices being added are not written yet
+        if (v->id.value() == p.vids[i].value())
+            BuildVertexIndex(p.vids[i], *v);
+    }
+}
+
+// append nbs read into buf to nbs, return the number of nbs
+int MetaData::DecodeNbs(char * buf, uint64_t sz, vector<Nbs_pair>& nbs) {
+    if (nbs_compressed_) {
+        return NbsCodec::Decode(buf, nbs);
+    }
+    int num = sz/sizeof(Nbs_pair);
+    Nbs_pair* recv = (Nbs_pair*)buf;
+    nbs.insert(nbs.end(), recv, recv + num);
+    return num;
+}
+
+// inline nbs of v come with its record, the rest are read from ext. When the
+// record is cached and both parts are needed, they are read in one batch
+int MetaData::GetNbs(int tid, vid_t v, bool is_in, vector<Nbs_pair>& nbs) {
     int size = 0;
-    Vertex tmpv;
+    char * send_buf = buffer_->GetSendBuf(tid);
+    Vertex * rec = NULL;
+    int num_inline;
+    ptr_t ext;
+    bool ext_read = false;
+
+    RDMA &rdma = RDMA::get_rdma();
     auto res = vertex_index.find(v.value());
     if(res == vertex_index.end()) {
-        GetVertex(tid, v, tmpv);
-
-        // NEW: store all nbs in ext
-        // for(size = 0; size < IN_NBS; ++size) {
-        //     if(tmpv.in_nbs[size].vid == 0)
-        //         break;
-        //     in_nbs.push_back(tmpv.in_nbs[size]);
-        // }
-    } 
-    else {
-        tmpv.ext_in_nbs_ptr = res->second.in_nbs_ptr; 
-        tmpv.ext_out_nbs_ptr = res->second.out_nbs_ptr; 
-    }
-
-    if(tmpv.ext_in_nbs_ptr.size != 0) {
-        // has ext in nbs
-        char * send_buf = buffer_->GetSendBuf(tid);
-        uint64_t off = v_ext_off_ + tmpv.ext_in_nbs_ptr.off;
-        uint64_t sz = tmpv.ext_in_nbs_ptr.size;
-        
-        RDMA &rdma = RDMA::get_rdma();
-        rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, sz, off);
-        
-        int num = sz/sizeof(Nbs_pair);
-        Nbs_pair* recv = (Nbs_pair*)send_buf;
-        for(int i = 0; i<num; ++i) {
-            in_nbs.push_back(recv[i]);
-            size++;
+        rec = ReadVertexRecord(tid, v);
+        if (rec == NULL)
+            return 0;
+        num_inline = is_in ? rec->num_in_inline : rec->num_out_inline;
+        ext = is_in ? rec->ext_in_nbs_ptr : rec->ext_out_nbs_ptr;
+    } else {
+        num_inline = is_in ? res->second.num_in_inline : res->second.num_out_inline;
+        ext = is_in ? res->second.in_nbs_ptr : res->second.out_nbs_ptr;
+        // indexed vertices have slots
+        uint64_t v_off;
+        VertexOff(v, v_off);
+        if (num_inline != 0 && ext.size != 0) {
+            vector<ReadSpan> spans{ReadSpan{v_off, v_rec_sz_, send_buf},
+                                   ReadSpan{v_ext_off_ + ext.off, ext.size, send_buf + v_rec_sz_}};
+            rdma.dev->RdmaReadSpans(tid, REMOTE_NID, spans);
+            rec = (Vertex *)send_buf;
+            ext_read = true;
+        } else if (num_inline != 0) {
+            rec = ReadVertexRecord(tid, v);
+        }
+    }
+
+    if (num_inline != 0) {
+        Nbs_pair * inline_nbs = is_in ? rec->inline_in_nbs() : rec->inline_out_nbs(v_in_nbs_);
+        nbs.insert(nbs.end(), inline_nbs, inline_nbs + num_inline);
+        size += num_inline;
+    }
+
+    if(ext.size != 0) {
+        // has ext nbs, already behind the record if read together
+        char * ext_buf = send_buf + v_rec_sz_;
+        if (!ext_read) {
+            ext_buf = send_buf;
+            rdma.dev->RdmaRead(tid, REMOTE_NID, ext_buf, ext.size, v_ext_off_ + ext.off);
         }
 
+        int num = DecodeNbs(ext_buf, ext.size, nbs);
+        size += num;
+
         #ifdef TEST_WITH_COUNT
-            RecordAccess(ACCESS_T::INNBS);
-            // RecordVin(num*sizeof(Nbs_pair));
+            RecordAccess(is_in ? ACCESS_T::INNBS : ACCESS_T::OUTNBS);
         #endif
     }
+    return size;
+}
+
+int MetaData::GetInNbs(int tid, vid_t v, vector<Nbs_pair>& in_nbs) {
+    int size = GetNbs(tid, v, true, in_nbs);
 #ifdef DEBUG
     std::cout << "In Nbs = ";
     for(auto it = in_nbs.begin(); it != in_nbs.end(); ++it) {
@@ -169,42 +316,7 @@ int MetaData::GetInNbs(int tid, vid_t v, vector<Nbs_pair>& in_nbs) {
 };
 
 int MetaData::GetOutNbs(int tid, vid_t v, vector<Nbs_pair>& out_nbs) {
-    int size = 0;
-    Vertex tmpv;
-    auto res = vertex_index.find(v.value());
-    if(res == vertex_index.end()) {
-        GetVertex(tid, v, tmpv);
-    // for(size = 0; size < OUT_NBS; ++size) {
-    //     if(v.out_nbs[size].vid == 0) 
-    //         break; // TODO(big): check that no vid is 0
-    //     out_nbs.push_back(v.out_nbs[size]);
-    // }
-    }
-    else {
-        tmpv.ext_in_nbs_ptr = res->second.in_nbs_ptr;
-        tmpv.ext_out_nbs_ptr = res->second.out_nbs_ptr;
-    }
-    if(tmpv.ext_out_nbs_ptr.size != 0) {
-        // has ext out nbs
-        char * send_buf = buffer_->GetSendBuf(tid);
-        uint64_t off = v_ext_off_ + tmpv.ext_out_nbs_ptr.off;
-        uint64_t sz = tmpv.ext_out_nbs_ptr.size;
-        
-        RDMA &rdma = RDMA::get_rdma();
-        rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, sz, off);
-        
-        int num = sz/sizeof(Nbs_pair);
-        Nbs_pair * recv = (Nbs_pair*)send_buf;
-        for(int i = 0; i<num; ++i) {
-            out_nbs.push_back(recv[i]);
-            size++;
-        }
-
-        #ifdef TEST_WITH_COUNT
-            // RecordVout(num*sizeof(Nbs_pair));
-            RecordAccess(ACCESS_T::OUTNBS);
-        #endif
-    }
+    int size = GetNbs(tid, v, false, out_nbs);
 #ifdef DEBUG
     std::cout << "Out Nbs = ";
     for(auto it = out_nbs.begin(); it != out_nbs.end(); ++it) {
@@ -215,49 +327,298 @@ int MetaData::GetOutNbs(int tid, vid_t v, vector<Nbs_pair>& out_nbs) {
     return size;
 };
 
-void MetaData::GetAllVertices(int tid, vector<vid_t> & vid_list) {
-    uint64_t buf_size = buffer_->GetSendBufSize();
-    int per_read_num = buf_size/sizeof(Vertex);
-    int count = 0;
-    int remain = v_num_;
-    while(remain > 0) {
-        int read_sz = remain > per_read_num ? per_read_num : remain;
-        
-        char* send_buf = buffer_->GetSendBuf(tid);
-        uint64_t off = v_array_off_ + count * sizeof(Vertex);
-        uint64_t size = read_sz * sizeof(Vertex);
-
-        RDMA &rdma = RDMA::get_rdma();
-        rdma.dev->RdmaRead(tid, node_.get_local_rank(), send_buf, size, off);
-        Vertex* v = (Vertex *)send_buf;
-
-        for(int i = 0; i < read_sz; ++i) {
-            BuildVertexIndex(v[i].id, v[i]);
-		    vid_list.push_back(v[i].id);
+// vertices added by compute nodes have records at their vids, see AddVertex
+// which are read from the remote region
+bool MetaData::AddVertex(int tid, label_t label, vid_t & v_id) {
+    char * send_buf = buffer_->GetSendBuf(tid);
+    RDMA &rdma = RDMA::get_rdma();
+
+    rdma.dev->RdmaFetchAndAdd(tid, REMOTE_NID, send_buf, 1, alloc_off_ + offsetof(AllocHeader, v_next));
+    uint64_t vid = *(uint64_t *)send_buf;
+    if (vid >= (1 << VID_BITS))
+        return false;
+    v_id = vid_t(vid);
+    uint64_t v_off;
+    if (!VertexOff(v_id, v_off))
+        return false;
+
+    // no nbs yet, a crash before the write leaves a record of id 0 that
+    // ScanVertices skips
+    memset(send_buf, 0, v_rec_sz_);
+    Vertex * rec = (Vertex *)send_buf;
+    rec->id = v_id;
+    rec->label = label;
+    rdma.dev->RdmaWrite(tid, REMOTE_NID, send_buf, v_rec_sz_, v_off);
+    return true;
+}
+
+// out nbs of src then in nbs of dst, the two appends are not atomic: if the
+// second fails or the node crashes in between, the edge is visible from src
+// only and nothing repairs it
+bool MetaData::AddEdge(int tid, vid_t src, vid_t dst, label_t label) {
+    return AppendNbs(tid, src, false, Nbs_pair{dst, label}) && AppendNbs(tid, dst, true, Nbs_pair{src, label});
+}
+
+// added nbs are never inline, as the record is not rewritten, see AppendNbsRemote
+bool MetaData::AppendNbs(int tid, vid_t v, bool is_in, const Nbs_pair & nb) {
+    RdmaRemote remote(tid, REMOTE_NID);
+    uint64_t v_off;
+    if (!VertexOff(v, v_off))
+        return false;
+    uint64_t ptr_off = v_off + (is_in ? offsetof(Vertex, ext_in_nbs_ptr) : offsetof(Vertex, ext_out_nbs_ptr));
+    ptr_t new_ptr;
+    if (!AppendNbsRemote(remote, buffer_->GetSendBuf(tid), buffer_->GetSendBufSize(), ptr_off, v_ext_off_, v_ext_sz_,
+                         alloc_off_ + offsetof(AllocHeader, v_ext_last), nbs_compressed_, nb, new_ptr))
+        return false;
+
+    auto res = vertex_index.find(v.value());
+    if (res != vertex_index.end()) {
+        (is_in ? res->second.in_nbs_ptr : res->second.out_nbs_ptr) = new_ptr;
+    }
+    return true;
+}
+
+bool MetaData::SetPropertyForVertex(int tid, vpid_t vp_id, const value_t & val) {
+    return vpstore_->put_property_remote(tid, REMOTE_NID, vp_id.value(), val);
+}
+
+bool MetaData::SetPropertyForEdge(int tid, epid_t ep_id, const value_t & val) {
+    return epstore_->put_property_remote(tid, id_mapper_->GetMachineIdForEProperty(ep_id), ep_id.value(), val);
+}
+
+// number of slots of the vertex array in use, including vertices added after
+// loading
+uint64_t MetaData::NumVertexSlots(int tid) {
+    RDMA &rdma = RDMA::get_rdma();
+    char * send_buf = buffer_->GetSendBuf(tid);
+    rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, sizeof(uint64_t), alloc_off_ + offsetof(AllocHeader, v_next));
+    return max(v_num_, *(uint64_t *)send_buf);
+}
+
+// v_next and v_ext_last are next to each other, see AllocHeader
+uint64_t MetaData::GraphVersion(int tid) {
+    RDMA &rdma = RDMA::get_rdma();
+    char * send_buf = buffer_->GetSendBuf(tid);
+    rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, 2 * sizeof(uint64_t), alloc_off_ + offsetof(AllocHeader, v_next));
+    return ((uint64_t *)send_buf)[0] + ((uint64_t *)send_buf)[1];
+}
+
+bool MetaData::ScanVertices(int tid, uint64_t begin, uint64_t end, uint64_t chunk, function<void(vector<vid_t>&)> consume) {
+    RDMA &rdma = RDMA::get_rdma();
+    // halves of send buf, one is read into while the other is decoded, each
+    // by at most SCAN_MAX_SPANS spans
+    char * send_buf = buffer_->GetSendBuf(tid);
+    uint64_t per_read_num = min(buffer_->GetSendBufSize() / 2, SCAN_MAX_SPANS * SCAN_SPAN_SZ) / v_rec_sz_;
+    char * halves[2] = {send_buf, send_buf + per_read_num * v_rec_sz_};
+
+    vector<ReadSpan> spans;
+    auto post = [&](uint64_t first, uint64_t num, char * buf) {
+        uint64_t size = num * v_rec_sz_;
+        uint64_t off = v_array_off_ + first * v_rec_sz_;
+        spans.clear();
+        for (uint64_t pos = 0; pos < size; pos += SCAN_SPAN_SZ) {
+            spans.push_back(ReadSpan{off + pos, min(SCAN_SPAN_SZ, size - pos), buf + pos});
         }
+        return rdma.dev->RdmaPostReadSpans(tid, REMOTE_NID, spans) == 0;
+    };
+    auto poll = [&]() {
+        return rdma.dev->RdmaPollCompletion(tid, REMOTE_NID) == 0;
+    };
+    auto decode = [&](uint64_t first, uint64_t num, char * buf, vector<vid_t> & vids) {
+        for (uint64_t i = 0; i < num; i++) {
+            Vertex * v = (Vertex *)(buf + i * v_rec_sz_);
+            // added vertices are at slot vid, others beyond loaded ones are empty
+            uint64_t slot = first + i;
+            if (slot >= v_num_ && v->id.value() != slot)
+                continue;
+            BuildVertexIndex(v->id, *v);
+            vids.push_back(v->id);
+        }
+    };
 
-        count += read_sz;
-        remain -= read_sz;
+    bool success = ScanWindows<vid_t>(begin, end, per_read_num, halves, chunk, post, poll, decode, consume);
+    if (!success) {
+        cout << "ERROR: MetaData::ScanVertices failed to read" << endl;
     }
 
     #ifdef TEST_WITH_COUNT
-        // RecordVtx(sizeof(Vertex)*v_num_);
         PrintIndexMem();
     #endif
+    return success;
 }
 
-void MetaData::GetAllEdges(int tid, vector<eid_t> & eid_list) {
-    for(auto it = vertex_index.begin(); it != vertex_index.end(); ++it) {
-        vid_t vid;
-        uint2vid_t(it->first,vid);
-        vector<Nbs_pair> out_nbs;
-        int nbs_sz = GetOutNbs(tid, vid, out_nbs);
-        for(int j = 0; j < nbs_sz; ++j) {
-            eid_list.push_back(eid_t(it->first, out_nbs[j].vid.value()));
+void MetaData::GetVerticesByLabel(int tid, label_t label, vector<vid_t> & vid_list) {
+    auto itr = v_label_vids_.find(label);
+    if (itr != v_label_vids_.end()) {
+        for (uint32_t vid : itr->second) {
+            vid_list.push_back(vid_t(vid));
+        }
+    }
+
+    // vertices added after loading are not listed, check their records
+    RDMA &rdma = RDMA::get_rdma();
+    uint64_t v_next = NumVertexSlots(tid);
+    char * send_buf = buffer_->GetSendBuf(tid);
+
+    uint64_t per_read_num = buffer_->GetSendBufSize() / v_rec_sz_;
+    for (uint64_t vid = v_loaded_next_; vid < v_next; vid += per_read_num) {
+        // added vertices are at slot vid, within the vertex array
+        uint64_t read_sz = min(per_read_num, v_next - vid);
+        rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, read_sz * v_rec_sz_, v_array_off_ + vid * v_rec_sz_);
+        for (uint64_t i = 0; i < read_sz; ++i) {
+            Vertex* v = (Vertex *)(send_buf + i * v_rec_sz_);
+            if (v->id.value() == vid + i && v->label == label) {
+                vid_list.push_back(v->id);
+            }
         }
     }
 }
 
+bool MetaData::ScanEdges(int tid, uint64_t begin, uint64_t end, uint64_t chunk, function<void(vector<eid_t>&, vector<label_t>&)> consume) {
+    // ext out nbs of a vertex to read
+    struct ExtList {
+        uint64_t off;
+        uint64_t size;
+        uint32_t vid;
+        char * local;
+    };
+
+    RDMA &rdma = RDMA::get_rdma();
+    char * send_buf = buffer_->GetSendBuf(tid);
+    uint64_t buf_size = buffer_->GetSendBufSize();
+    // records of a window are read by at most SCAN_MAX_SPANS spans
+    uint64_t per_read_num = min(buf_size, SCAN_MAX_SPANS * SCAN_SPAN_SZ) / v_rec_sz_;
+
+    vector<eid_t> eids;
+    vector<label_t> labels;
+    vector<ExtList> lists;
+    vector<ReadSpan> spans;
+    vector<Nbs_pair> nbs;
+    // a list larger than send buf
+    vector<char> large;
+
+    auto emit = [&](uint32_t vid, const Nbs_pair * begin, const Nbs_pair * end) {
+        for (const Nbs_pair * nb = begin; nb != end; nb++) {
+            eids.emplace_back(vid, nb->vid.vid);
+            labels.push_back(nb->label);
+        }
+    };
+    // only called when send_buf holds nothing pending, consume may read with it
+    auto flush = [&](uint64_t least) {
+        if (eids.size() >= least && !eids.empty()) {
+            consume(eids, labels);
+            eids.clear();
+            labels.clear();
+        }
+    };
+    auto read_spans = [&]() {
+        if (rdma.dev->RdmaReadSpans(tid, REMOTE_NID, spans) != 0) {
+            cout << "ERROR: MetaData::ScanEdges failed to read " << spans.size() << " spans" << endl;
+            return false;
+        }
+        return true;
+    };
+
+    for (uint64_t first = begin; first < end; first += per_read_num) {
+        // a window of records by reads of SCAN_SPAN_SZ in flight together
+        uint64_t num = min(per_read_num, end - first);
+        uint64_t off = v_array_off_ + first * v_rec_sz_;
+        uint64_t size = num * v_rec_sz_;
+        spans.clear();
+        for (uint64_t pos = 0; pos < size; pos += SCAN_SPAN_SZ) {
+            spans.push_back(ReadSpan{off + pos, min(SCAN_SPAN_SZ, size - pos), send_buf + pos});
+        }
+        if (!read_spans())
+            return false;
+
+        lists.clear();
+        for (uint64_t i = 0; i < num; i++) {
+            Vertex * v = (Vertex *)(send_buf + i * v_rec_sz_);
+            // added vertices are at slot vid, others beyond loaded ones are empty
+            uint64_t slot = first + i;
+            if (slot >= v_num_ && v->id.value() != slot)
+                continue;
+
+            Nbs_pair * inline_nbs = v->inline_out_nbs(v_in_nbs_);
+            emit(v->id.value(), inline_nbs, inline_nbs + v->num_out_inline);
+            if (v->ext_out_nbs_ptr.size != 0) {
+                lists.push_back(ExtList{v->ext_out_nbs_ptr.off, v->ext_out_nbs_ptr.size, v->id.value(), NULL});
+            }
+        }
+        flush(chunk);
+
+        // ext lists of the window, close to each other as ext is written in
+        // the order of vertices, read by spans covering many lists
+        sort(lists.begin(), lists.end(), [](const ExtList & l, const ExtList & r) { return l.off < r.off; });
+        size_t i = 0;
+        while (i < lists.size()) {
+            // a hub list larger than send buf is read by pieces alone
+            if (lists[i].size > buf_size) {
+                if (!ReadByPieces(tid, v_ext_off_ + lists[i].off, lists[i].size, large))
+                    return false;
+                nbs.clear();
+                DecodeNbs(&large[0], lists[i].size, nbs);
+                emit(lists[i].vid, nbs.data(), nbs.data() + nbs.size());
+                flush(chunk);
+                i++;
+                continue;
+            }
+
+            // as many lists as fit in send buf by at most SCAN_MAX_SPANS spans
+            spans.clear();
+            uint64_t used = 0;
+            size_t j = i;
+            for (; j < lists.size() && lists[j].size <= buf_size; j++) {
+                ExtList & l = lists[j];
+                uint64_t remote = v_ext_off_ + l.off;
+                if (!spans.empty() && remote + l.size - spans.back().off <= SCAN_SPAN_SZ
+                        && used + remote + l.size - spans.back().off - spans.back().len <= buf_size) {
+                    // extend the last span, with the gap between
+                    ReadSpan & span = spans.back();
+                    uint64_t len = max(span.len, remote + l.size - span.off);
+                    used += len - span.len;
+                    span.len = len;
+                } else if (spans.size() < SCAN_MAX_SPANS && used + l.size <= buf_size) {
+                    spans.push_back(ReadSpan{remote, l.size, send_buf + used});
+                    used += l.size;
+                } else {
+                    break;
+                }
+                l.local = spans.back().local + (remote - spans.back().off);
+            }
+            if (!read_spans())
+                return false;
+
+            for (; i < j; i++) {
+                nbs.clear();
+                DecodeNbs(lists[i].local, lists[i].size, nbs);
+                emit(lists[i].vid, nbs.data(), nbs.data() + nbs.size());
+            }
+            flush(chunk);
+        }
+    }
+    flush(0);
+    return true;
+}
+
+// read size bytes at off of the remote region by reads of send buf size
+bool MetaData::ReadByPieces(int tid, uint64_t off, uint64_t size, vector<char> & out) {
+    RDMA &rdma = RDMA::get_rdma();
+    char * send_buf = buffer_->GetSendBuf(tid);
+    uint64_t buf_size = buffer_->GetSendBufSize();
+
+    out.resize(size);
+    for (uint64_t pos = 0; pos < size; pos += buf_size) {
+        uint64_t len = min(buf_size, size - pos);
+        if (rdma.dev->RdmaRead(tid, REMOTE_NID, send_buf, len, off + pos) != 0) {
+            cout << "ERROR: MetaData::ReadByPieces failed to read " << len << " bytes at " << off + pos << endl;
+            return false;
+        }
+        memcpy(&out[pos], send_buf, len);
+    }
+    return true;
+}
+
 bool MetaData::VPKeyIsLocal(vpid_t vp_id) {
     return false;
 }
@@ -298,7 +659,11 @@ bool MetaData::GetLabelForVertex(int tid, vid_t vid, label_t & label) {
     }
     else {
         Vertex v;
-        GetVertex(tid, vid, v);
+        // as a zeroed record for callers that do not check
+        if (!GetVertex(tid, vid, v)) {
+            label = 0;
+            return false;
+        }
         label = v.label;
     }
 
@@ -13,6 +13,7 @@
 // #define DEBUG
 #define PRINT_MEM_USAGE
 
+#include <functional>
 #include <mutex>
 #include <string>
 #include <stdlib.h>
@@ -30,6 +31,10 @@
 #include "storage/ekvstore_local.hpp"
 #include "storage/vertex.hpp"
 #include "storage/edge.hpp"
+#include "storage/nbs_codec.hpp"
+#include "storage/nbs_remote.hpp"
+#include "base/read_planner.hpp"
+#include "storage/scan_pipeline.hpp"
 #include "utils/hdfs_core.hpp"
 #include "utils/config.hpp"
 #include "utils/unit.hpp"
@@ -41,6 +46,8 @@ using __gnu_cxx::hash_set;
 
 struct v_cache {
     label_t label;
+    uint8_t num_in_inline;
+    uint8_t num_out_inline;
     ptr_t in_nbs_ptr;
     ptr_t out_nbs_ptr;
 };
@@ -67,13 +74,37 @@ class MetaData {
      */
 
     // access remote
-    void GetVertex(int tid, vid_t v_id, Vertex& v);
+    // return false if v_id is not a vertex
+    bool GetVertex(int tid, vid_t v_id, Vertex& v);
+    // vertices of v_ids in order, those not found are left out
     void GetVertexBatch(int tid, vector<vid_t> v_ids, vector<Vertex>& v);
+    // start reading the records of vertices not in vertex_index into the
+    // prefetch buffer of tid, return true if reads are posted, then nothing
+    // else may read with tid before CompletePrefetch(tid)
+    bool PostPrefetch(int tid, const vector<vid_t>& v_ids);
+    // wait for reads of PostPrefetch and add the records to vertex_index
+    void CompletePrefetch(int tid);
 
     void BuildVertexIndex(vid_t v_id, Vertex& v);
-
-    void GetAllVertices(int tid, vector<vid_t> & vid_list);
-    void GetAllEdges(int tid, vector<eid_t> & eid_list);
+    void RefreshVertexIndex(int tid, vid_t v_id);
+
+    // number of slots of the vertex array in use, scans go over [0, slots)
+    uint64_t NumVertexSlots(int tid);
+    // grows with every vertex added and nbs appended by any compute node,
+    // results of scans stay valid while it is unchanged
+    uint64_t GraphVersion(int tid);
+    // stream out vids of vertices at slots [begin, end), reads of the next
+    // window are in flight while the current one is decoded, consume is
+    // called each time about chunk vids are collected, see ScanWindows,
+    // return false if a read fails, the scan stops there
+    bool ScanVertices(int tid, uint64_t begin, uint64_t end, uint64_t chunk, function<void(vector<vid_t>&)> consume);
+    // sorted vids of vertices with label, by label lists from the memory node
+    void GetVerticesByLabel(int tid, label_t label, vector<vid_t> & vid_list);
+    // stream out edges of vertices at slots [begin, end) with their labels,
+    // by large reads of the vertex array and ext instead of a read per
+    // vertex, consume is called each time about chunk edges are collected,
+    // return false if a read fails, the scan stops there
+    bool ScanEdges(int tid, uint64_t begin, uint64_t end, uint64_t chunk, function<void(vector<eid_t>&, vector<label_t>&)> consume);
 
     bool GetPropertyForVertex(int tid, vpid_t vp_id, value_t & val);
     bool GetPropertyForEdge(int tid, epid_t ep_id, value_t & val);
@@ -82,6 +113,13 @@ class MetaData {
     int GetInNbs(int tid, vid_t v, vector<Nbs_pair>& in_nbs);
     int GetOutNbs(int tid, vid_t v, vector<Nbs_pair>& out_nbs);
 
+    // mutate remote by RDMA atomics, see AllocHeader
+    // return false if the remote region is used up
+    bool AddVertex(int tid, label_t label, vid_t & v_id);
+    bool AddEdge(int tid, vid_t src, vid_t dst, label_t label);
+    bool SetPropertyForVertex(int tid, vpid_t vp_id, const value_t & val);
+    bool SetPropertyForEdge(int tid, epid_t ep_id, const value_t & val);
+
     // Not directly access remote
     bool GetLabelForVertex(int tid, vid_t vid, label_t & label);
     bool GetLabelForEdge(int tid, eid_t eid, label_t & label);
@@ -152,6 +190,42 @@ class MetaData {
     uint64_t v_array_off_;
     uint64_t v_ext_off_;
     uint64_t v_num_;
+    bool nbs_compressed_;
+    // vid -> slot in vertex array, empty for slot vid
+    vector<uint32_t> v_slots_;
+    // inline in/out nbs and size of a vertex record
+    int v_in_nbs_;
+    int v_out_nbs_;
+    uint64_t v_rec_sz_;
+    uint64_t v_ext_sz_;
+    map<label_t, vector<uint32_t>> v_label_vids_;
+    uint64_t v_loaded_next_;
+    // AllocHeader of the remote region
+    uint64_t alloc_off_;
+    // max size of a single read of scans, many are posted at once
+    static const uint64_t SCAN_SPAN_SZ = 1 << 20;
+    // max reads of scans posted at once, far below the send queue depth of a
+    // QP (RC_MAX_SEND_SIZE)
+    static const uint64_t SCAN_MAX_SPANS = 64;
+
+    // max vertices prefetched at once, far below RC_MAX_SEND_SIZE
+    static const uint64_t PREFETCH_MAX_VTX = 256;
+
+    // reads posted by PostPrefetch of a thread
+    struct prefetch_t {
+        vector<vid_t> vids;
+        vector<uint64_t> off;
+        vector<ReadSpan> spans;
+        ReadPlanner planner;
+    };
+    vector<prefetch_t> prefetches_;
+
+    bool VertexOff(vid_t v_id, uint64_t & off);
+    Vertex * ReadVertexRecord(int tid, vid_t v_id);
+    int DecodeNbs(char * buf, uint64_t sz, vector<Nbs_pair>& nbs);
+    bool ReadByPieces(int tid, uint64_t off, uint64_t size, vector<char> & out);
+    int GetNbs(int tid, vid_t v, bool is_in, vector<Nbs_pair>& nbs);
+    bool AppendNbs(int tid, vid_t v, bool is_in, const Nbs_pair & nb);
 
     unordered_map<agg_t, vector<value_t>> agg_data_table;
     mutex agg_mutex;
@@ -0,0 +1,254 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <emmintrin.h>
+
+#include "storage/layout.hpp"
+
+// Encoding of a neighbor list in the ext region of VertexTable
+//
+// A list starts with a uint32 of the number of neighbors, its top bit tells
+// whether the list is compressed. Short lists stay raw:
+//     num | Nbs_pair * num
+// Long lists are sorted by (label, vid), then labels are run-length encoded
+// and vids of each run are delta encoded in blocks, each block bit-packed
+// with the width of its largest delta:
+//     num | 1 << 31, uint16 num_runs, (uint16 label, uint32 count) * num_runs,
+//     blocks of run 0, blocks of run 1, ...
+//     block: uint32 first vid, uint8 width, (n - 1) deltas of width bits
+// Decoding unpacks a block into deltas and restores vids by a SIMD prefix sum.
+class NbsCodec {
+ public:
+    // encode nbs into out, nbs is reordered
+    static void Encode(vector<Nbs_pair> & nbs, vector<char> & out) {
+        out.clear();
+        uint32_t num = nbs.size();
+        if (num >= MIN_COMPRESS_NBS) {
+            // keep raw if the list cannot be compressed or it does not pay off
+            if (EncodeCompressed(nbs, out) && out.size() < RawSize(num)) {
+                return;
+            }
+            out.clear();
+        }
+
+        out.resize(RawSize(num));
+        memcpy(&out[0], &num, sizeof(uint32_t));
+        if (num != 0) {
+            memcpy(&out[sizeof(uint32_t)], &nbs[0], num * sizeof(Nbs_pair));
+        }
+    }
+
+    // decode the list at buf, append to nbs, return the number of nbs
+    static int Decode(const char * buf, vector<Nbs_pair> & nbs) {
+        uint32_t head;
+        memcpy(&head, buf, sizeof(uint32_t));
+        uint32_t num = head & ~COMPRESSED_BIT;
+
+        size_t start = nbs.size();
+        nbs.resize(start + num);
+        Nbs_pair * dst = &nbs[start];
+        if (!(head & COMPRESSED_BIT)) {
+            memcpy(dst, buf + sizeof(uint32_t), num * sizeof(Nbs_pair));
+            return num;
+        }
+
+        const char * p = buf + sizeof(uint32_t);
+        uint16_t num_runs;
+        memcpy(&num_runs, p, sizeof(uint16_t));
+        p += sizeof(uint16_t);
+
+        const char * run_p = p;
+        p += num_runs * RUN_SIZE;
+
+        uint32_t vids[BLOCK_SIZE];
+        for (int r = 0; r < num_runs; r++) {
+            label_t label;
+            uint32_t count;
+            memcpy(&label, run_p, sizeof(label_t));
+            memcpy(&count, run_p + sizeof(label_t), sizeof(uint32_t));
+            run_p += RUN_SIZE;
+
+            while (count > 0) {
+                int n = min(count, (uint32_t)BLOCK_SIZE);
+                p = DecodeBlock(p, n, vids);
+                for (int i = 0; i < n; i++) {
+                    // vids fit in VID_BITS, so the whole word is written
+                    memcpy(&dst->vid, &vids[i], sizeof(uint32_t));
+                    dst->label = label;
+                    dst++;
+                }
+                count -= n;
+            }
+        }
+        return num;
+    }
+
+ private:
+    static const uint32_t COMPRESSED_BIT = 1u << 31;
+    // shorter lists are never smaller when compressed
+    static const uint32_t MIN_COMPRESS_NBS = 8;
+    static const int BLOCK_SIZE = 128;
+    static const int RUN_SIZE = sizeof(label_t) + sizeof(uint32_t);
+
+    static uint64_t RawSize(uint32_t num) {
+        return sizeof(uint32_t) + num * sizeof(Nbs_pair);
+    }
+
+    template <class T>
+    static void Append(vector<char> & out, T val) {
+        size_t pos = out.size();
+        out.resize(pos + sizeof(T));
+        memcpy(&out[pos], &val, sizeof(T));
+    }
+
+    // return false and leave out empty if nbs has more label runs than fit
+    static bool EncodeCompressed(vector<Nbs_pair> & nbs, vector<char> & out) {
+        sort(nbs.begin(), nbs.end(), [](const Nbs_pair & l, const Nbs_pair & r) {
+            return l.label != r.label ? l.label < r.label : l.vid.vid < r.vid.vid;
+        });
+
+        // runs of labels
+        vector<pair<label_t, uint32_t>> runs;
+        for (auto & nb : nbs) {
+            if (runs.empty() || runs.back().first != nb.label) {
+                runs.emplace_back(nb.label, 0);
+            }
+            runs.back().second++;
+        }
+        // too many labels to gain anything
+        if (runs.size() > UINT16_MAX) {
+            return false;
+        }
+
+        Append<uint32_t>(out, nbs.size() | COMPRESSED_BIT);
+        Append<uint16_t>(out, runs.size());
+        for (auto & run : runs) {
+            Append<label_t>(out, run.first);
+            Append<uint32_t>(out, run.second);
+        }
+
+        size_t begin = 0;
+        for (auto & run : runs) {
+            size_t end = begin + run.second;
+            for (size_t i = begin; i < end; i += BLOCK_SIZE) {
+                EncodeBlock(&nbs[i], min(end - i, (size_t)BLOCK_SIZE), out);
+            }
+            begin = end;
+        }
+        return true;
+    }
+
+    static void EncodeBlock(const Nbs_pair * nbs, int n, vector<char> & out) {
+        uint32_t max_delta = 0;
+        for (int i = 1; i < n; i++) {
+            max_delta = max(max_delta, (uint32_t)(nbs[i].vid.vid - nbs[i - 1].vid.vid));
+        }
+        uint8_t width = 0;
+        while (width < 32 && (max_delta >> width) != 0) {
+            width++;
+        }
+
+        Append<uint32_t>(out, nbs[0].vid.vid);
+        Append<uint8_t>(out, width);
+
+        size_t pos = out.size();
+        out.resize(pos + PackedSize(n - 1, width), 0);
+        uint8_t * packed = (uint8_t *)&out[pos];
+        for (int i = 1; i < n; i++) {
+            uint32_t delta = nbs[i].vid.vid - nbs[i - 1].vid.vid;
+            uint64_t bit = (uint64_t)(i - 1) * width;
+            for (int b = 0; b < width; b++, bit++) {
+                if ((delta >> b) & 1) {
+                    packed[bit >> 3] |= 1 << (bit & 7);
+                }
+            }
+        }
+    }
+
+    static size_t PackedSize(int m, uint8_t width) {
+        return ((uint64_t)m * width + 7) / 8;
+    }
+
+    typedef void (*unpack_t)(const uint8_t *, size_t, int, uint32_t, uint32_t *);
+
+    // decode a block of n vids into vids, return the end of block
+    static const char * DecodeBlock(const char * p, int n, uint32_t * vids) {
+        static const unpack_t unpackers[] = {
+            UnpackW<0>, UnpackW<1>, UnpackW<2>, UnpackW<3>, UnpackW<4>, UnpackW<5>, UnpackW<6>, UnpackW<7>,
+            UnpackW<8>, UnpackW<9>, UnpackW<10>, UnpackW<11>, UnpackW<12>, UnpackW<13>, UnpackW<14>, UnpackW<15>,
+            UnpackW<16>, UnpackW<17>, UnpackW<18>, UnpackW<19>, UnpackW<20>, UnpackW<21>, UnpackW<22>, UnpackW<23>,
+            UnpackW<24>, UnpackW<25>, UnpackW<26>, UnpackW<27>, UnpackW<28>, UnpackW<29>, UnpackW<30>, UnpackW<31>,
+            UnpackW<32>
+        };
+
+        uint32_t base;
+        uint8_t width;
+        memcpy(&base, p, sizeof(uint32_t));
+        memcpy(&width, p + sizeof(uint32_t), sizeof(uint8_t));
+        p += sizeof(uint32_t) + sizeof(uint8_t);
+
+        size_t packed_sz = PackedSize(n - 1, width);
+        vids[0] = base;
+        unpackers[width]((const uint8_t *)p, packed_sz, n - 1, base, vids + 1);
+        return p + packed_sz;
+    }
+
+    // unpack m deltas of W bits after base and restore them into vids
+    // W is a constant, so that shifts and masks of a group are unrolled
+    template <int W>
+    static void UnpackW(const uint8_t * packed, size_t packed_sz, int m, uint32_t base, uint32_t * vids) {
+        int j = 0;
+        // 8 deltas take W bytes, each delta is read by one unaligned 8-byte load
+        // while the loads stay inside the block, then restored by a prefix sum
+        // of 4 lanes at a time, carrying the last vid
+        __m128i carry = _mm_set1_epi32(base);
+        for (const uint8_t * p = packed; j + 8 <= m && (p - packed) + W + 8 <= packed_sz; j += 8, p += W) {
+            __m128i lo = _mm_setr_epi32(Delta<W, 0>(p), Delta<W, 1>(p), Delta<W, 2>(p), Delta<W, 3>(p));
+            __m128i hi = _mm_setr_epi32(Delta<W, 4>(p), Delta<W, 5>(p), Delta<W, 6>(p), Delta<W, 7>(p));
+            lo = PrefixSum(lo, carry);
+            carry = _mm_shuffle_epi32(lo, 0xFF);
+            hi = PrefixSum(hi, carry);
+            carry = _mm_shuffle_epi32(hi, 0xFF);
+            _mm_storeu_si128((__m128i *)(vids + j), lo);
+            _mm_storeu_si128((__m128i *)(vids + j + 4), hi);
+        }
+
+        // rest near the end of block
+        uint32_t vid = _mm_cvtsi128_si32(carry);
+        for (uint64_t bit = (uint64_t)j * W; j < m; j++, bit += W) {
+            uint64_t word = 0;
+            for (size_t b = bit >> 3; b < packed_sz && b < (bit >> 3) + sizeof(uint64_t); b++) {
+                word |= (uint64_t)packed[b] << ((b - (bit >> 3)) * 8);
+            }
+            vid += (word >> (bit & 7)) & Mask<W>();
+            vids[j] = vid;
+        }
+    }
+
+    template <int W>
+    static constexpr uint64_t Mask() {
+        return W == 32 ? 0xFFFFFFFFul : (1ul << W) - 1;
+    }
+
+    // k-th delta of a group of 8
+    template <int W, int K>
+    static uint32_t Delta(const uint8_t * p) {
+        uint64_t word;
+        memcpy(&word, p + (K * W >> 3), sizeof(uint64_t));
+        return (word >> (K * W & 7)) & Mask<W>();
+    }
+
+    static __m128i PrefixSum(__m128i x, __m128i carry) {
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        return _mm_add_epi32(x, carry);
+    }
+};
@@ -0,0 +1,91 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "base/type.hpp"
+#include "storage/layout.hpp"
+#include "storage/nbs_codec.hpp"
+#include "storage/remote_ops.hpp"
+
+// read size bytes at off of the remote region into out, by pieces of at most
+// buf_sz bytes through buffer
+template <class Remote>
+void ReadRemoteByPieces(Remote & remote, char * buffer, uint64_t buf_sz, uint64_t off, uint64_t size, char * out) {
+    for (uint64_t pos = 0; pos < size; pos += buf_sz) {
+        uint64_t len = min(buf_sz, size - pos);
+        remote.Read(buffer, len, off + pos);
+        memcpy(out + pos, buffer, len);
+    }
+}
+
+// write size bytes of data at off of the remote region, by pieces of at most
+// buf_sz bytes through buffer
+template <class Remote>
+void WriteRemoteByPieces(Remote & remote, char * buffer, uint64_t buf_sz, uint64_t off, const char * data, uint64_t size) {
+    for (uint64_t pos = 0; pos < size; pos += buf_sz) {
+        uint64_t len = min(buf_sz, size - pos);
+        memcpy(buffer, data + pos, len);
+        remote.Write(buffer, len, off + pos);
+    }
+}
+
+// Append nb to the ext nbs list whose ptr_t is at ptr_off of the remote region,
+// from a compute node by atomics of Remote, see RdmaRemote
+//
+// Copy on write: the list is read, nb is appended and the new list is written
+// to ext space allocated by FAA on ext_cursor, then it is published by CAS of
+// the ptr. The list is relocated on every append, a writer losing the CAS
+// builds it again from the winner's list and the list it wrote is leaked.
+// ext_off and ext_sz are the offset and size of ext in the remote region.
+//
+// buffer is a registered local buffer of buf_sz (>= 8) bytes, lists larger
+// than it are read and written by pieces, new_ptr is set to the ptr
+// published, return false if ext is used up
+template <class Remote>
+bool AppendNbsRemote(Remote & remote, char * buffer, uint64_t buf_sz, uint64_t ptr_off, uint64_t ext_off, uint64_t ext_sz,
+                     uint64_t ext_cursor, bool compressed, const Nbs_pair & nb, ptr_t & new_ptr) {
+    vector<char> old_list;
+    while (true) {
+        remote.Read(buffer, sizeof(ptr_t), ptr_off);
+        ptr_t old_ptr = *(ptr_t *)buffer;
+
+        vector<Nbs_pair> nbs;
+        if (old_ptr.size != 0) {
+            old_list.resize(old_ptr.size);
+            ReadRemoteByPieces(remote, buffer, buf_sz, ext_off + old_ptr.off, old_ptr.size, &old_list[0]);
+            if (compressed) {
+                NbsCodec::Decode(&old_list[0], nbs);
+            } else {
+                nbs.assign((Nbs_pair *)&old_list[0], (Nbs_pair *)&old_list[0] + old_ptr.size / sizeof(Nbs_pair));
+            }
+        }
+        nbs.push_back(nb);
+
+        vector<char> list;
+        if (compressed) {
+            NbsCodec::Encode(nbs, list);
+        } else {
+            list.assign((char *)&nbs[0], (char *)(&nbs[0] + nbs.size()));
+        }
+
+        remote.FetchAndAdd(buffer, list.size(), ext_cursor);
+        uint64_t off = *(uint64_t *)buffer;
+        if (off + list.size() > ext_sz)
+            return false;
+        WriteRemoteByPieces(remote, buffer, buf_sz, ext_off + off, &list[0], list.size());
+
+        new_ptr = ptr_t(list.size(), off);
+        remote.CompareAndSwap(buffer, PtrWord(old_ptr), PtrWord(new_ptr), ptr_off);
+        if (*(uint64_t *)buffer == PtrWord(old_ptr))
+            return true;
+        // raced with another writer, read the list again
+    }
+}
@@ -0,0 +1,47 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "base/rdma.hpp"
+#include "base/type.hpp"
+
+inline uint64_t PtrWord(ptr_t ptr) {
+    uint64_t word;
+    memcpy(&word, &ptr, sizeof(uint64_t));
+    return word;
+}
+
+// Ops on the region of node dst_nid by the QP of thread tid, for the updates
+// from compute nodes in PutKeyRemote and AppendNbsRemote
+//
+// Those updates are templates on the ops, so that unit tests run them on a
+// local region shared by threads instead.
+struct RdmaRemote {
+    int tid;
+    int dst_nid;
+
+    RdmaRemote(int _tid, int _dst_nid) : tid(_tid), dst_nid(_dst_nid) {}
+
+    void Read(char * local, uint64_t size, uint64_t off) {
+        RDMA::get_rdma().dev->RdmaRead(tid, dst_nid, local, size, off);
+    }
+
+    void Write(char * local, uint64_t size, uint64_t off) {
+        RDMA::get_rdma().dev->RdmaWrite(tid, dst_nid, local, size, off);
+    }
+
+    // the word before the op is returned in local
+    void CompareAndSwap(char * local, uint64_t compare, uint64_t swap, uint64_t off) {
+        RDMA::get_rdma().dev->RdmaCompareAndSwap(tid, dst_nid, local, compare, swap, off);
+    }
+
+    void FetchAndAdd(char * local, uint64_t add, uint64_t off) {
+        RDMA::get_rdma().dev->RdmaFetchAndAdd(tid, dst_nid, local, add, off);
+    }
+};
@@ -0,0 +1,66 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// Double-buffered scan of slots [begin, end) by windows of per_window slots
+//
+// post(first, num, buf) starts the reads of a window into buf and poll() waits
+// for them, decode(first, num, buf, items) appends the items of a window read
+// into buf, and consume(items) is called each time chunk items are collected.
+// Reads of the next window are in flight while the current one is decoded.
+//
+// consume may read with the same buffer and QP as the scan, so it only runs
+// when no read is in flight: if the current window may fill the chunk, the
+// next window is posted after consume instead of before decode.
+//
+// return false if post or poll fails, the scan stops there
+template <class T, class Post, class Poll, class Decode, class Consume>
+bool ScanWindows(uint64_t begin, uint64_t end, uint64_t per_window, char * halves[2], uint64_t chunk,
+                 Post post, Poll poll, Decode decode, Consume consume) {
+    vector<T> items;
+    if (begin < end && !post(begin, min(per_window, end - begin), halves[0])) {
+        return false;
+    }
+
+    int cur = 0;
+    for (uint64_t first = begin; first < end; first += per_window) {
+        // the window at first is in flight
+        if (!poll()) {
+            return false;
+        }
+
+        uint64_t num = min(per_window, end - first);
+        uint64_t next = first + num;
+        bool posted = false;
+        if (next < end && items.size() + num < chunk) {
+            if (!post(next, min(per_window, end - next), halves[cur ^ 1])) {
+                return false;
+            }
+            posted = true;
+        }
+
+        decode(first, num, halves[cur], items);
+        if (items.size() >= chunk) {
+            consume(items);
+            items.clear();
+        }
+
+        if (next < end && !posted && !post(next, min(per_window, end - next), halves[cur ^ 1])) {
+            return false;
+        }
+        cur ^= 1;
+    }
+    if (!items.empty()) {
+        consume(items);
+    }
+    return true;
+}
@@ -7,6 +7,7 @@
 
 #include "storage/vertex.hpp"
 #include "storage/data_store.hpp"
+#include "storage/vertex_order.hpp"
 
 using namespace std;
 
@@ -23,8 +24,8 @@ VertexTable::VertexTable(RemoteBuffer * buf) : buf_(buf) {
     ext_size = mem_size * EXT_RATIO / 100;
     main_size = mem_size - ext_size;
 
-    num_vertices = main_size / sizeof(Vertex);
-    main_size = num_vertices * sizeof(Vertex);
+    // records are resized by set_inline_nbs() before any insert
+    set_inline_nbs(0, 0);
     // ext_size = mem_size - main_size;
 
     // vertex size are divided into two part
@@ -35,7 +36,7 @@ VertexTable::VertexTable(RemoteBuffer * buf) : buf_(buf) {
          << "      vertex number in main = " << num_vertices << std::endl
          << "      total ext size = " << ext_size << std::endl;
 
-    vtx_array = (Vertex *)(mem);
+    vtx_array = mem;
     ext = (char *)(mem + main_size);
     
     last_ext_offset = 0;
@@ -47,16 +48,17 @@ VertexTable::~VertexTable() {
 }
 
 void VertexTable::init(GraphMeta * graph_meta) {
-    for(uint64_t i = 0; i < num_vertices; i++) {
-        // LCY: Can I init like this?
-        memset(&vtx_array[i], 0, sizeof(Vertex)); 
-    }
-    memset(ext, 0, ext_size);
+    // vtx_array and ext are zeros already, as RemoteBuffer is freshly mapped
 
     //init graph meta
     graph_meta->v_array_off = offset;
     graph_meta->v_ext_off = offset + main_size;
     graph_meta->v_num = 0;
+    graph_meta->nbs_compressed = config_->global_enable_nbs_compression;
+}
+
+uint64_t VertexTable::get_ext_used() {
+    return last_ext_offset;
 }
 
 // alloc size in ext and return orig offset
@@ -73,13 +75,36 @@ uint64_t VertexTable::sync_alloc_ext(uint64_t size) {
     return orig;
 }
 
+void VertexTable::set_inline_nbs(int in_nbs, int out_nbs) {
+    vtx_in_nbs = in_nbs;
+    vtx_out_nbs = out_nbs;
+    record_size = VertexRecordSize(in_nbs, out_nbs);
+    num_vertices = main_size / record_size;
+}
+
+uint64_t VertexTable::get_main_size() {
+    return main_size;
+}
+
+void VertexTable::set_slots(vector<uint32_t> & slots) {
+    slots_ = slots;
+}
+
+uint64_t VertexTable::slot_of(vid_t id) {
+    if (slots_.empty())
+        return id.value();
+    assert(id.value() < slots_.size() && slots_[id.value()] != VertexOrder::NO_SLOT);
+    return slots_[id.value()];
+}
+
 Vertex * VertexTable::insert(vid_t id) {
-    uint32_t i_id = id.value();
+    uint64_t i_id = slot_of(id);
     if(i_id > num_vertices) 
         cout << "Vertex Table ERROR: out of vertex array region." << endl;
     assert(i_id < num_vertices);
-    vtx_array[i_id].id = id;
-    return &vtx_array[i_id];
+    Vertex * v = (Vertex *)(vtx_array + i_id * record_size);
+    v->id = id;
+    return v;
 }
 
 char * VertexTable::get_ext() {
@@ -87,7 +112,7 @@ char * VertexTable::get_ext() {
 }
 
 Vertex * VertexTable::find(vid_t id) {
-    Vertex * v = &vtx_array[id.value()];
+    Vertex * v = (Vertex *)(vtx_array + slot_of(id) * record_size);
     assert(v != nullptr);
     return v;
 }
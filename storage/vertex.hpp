@@ -18,7 +18,7 @@
 
 /* Vertex:
  * Vertices are stored in an array
- * need to config IN_NBS, OUT_NBS in layout.hpp
+ * each record inlines the first VTX_IN_NBS/VTX_OUT_NBS nbs, see Vertex
  * */
 
 class VertexTable
@@ -34,11 +34,23 @@ public:
 
     Vertex * find(vid_t id);
 
+    // place vertex vid at slots[vid] instead of vid, see VertexOrder
+    void set_slots(vector<uint32_t> & slots);
+
+    // number of inline nbs in each record, see Vertex
+    void set_inline_nbs(int in_nbs, int out_nbs);
+
+    // bytes of the region holding records
+    uint64_t get_main_size();
+
     char * get_ext();
     
     // sync alloc size bytes in ext space  
     uint64_t sync_alloc_ext(uint64_t size);
 
+    // bytes used in ext space
+    uint64_t get_ext_used();
+
 private:
     /* data */
     Config * config_;
@@ -57,8 +69,13 @@ private:
     static const int EXT_RATIO = 80; // ext size ratio
 
     // use these two ptr to find vtx and ext
-    Vertex * vtx_array;
+    char * vtx_array;
+    uint64_t record_size;
     uint64_t num_vertices;
+    // empty for vertex vid at slot vid
+    vector<uint32_t> slots_;
+
+    uint64_t slot_of(vid_t id);
 
     char* ext;
     uint64_t last_ext_offset;
@@ -0,0 +1,140 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "base/type.hpp"
+#include "storage/layout.hpp"
+
+// Placement order of vertices in VertexTable
+//
+// By default vertex vid sits at slot vid of the vertex array, and neighbor
+// lists in ext follow the order of input files. An order places vertices
+// likely to be accessed together next to each other, vertex vid then sits at
+// slots[vid] and its neighbor lists are written in the same order, so that
+// a traversal frontier spans fewer remote pages and batched reads of it are
+// close in the remote region. Vids seen by queries do not change.
+//     ORDER_DEGREE : high degree vertices first, hot vertices packed together
+//     ORDER_BFS    : Cuthill-McKee, BFS from low degree vertices visiting
+//                    neighbors by ascending degree
+//     ORDER_LABEL  : vertices of the same label together, by vid inside
+class VertexOrder {
+ public:
+    // compute placement, the i-th placed vertex is vertices[placement[i]]
+    // in_nbs[i] and out_nbs[i] are the neighbors of vertices[i]
+    static void Compute(int order, const vector<Vertex*> & vertices, const vector<vector<Nbs_pair>> & in_nbs,
+                        const vector<vector<Nbs_pair>> & out_nbs, const map<uint32_t, label_t> & vtx_label,
+                        vector<int> & placement) {
+        int n = vertices.size();
+        placement.resize(n);
+        for (int i = 0; i < n; i++) {
+            placement[i] = i;
+        }
+
+        switch (order) {
+        case ORDER_DEGREE:
+            stable_sort(placement.begin(), placement.end(), [&](int l, int r) {
+                return in_nbs[l].size() + out_nbs[l].size() > in_nbs[r].size() + out_nbs[r].size();
+            });
+            break;
+        case ORDER_BFS:
+            CuthillMcKee(vertices, in_nbs, out_nbs, placement);
+            break;
+        case ORDER_LABEL:
+            {
+                vector<label_t> labels(n, 0);
+                for (int i = 0; i < n; i++) {
+                    auto itr = vtx_label.find(vertices[i]->id.value());
+                    if (itr != vtx_label.end()) {
+                        labels[i] = itr->second;
+                    }
+                }
+                sort(placement.begin(), placement.end(), [&](int l, int r) {
+                    if (labels[l] != labels[r]) {
+                        return labels[l] < labels[r];
+                    }
+                    return vertices[l]->id.value() < vertices[r]->id.value();
+                });
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // slot of each vid from placement, unused vids get NO_SLOT
+    static void ToSlots(const vector<Vertex*> & vertices, const vector<int> & placement, vector<uint32_t> & slots) {
+        uint32_t max_vid = 0;
+        for (auto v : vertices) {
+            max_vid = max(max_vid, (uint32_t)v->id.value());
+        }
+        slots.assign(vertices.empty() ? 0 : max_vid + 1, NO_SLOT);
+        for (int i = 0; i < placement.size(); i++) {
+            slots[vertices[placement[i]]->id.value()] = i;
+        }
+    }
+
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+ private:
+    static void CuthillMcKee(const vector<Vertex*> & vertices, const vector<vector<Nbs_pair>> & in_nbs,
+                             const vector<vector<Nbs_pair>> & out_nbs, vector<int> & placement) {
+        int n = vertices.size();
+        uint32_t max_vid = 0;
+        for (auto v : vertices) {
+            max_vid = max(max_vid, (uint32_t)v->id.value());
+        }
+        vector<int> index_of(max_vid + 1, -1);
+        for (int i = 0; i < n; i++) {
+            index_of[vertices[i]->id.value()] = i;
+        }
+
+        vector<bool> visited(n, false);
+        auto by_degree = [&](int l, int r) {
+            return in_nbs[l].size() + out_nbs[l].size() < in_nbs[r].size() + out_nbs[r].size();
+        };
+        // both directions, as traversals go either way
+        auto visit = [&](const vector<Nbs_pair> & nbs, vector<int> & next) {
+            for (auto & nb : nbs) {
+                uint32_t vid = nb.vid.vid;
+                int i = vid <= max_vid ? index_of[vid] : -1;
+                if (i >= 0 && !visited[i]) {
+                    visited[i] = true;
+                    next.push_back(i);
+                }
+            }
+        };
+
+        // each component starts from its vertex of lowest degree
+        vector<int> starts(placement);
+        stable_sort(starts.begin(), starts.end(), by_degree);
+
+        vector<int> next;
+        int pos = 0;
+        for (int s : starts) {
+            if (visited[s]) {
+                continue;
+            }
+            visited[s] = true;
+            placement[pos++] = s;
+
+            // placement[head .. pos) is the queue of BFS
+            for (int head = pos - 1; head < pos; head++) {
+                next.clear();
+                visit(in_nbs[placement[head]], next);
+                visit(out_nbs[placement[head]], next);
+                stable_sort(next.begin(), next.end(), by_degree);
+                for (int i : next) {
+                    placement[pos++] = i;
+                }
+            }
+        }
+    }
+};
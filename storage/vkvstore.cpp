@@ -167,10 +167,7 @@ VKVStore::VKVStore(RemoteBuffer * buf) : buf_(buf) {
 }
 
 void VKVStore::init(GraphMeta * graph_meta,  vector<Node> & nodes) {
-    // initiate keys to 0 which means empty key
-    for (uint64_t i = 0; i < num_slots; i++) {
-        keys[i] = ikey_t();
-    }
+    // keys are 0 (empty key) already, as RemoteBuffer is freshly mapped
 
     // init graph meta
     graph_meta->vp_off = offset;
@@ -51,20 +51,14 @@ void VKVStore_Local::get_key_remote(int tid, int dst_nid, uint64_t pid, ikey_t &
         rdma.dev->RdmaRead(tid, dst_nid, buffer, sz, off);
         // timer::stop_timer(tid);
 
-        ikey_t * keys = (ikey_t *)buffer;
-        for (int i = 0; i < ASSOCIATIVITY; ++i) {
-            if (i < ASSOCIATIVITY - 1) {
-                if (keys[i].pid == pid) {
-                    key = keys[i];
-                    return;
-                }
-            } else {
-                if (keys[i].is_empty())
-                    return;  // not found
-
-                bucket_id = keys[i].pid;  // move to next bucket
-                break;  // break for-loop
-            }
+        if (ProbeBucket<ASSOCIATIVITY>((ikey_t *)buffer, pid, key, bucket_id)) {
+            // claimed by PutKeyRemote but not published yet
+            if (key.ptr.size == 0)
+                key = ikey_t();
+            return;
+        }
+        if (bucket_id == 0) {
+            return;  // not found
         }
     }
 }
@@ -110,6 +104,9 @@ void VKVStore_Local::init(vector<Node> & nodes, uint64_t off, uint64_t slots_num
     offset = off;
     num_slots = slots_num;
     num_buckets = buckets_num;
+    num_buckets_ext = (num_slots / ASSOCIATIVITY) - num_buckets;
+    num_entries = buf_->GetVPStoreSize() - num_slots * sizeof(ikey_t);
+    alloc_offset = buf_->GetAllocHeaderOffset();
     // // initiate keys to 0 which means empty key
     // for (uint64_t i = 0; i < num_slots; i++) {
     //     keys[i] = ikey_t();
@@ -180,6 +177,29 @@ void VKVStore_Local::get_property_remote(int tid, int dst_nid, uint64_t pid, val
         std::copy(ctt, ctt + r_sz-1, val.content.begin());
 }
 
+// Put properties by key remotely
+// the value is written to a newly allocated entry before its key is published
+bool VKVStore_Local::put_property_remote(int tid, int dst_nid, uint64_t pid, const value_t & val) {
+    char * buffer = buf_->GetSendBuf(tid);
+    uint64_t length = val.content.size();
+
+    RDMA &rdma = RDMA::get_rdma();
+    rdma.dev->RdmaFetchAndAdd(tid, dst_nid, buffer, length + 1, alloc_offset + offsetof(AllocHeader, vp_entry_last));
+    uint64_t off = *(uint64_t *)buffer;
+    if (off + length + 1 > num_entries) {
+        return false;
+    }
+
+    // type : uint8_t to char
+    buffer[0] = (char)val.type;
+    memcpy(buffer + 1, val.content.data(), length);
+    rdma.dev->RdmaWrite(tid, dst_nid, buffer, length + 1, offset + num_slots * sizeof(ikey_t) + off);
+
+    RdmaRemote remote(tid, dst_nid);
+    return PutKeyRemote<ASSOCIATIVITY>(remote, buffer, offset, num_buckets, num_buckets_ext,
+                                       alloc_offset + offsetof(AllocHeader, vp_ext_last), pid, ptr_t(length + 1, off));
+}
+
 // void VKVStore_Local::get_label_local(uint64_t pid, label_t & label) {
 //     value_t val;
 //     get_property_local(pid, val);
@@ -0,0 +1,63 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#ifndef TEST_HPP_
+#define TEST_HPP_
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Minimal unit test harness
+//
+// A test is a function checking the code with EXPECT_* macros. Register it at
+// file scope with
+//     TEST(Test_Name);
+// and the runner in test_main.cpp runs every test, reports the failed checks
+// and exits with non-zero status if any check failed.
+typedef function<void()> test_func_t;
+
+struct TestCase {
+    string name;
+    test_func_t func;
+};
+
+class TestRegistry {
+ public:
+    static vector<TestCase>& Cases() {
+        static vector<TestCase> cases;
+        return cases;
+    }
+
+    static int Register(const string& name, test_func_t func) {
+        Cases().push_back(TestCase{name, func});
+        return Cases().size();
+    }
+
+    // failed checks of the running test
+    static int& Failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    static void Fail(const char* file, int line, const char* expr) {
+        cout << "    " << file << ":" << line << ": check failed: " << expr << endl;
+        // checks may fail in threads started by a test
+        __atomic_fetch_add(&Failures(), 1, __ATOMIC_RELAXED);
+    }
+};
+
+#define TEST(func) \
+    static int func##_registered = TestRegistry::Register(#func, func)
+
+#define EXPECT_TRUE(cond) \
+    do { if (!(cond)) TestRegistry::Fail(__FILE__, __LINE__, #cond); } while (0)
+
+#define EXPECT_EQ(a, b) EXPECT_TRUE((a) == (b))
+
+#endif  // TEST_HPP_
@@ -0,0 +1,95 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <map>
+
+#include "test/test.hpp"
+#include "core/parser.hpp"
+#include "expert/init_expert.hpp"
+
+static vector<value_t> Vids(const vector<int> & vids) {
+    vector<value_t> vtxs;
+    for (int vid : vids) {
+        value_t v;
+        Tool::str2int(to_string(vid), v);
+        vtxs.push_back(v);
+    }
+    sort(vtxs.begin(), vtxs.end());
+    return vtxs;
+}
+
+// hasLabel steps on V() are folded into init, one group of params each
+static void Test_ParseChainedHasLabel() {
+    string_index indexes;
+    indexes.str2vl["person"] = 1;
+    indexes.str2vl["software"] = 2;
+    indexes.str2vl["city"] = 3;
+
+    IndexStore index_store;
+    Parser parser(&index_store);
+    parser.LoadMapping(&indexes);
+
+    vector<Expert_Object> experts;
+    string error_msg;
+    EXPECT_TRUE(parser.Parse("g.V().hasLabel(\"person\", \"software\").hasLabel(\"software\", \"city\").count()", experts, error_msg));
+    EXPECT_EQ(experts.size(), 3);
+    if (experts.size() != 3) {
+        return;
+    }
+    EXPECT_TRUE(experts[0].expert_type == EXPERT_T::INIT);
+    EXPECT_TRUE(experts[1].expert_type == EXPERT_T::COUNT);
+
+    // type, then (pid, predicate, labels) of each group
+    const vector<value_t> & params = experts[0].params;
+    EXPECT_EQ(params.size(), 7);
+    if (params.size() != 7) {
+        return;
+    }
+    vector<int> groups[2] = {{1, 2}, {2, 3}};
+    for (int i = 0; i < 2; i++) {
+        EXPECT_EQ(Tool::value_t2int(params[1 + i * 3]), 0);
+        vector<value_t> labels;
+        Tool::value_t2vec(params[3 + i * 3], labels);
+        EXPECT_EQ(labels.size(), groups[i].size());
+        for (int j = 0; j < labels.size() && j < groups[i].size(); j++) {
+            EXPECT_EQ(Tool::value_t2int(labels[j]), groups[i][j]);
+        }
+    }
+}
+TEST(Test_ParseChainedHasLabel);
+
+// vertices of chained hasLabel groups are intersected, labels of a group merged
+static void Test_InitChainedLabelGroups() {
+    // one label per vertex as on the memory node
+    map<label_t, vector<uint32_t>> label_vids = {{1, {1, 5, 9}}, {2, {2, 6}}, {3, {3, 7}}};
+    auto get_by_label = [&](label_t label, vector<vid_t> & vid_list) {
+        for (auto vid : label_vids[label]) {
+            vid_list.emplace_back(vid);
+        }
+    };
+    auto labels = [](const vector<int> & lids) {
+        vector<value_t> vals;
+        for (int lid : lids) {
+            value_t v;
+            Tool::str2int(to_string(lid), v);
+            vals.push_back(v);
+        }
+        return vals;
+    };
+
+    // hasLabel(1, 2)
+    vector<value_t> vtxs;
+    InitExpert::GetVerticesByLabelGroups({labels({1, 2})}, get_by_label, vtxs);
+    EXPECT_TRUE(vtxs == Vids({1, 2, 5, 6, 9}));
+
+    // hasLabel(1, 2).hasLabel(2, 3)
+    InitExpert::GetVerticesByLabelGroups({labels({1, 2}), labels({2, 3})}, get_by_label, vtxs);
+    EXPECT_TRUE(vtxs == Vids({2, 6}));
+
+    // hasLabel(1).hasLabel(3)
+    InitExpert::GetVerticesByLabelGroups({labels({1}), labels({3})}, get_by_label, vtxs);
+    EXPECT_TRUE(vtxs.empty());
+}
+TEST(Test_InitChainedLabelGroups);
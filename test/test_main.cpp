@@ -0,0 +1,43 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+
+#include "test/test.hpp"
+
+int main(int argc, char* argv[]) {
+    string filter;
+    if (argc == 3 && strcmp(argv[1], "--filter") == 0) {
+        filter = argv[2];
+    } else if (argc != 1) {
+        cout << "Usage: " << argv[0] << " [--filter <str>]" << endl;
+        return 1;
+    }
+
+    vector<TestCase>& cases = TestRegistry::Cases();
+    sort(cases.begin(), cases.end(), [](const TestCase& l, const TestCase& r) { return l.name < r.name; });
+
+    int num_run = 0, num_failed = 0;
+    for (auto& test : cases) {
+        if (test.name.find(filter) == string::npos) {
+            continue;
+        }
+
+        TestRegistry::Failures() = 0;
+        test.func();
+        num_run++;
+        if (TestRegistry::Failures() > 0) {
+            num_failed++;
+            cout << "[FAILED] " << test.name << endl;
+        } else {
+            cout << "[  OK  ] " << test.name << endl;
+        }
+    }
+
+    cout << num_run - num_failed << " of " << num_run << " tests passed" << endl;
+    return num_failed == 0 ? 0 : 1;
+}
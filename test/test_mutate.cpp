@@ -0,0 +1,77 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include "test/test.hpp"
+#include "core/parser.hpp"
+#include "expert/expert_cache.hpp"
+
+// updates are parsed to a single mutate step, (type, label or vids, key, value)
+static void Test_ParseMutate() {
+    string_index indexes;
+    indexes.str2vl["person"] = 1;
+    indexes.str2el["knows"] = 2;
+    indexes.str2vpk["name"] = 3;
+    indexes.str2vptype["3"] = 4;
+    indexes.str2epk["weight"] = 4;
+    indexes.str2eptype["4"] = 2;
+
+    IndexStore index_store;
+    Parser parser(&index_store);
+    parser.LoadMapping(&indexes);
+
+    vector<Expert_Object> experts;
+    string error_msg;
+    EXPECT_TRUE(parser.Parse("AddE(knows, 1, 2)", experts, error_msg));
+    EXPECT_EQ(experts.size(), 2);
+    if (experts.size() != 2) {
+        return;
+    }
+    EXPECT_TRUE(experts[0].expert_type == EXPERT_T::MUTATE);
+    EXPECT_EQ(experts[0].params.size(), 4);
+    EXPECT_EQ(Tool::value_t2int(experts[0].params[0]), Mutate_T::ADD_EDGE);
+    EXPECT_EQ(Tool::value_t2int(experts[0].params[1]), 2);
+    EXPECT_EQ(Tool::value_t2int(experts[0].params[3]), 2);
+
+    experts.clear();
+    EXPECT_TRUE(parser.Parse("SetProperty(V, 7, name, \"marko\")", experts, error_msg));
+    if (experts.size() != 2) {
+        return;
+    }
+    const vector<value_t> & params = experts[0].params;
+    EXPECT_EQ(params.size(), 4);
+    EXPECT_EQ(Tool::value_t2int(params[0]), Mutate_T::SET_VP);
+    EXPECT_EQ(Tool::value_t2int(params[1]), 7);
+    EXPECT_EQ(Tool::value_t2int(params[2]), 3);
+    EXPECT_TRUE(Tool::value_t2string(params[3]) == "marko");
+
+    // unknown label, value of other type than the key
+    experts.clear();
+    EXPECT_TRUE(!parser.Parse("AddV(city)", experts, error_msg));
+    EXPECT_TRUE(!parser.Parse("SetProperty(E, 1, 2, weight, \"heavy\")", experts, error_msg));
+    EXPECT_TRUE(parser.Parse("SetProperty(E, 1, 2, weight, 0.5)", experts, error_msg));
+}
+TEST(Test_ParseMutate);
+
+// invalidated keys miss, others in the same shard stay
+static void Test_CacheInvalidate() {
+    PropertyCache cache(1 << 20);
+    string a = "a", b = "b";
+    cache.Insert(PropertyCache::V_PROPERTY, 1, 4, a.data(), a.size());
+    cache.Insert(PropertyCache::V_PROPERTY, 2, 4, b.data(), b.size());
+    cache.Insert(PropertyCache::E_PROPERTY, 1, 4, b.data(), b.size());
+
+    uint8_t type;
+    vector<char> content;
+    cache.Invalidate(PropertyCache::V_PROPERTY, 1);
+    EXPECT_TRUE(!cache.Lookup(PropertyCache::V_PROPERTY, 1, type, content));
+    EXPECT_TRUE(cache.Lookup(PropertyCache::V_PROPERTY, 2, type, content));
+    EXPECT_TRUE(cache.Lookup(PropertyCache::E_PROPERTY, 1, type, content));
+
+    // a later insert is visible again
+    cache.Insert(PropertyCache::V_PROPERTY, 1, 4, b.data(), b.size());
+    EXPECT_TRUE(cache.Lookup(PropertyCache::V_PROPERTY, 1, type, content));
+    EXPECT_TRUE(string(content.begin(), content.end()) == "b");
+}
+TEST(Test_CacheInvalidate);
@@ -0,0 +1,71 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <random>
+
+#include "test/test.hpp"
+#include "storage/nbs_codec.hpp"
+
+static bool SameNbs(vector<Nbs_pair> l, vector<Nbs_pair> r) {
+    auto cmp = [](const Nbs_pair & a, const Nbs_pair & b) {
+        return a.label != b.label ? a.label < b.label : a.vid.vid < b.vid.vid;
+    };
+    sort(l.begin(), l.end(), cmp);
+    sort(r.begin(), r.end(), cmp);
+    if (l.size() != r.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < l.size(); i++) {
+        if (l[i].label != r[i].label || l[i].vid.vid != r[i].vid.vid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void RoundTrip(const vector<Nbs_pair> & nbs, size_t & encoded_sz) {
+    vector<Nbs_pair> in = nbs;
+    vector<char> list;
+    NbsCodec::Encode(in, list);
+    encoded_sz = list.size();
+    EXPECT_TRUE(!list.empty());
+    if (list.empty()) {
+        return;
+    }
+
+    vector<Nbs_pair> out;
+    EXPECT_EQ(NbsCodec::Decode(&list[0], out), (int)nbs.size());
+    EXPECT_TRUE(SameNbs(nbs, out));
+}
+
+static void Test_NbsCodecRoundTrip() {
+    mt19937_64 rng(20190101);
+    for (int num : {0, 1, 7, 8, 129, 4096}) {
+        vector<Nbs_pair> nbs(num);
+        for (int i = 0; i < num; i++) {
+            nbs[i].vid = rng() % (num * 16 + 1);
+            nbs[i].label = rng() % 4;
+        }
+        size_t sz;
+        RoundTrip(nbs, sz);
+    }
+}
+TEST(Test_NbsCodecRoundTrip);
+
+// more label runs than the uint16 count of the compressed header holds
+static void Test_NbsCodecTooManyLabels() {
+    const int num_labels = UINT16_MAX + 1;
+    vector<Nbs_pair> nbs(num_labels);
+    for (int i = 0; i < num_labels; i++) {
+        nbs[i].vid = i;
+        nbs[i].label = i;
+    }
+
+    size_t sz;
+    RoundTrip(nbs, sz);
+    // kept raw
+    EXPECT_EQ(sz, sizeof(uint32_t) + num_labels * sizeof(Nbs_pair));
+}
+TEST(Test_NbsCodecTooManyLabels);
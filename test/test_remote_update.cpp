@@ -0,0 +1,224 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+#include "test/test.hpp"
+#include "storage/kv_bucket.hpp"
+#include "storage/kv_bucket_remote.hpp"
+#include "storage/nbs_remote.hpp"
+
+// Region shared by threads in place of the remote region, words are accessed
+// atomically as RDMA atomics and aligned reads of 8-byte words are. Each op
+// yields first, so that ops of racing threads interleave as round trips would.
+struct LocalRemote {
+    char * mem;
+
+    explicit LocalRemote(char * _mem) : mem(_mem) {}
+
+    void Read(char * local, uint64_t size, uint64_t off) {
+        this_thread::yield();
+        if (size % sizeof(uint64_t) != 0 || off % sizeof(uint64_t) != 0) {
+            memcpy(local, mem + off, size);
+            return;
+        }
+        for (uint64_t i = 0; i < size; i += sizeof(uint64_t)) {
+            uint64_t word = __atomic_load_n((uint64_t *)(mem + off + i), __ATOMIC_SEQ_CST);
+            memcpy(local + i, &word, sizeof(uint64_t));
+        }
+    }
+
+    void Write(char * local, uint64_t size, uint64_t off) {
+        this_thread::yield();
+        memcpy(mem + off, local, size);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    void CompareAndSwap(char * local, uint64_t compare, uint64_t swap, uint64_t off) {
+        this_thread::yield();
+        __atomic_compare_exchange_n((uint64_t *)(mem + off), &compare, swap, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        memcpy(local, &compare, sizeof(uint64_t));
+    }
+
+    void FetchAndAdd(char * local, uint64_t add, uint64_t off) {
+        this_thread::yield();
+        uint64_t old = __atomic_fetch_add((uint64_t *)(mem + off), add, __ATOMIC_SEQ_CST);
+        memcpy(local, &old, sizeof(uint64_t));
+    }
+};
+
+static const int ASSOCIATIVITY = 8;
+static const int NUM_THREADS = 8;
+
+// hash-table of num_buckets main and num_buckets_ext indirect buckets, then
+// the cursor of indirect buckets
+struct RemoteTable {
+    vector<uint64_t> mem;
+    uint64_t num_buckets;
+    uint64_t num_buckets_ext;
+    uint64_t cursor_off;
+
+    RemoteTable(uint64_t _num_buckets, uint64_t _num_buckets_ext) : num_buckets(_num_buckets), num_buckets_ext(_num_buckets_ext) {
+        uint64_t num_slots = (num_buckets + num_buckets_ext) * ASSOCIATIVITY;
+        mem.assign(num_slots * sizeof(ikey_t) / sizeof(uint64_t) + 1, 0);
+        cursor_off = num_slots * sizeof(ikey_t);
+    }
+
+    char * base() { return (char *)&mem[0]; }
+
+    bool Put(uint64_t pid, ptr_t ptr) {
+        LocalRemote remote(base());
+        vector<char> buffer((ASSOCIATIVITY + 1) * sizeof(ikey_t));
+        return PutKeyRemote<ASSOCIATIVITY>(remote, &buffer[0], 0, num_buckets, num_buckets_ext, cursor_off, pid, ptr);
+    }
+
+    // slots holding pid in its chain, as readers probe it
+    int Count(uint64_t pid, ikey_t & key) {
+        ikey_t * keys = (ikey_t *)base();
+        uint64_t bucket_id = pid % num_buckets;
+        int count = 0;
+        do {
+            ikey_t * bucket = keys + bucket_id * ASSOCIATIVITY;
+            for (int i = 0; i < ASSOCIATIVITY - 1; i++) {
+                if (bucket[i].pid == pid) {
+                    key = bucket[i];
+                    count++;
+                }
+            }
+            bucket_id = bucket[ASSOCIATIVITY - 1].is_empty() ? 0 : bucket[ASSOCIATIVITY - 1].pid;
+        } while (bucket_id != 0);
+        return count;
+    }
+};
+
+// all threads put the same pids at once, chains grow into indirect buckets
+static void Test_PutKeyRemoteConcurrentInsert() {
+    const int num_pids = 200;
+    RemoteTable table(3, 64);
+
+    vector<thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&table, t]() {
+            for (int i = 0; i < num_pids; i++) {
+                EXPECT_TRUE(table.Put(i + 1, ptr_t(t + 1, i)));
+            }
+        });
+    }
+    for (auto & th : threads) {
+        th.join();
+    }
+
+    // every pid in exactly one slot, with the value of one of the puts
+    for (int i = 0; i < num_pids; i++) {
+        ikey_t key;
+        EXPECT_EQ(table.Count(i + 1, key), 1);
+        EXPECT_TRUE(key.ptr.size >= 1 && key.ptr.size <= NUM_THREADS && key.ptr.off == i);
+    }
+
+    // no slot is taken by a duplicate, chains are only extended when full
+    ikey_t * keys = (ikey_t *)table.base();
+    int used = 0;
+    for (uint64_t b = 0; b < table.num_buckets + table.num_buckets_ext; b++) {
+        for (int i = 0; i < ASSOCIATIVITY - 1; i++) {
+            used += !keys[b * ASSOCIATIVITY + i].is_empty();
+        }
+    }
+    EXPECT_EQ(used, num_pids);
+}
+TEST(Test_PutKeyRemoteConcurrentInsert);
+
+static void Test_PutKeyRemoteUpdate() {
+    RemoteTable table(1, 4);
+    for (int i = 0; i < 20; i++) {
+        EXPECT_TRUE(table.Put(i + 1, ptr_t(1, i)));
+    }
+    EXPECT_TRUE(table.Put(5, ptr_t(2, 100)));
+
+    ikey_t key;
+    EXPECT_EQ(table.Count(5, key), 1);
+    EXPECT_TRUE(key.ptr.size == 2 && key.ptr.off == 100);
+
+    // 2 buckets hold 14 keys
+    RemoteTable full(1, 1);
+    for (int i = 0; i < 14; i++) {
+        EXPECT_TRUE(full.Put(i + 1, ptr_t(1, i)));
+    }
+    EXPECT_TRUE(!full.Put(15, ptr_t(1, 14)));
+}
+TEST(Test_PutKeyRemoteUpdate);
+
+// threads append to the same lists at once, each append relocates the list
+// buf_sz is the size of the local buffer of each thread, lists beyond it are
+// read and written by pieces
+static void AppendConcurrently(bool compressed, uint64_t buf_sz) {
+    const int num_lists = 2;
+    const int per_thread = 50;
+    // room for the lists leaked by lost races, more with small buffers
+    const uint64_t ext_sz = 64 << 20;
+
+    // ptrs of lists, ext, then the cursor of ext
+    vector<uint64_t> mem((num_lists * sizeof(ptr_t) + ext_sz) / sizeof(uint64_t) + 1, 0);
+    uint64_t ext_off = num_lists * sizeof(ptr_t);
+    uint64_t cursor_off = ext_off + ext_sz;
+
+    vector<thread> threads;
+    for (int t = 0; t < NUM_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            LocalRemote remote((char *)&mem[0]);
+            vector<char> buffer(buf_sz);
+            for (int i = 0; i < per_thread; i++) {
+                for (int l = 0; l < num_lists; l++) {
+                    Nbs_pair nb;
+                    nb.vid = vid_t(t * per_thread + i);
+                    nb.label = l;
+                    ptr_t new_ptr;
+                    EXPECT_TRUE(AppendNbsRemote(remote, &buffer[0], buf_sz, l * sizeof(ptr_t), ext_off, ext_sz, cursor_off,
+                                                compressed, nb, new_ptr));
+                }
+            }
+        });
+    }
+    for (auto & th : threads) {
+        th.join();
+    }
+
+    for (int l = 0; l < num_lists; l++) {
+        ptr_t ptr = ((ptr_t *)&mem[0])[l];
+        char * list = (char *)&mem[0] + ext_off + ptr.off;
+        vector<Nbs_pair> nbs;
+        if (compressed) {
+            NbsCodec::Decode(list, nbs);
+        } else {
+            nbs.assign((Nbs_pair *)list, (Nbs_pair *)(list + ptr.size));
+        }
+
+        // every append is kept exactly once
+        vector<uint32_t> vids;
+        for (auto & nb : nbs) {
+            EXPECT_EQ(nb.label, l);
+            vids.push_back(nb.vid.vid);
+        }
+        sort(vids.begin(), vids.end());
+        EXPECT_EQ(vids.size(), (size_t)NUM_THREADS * per_thread);
+        for (uint32_t i = 0; i < vids.size(); i++) {
+            EXPECT_EQ(vids[i], i);
+        }
+    }
+}
+
+static void Test_AppendNbsRemoteConcurrentRelocation() {
+    AppendConcurrently(false, 64 << 10);
+    AppendConcurrently(true, 64 << 10);
+}
+TEST(Test_AppendNbsRemoteConcurrentRelocation);
+
+// lists of 400 nbs, several times the buffer of a thread
+static void Test_AppendNbsRemoteSmallBuffer() {
+    AppendConcurrently(false, 256);
+    AppendConcurrently(true, 64);
+}
+TEST(Test_AppendNbsRemoteSmallBuffer);
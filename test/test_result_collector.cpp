@@ -0,0 +1,106 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
+*/
+
+#include "test/test.hpp"
+#include "core/result_collector.hpp"
+
+static vector<value_t> Chunk(int v) {
+    value_t val;
+    Tool::str2int(to_string(v), val);
+    return vector<value_t>{val};
+}
+
+// chunks beyond the window are held and released in order by acks
+static void Test_ResultCollectorWindow() {
+    Config::GetInstance()->result_window = 2;
+    Config::GetInstance()->result_max_held = 4;
+    Result_Collector rc;
+    rc.Register(1, "client", 7);
+    for (int i = 0; i < 4; i++) {
+        vector<value_t> data = Chunk(i);
+        rc.InsertChunk(1, data);
+    }
+    vector<value_t> data = Chunk(4);
+    rc.InsertResult(1, data);
+
+    reply re;
+    for (uint32_t i = 0; i < 5; i++) {
+        rc.Pop(re);
+        EXPECT_EQ(re.chunk_id, i);
+        EXPECT_EQ(re.req_id, (uint64_t)7);
+        EXPECT_EQ(Tool::value_t2int(re.results[0]), (int)i);
+        EXPECT_EQ(re.is_last, i == 4);
+        if (!re.is_last) {
+            rc.Ack(1);
+        }
+    }
+}
+TEST(Test_ResultCollectorWindow);
+
+// a client that never acks ends its query with an error once the chunks held
+// reach the bound, later results are discarded
+static void Test_ResultCollectorMaxHeld() {
+    Config::GetInstance()->result_window = 2;
+    Config::GetInstance()->result_max_held = 3;
+    Result_Collector rc;
+    rc.Register(1, "client");
+    for (int i = 0; i < 10; i++) {
+        vector<value_t> data = Chunk(i);
+        rc.InsertChunk(1, data);
+    }
+    vector<value_t> data = Chunk(10);
+    rc.InsertResult(1, data);
+
+    reply re;
+    rc.Pop(re);
+    EXPECT_EQ(re.chunk_id, (uint32_t)0);
+    rc.Pop(re);
+    EXPECT_EQ(re.chunk_id, (uint32_t)1);
+    rc.Pop(re);
+    EXPECT_TRUE(re.is_last);
+    EXPECT_EQ(re.results.size(), (size_t)1);
+    EXPECT_EQ(re.results[0].type, (uint8_t)4);
+
+    // a new query with the same collector is not affected
+    rc.Register(2, "client");
+    data = Chunk(0);
+    rc.InsertResult(2, data);
+    rc.Pop(re);
+    EXPECT_EQ(re.qid, (uint64_t)2);
+    EXPECT_TRUE(re.is_last);
+}
+TEST(Test_ResultCollectorMaxHeld);
+
+// a failed query ends with the reason after the chunks sent so far
+static void Test_ResultCollectorFail() {
+    Config::GetInstance()->result_window = 0;
+    Result_Collector rc;
+    rc.Register(1, "client");
+    vector<value_t> data = Chunk(0);
+    rc.InsertChunk(1, data);
+    rc.Fail(1, "failed");
+    data = Chunk(1);
+    rc.InsertChunk(1, data);
+    data = Chunk(2);
+    rc.InsertResult(1, data);
+
+    reply re;
+    rc.Pop(re);
+    EXPECT_EQ(re.chunk_id, (uint32_t)0);
+    EXPECT_TRUE(!re.is_last);
+    rc.Pop(re);
+    EXPECT_EQ(re.chunk_id, (uint32_t)1);
+    EXPECT_TRUE(re.is_last);
+    EXPECT_TRUE(Tool::value_t2string(re.results[0]) == "failed");
+
+    // nothing is left of the query
+    rc.Fail(1, "failed");
+    rc.Register(2, "client");
+    data = Chunk(0);
+    rc.InsertResult(2, data);
+    rc.Pop(re);
+    EXPECT_EQ(re.qid, (uint64_t)2);
+}
+TEST(Test_ResultCollectorFail);
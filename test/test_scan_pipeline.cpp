@@ -0,0 +1,116 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#include <string.h>
+
+#include "test/test.hpp"
+#include "storage/scan_pipeline.hpp"
+
+// Remote region of slots, each holds its own id except every 7th one which is
+// empty. A posted read lands in the local buffer at once, as an RDMA read may
+// land any time before it is polled.
+struct FakeScanRemote {
+    static const uint64_t EMPTY = ~0ull;
+    vector<uint64_t> slots;
+    bool in_flight = false;
+    int bad_polls = 0;
+
+    explicit FakeScanRemote(uint64_t num) : slots(num) {
+        for (uint64_t i = 0; i < num; i++) {
+            slots[i] = i % 7 == 3 ? EMPTY : i;
+        }
+    }
+
+    bool Post(uint64_t first, uint64_t num, char * buf) {
+        if (in_flight) {
+            bad_polls++;
+        }
+        memcpy(buf, &slots[first], num * sizeof(uint64_t));
+        in_flight = true;
+        return true;
+    }
+
+    bool Poll() {
+        if (!in_flight) {
+            bad_polls++;
+        }
+        in_flight = false;
+        return true;
+    }
+};
+
+// consume reads remotely with the start of the send buffer like
+// GetPropertyForVertex, with chunks spanning several windows
+static void Test_ScanWindowsRemoteConsume() {
+    const uint64_t per_window = 64;
+    const uint64_t num_slots = 1000;
+    FakeScanRemote remote(num_slots);
+    vector<char> send_buf(2 * per_window * sizeof(uint64_t));
+    char * halves[2] = {&send_buf[0], &send_buf[per_window * sizeof(uint64_t)]};
+
+    vector<uint64_t> scanned;
+    int consumes = 0;
+    int consumes_in_flight = 0;
+    auto post = [&](uint64_t first, uint64_t num, char * buf) { return remote.Post(first, num, buf); };
+    auto poll = [&]() { return remote.Poll(); };
+    auto decode = [&](uint64_t first, uint64_t num, char * buf, vector<uint64_t> & items) {
+        for (uint64_t i = 0; i < num; i++) {
+            uint64_t v;
+            memcpy(&v, buf + i * sizeof(uint64_t), sizeof(uint64_t));
+            if (v != FakeScanRemote::EMPTY) {
+                items.push_back(v);
+            }
+        }
+    };
+    auto consume = [&](vector<uint64_t> & items) {
+        consumes++;
+        if (remote.in_flight) {
+            consumes_in_flight++;
+        }
+        for (auto & v : items) {
+            // a remote read of a property of v into the send buffer
+            memset(&send_buf[0], 0x5a, send_buf.size());
+            remote.in_flight = true;
+            remote.Poll();
+            scanned.push_back(v);
+        }
+    };
+
+    EXPECT_TRUE(ScanWindows<uint64_t>(0, num_slots, per_window, halves, 150, post, poll, decode, consume));
+
+    vector<uint64_t> expected;
+    for (uint64_t i = 0; i < num_slots; i++) {
+        if (remote.slots[i] != FakeScanRemote::EMPTY) {
+            expected.push_back(i);
+        }
+    }
+    EXPECT_TRUE(scanned == expected);
+    EXPECT_TRUE(consumes > 3);
+    EXPECT_EQ(consumes_in_flight, 0);
+    EXPECT_EQ(remote.bad_polls, 0);
+    EXPECT_TRUE(!remote.in_flight);
+}
+TEST(Test_ScanWindowsRemoteConsume);
+
+// a failed read stops the scan
+static void Test_ScanWindowsReadFailure() {
+    const uint64_t per_window = 16;
+    FakeScanRemote remote(100);
+    vector<char> send_buf(2 * per_window * sizeof(uint64_t));
+    char * halves[2] = {&send_buf[0], &send_buf[per_window * sizeof(uint64_t)]};
+
+    int polls = 0;
+    uint64_t consumed = 0;
+    auto post = [&](uint64_t first, uint64_t num, char * buf) { return remote.Post(first, num, buf); };
+    auto poll = [&]() { remote.Poll(); return ++polls < 3; };
+    auto decode = [&](uint64_t first, uint64_t num, char * buf, vector<uint64_t> & items) {
+        items.insert(items.end(), num, first);
+    };
+    auto consume = [&](vector<uint64_t> & items) { consumed += items.size(); };
+
+    EXPECT_TRUE(!ScanWindows<uint64_t>(0, 100, per_window, halves, 1000, post, poll, decode, consume));
+    EXPECT_EQ(consumed, (uint64_t)0);
+}
+TEST(Test_ScanWindowsReadFailure);
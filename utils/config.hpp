@@ -8,6 +8,7 @@ Authors: Created by Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 
 #include <cstdint>
 #include <string>
+#include "base/type.hpp"
 #include "utils/unit.hpp"
 #include "utils/hdfs_core.hpp"
 #include "glog/logging.h"
@@ -59,6 +60,7 @@ class Config {
     int global_num_threads;
 
     int global_vertex_sz_gb;
+    // inline nbs in each vertex record, -1 for auto
     int global_vertex_in_nbs;
     int global_vertex_out_nbs;
     int global_vertex_table_num;
@@ -78,13 +80,40 @@ class Config {
 
     bool global_use_rdma;
     bool global_enable_caching;
+    int global_cache_sz_mb;
     bool global_enable_core_binding;
     bool global_enable_expert_division;
     bool global_enable_step_reorder;
     bool global_enable_indexing;
     bool global_enable_workstealing;
+    bool global_enable_pipeline;
+    bool global_enable_fair_scheduling;
+    // 0 for no limit
+    int global_max_inflight_queries;
+    // msgs larger than 2 morsels are split among threads, 0 for no split
+    int global_morsel_sz_kb;
+    // period to adapt thread division to load, 0 for static division
+    int global_division_adapt_ms;
+    // place buffers on numa nodes of the threads using them
+    bool global_enable_numa_placement;
+    // size of hugepages backing buffers, 2 or 1024, 0 for normal pages
+    int global_hugepage_sz_mb;
+    // store long neighbor lists compressed
+    bool global_enable_nbs_compression;
+    // placement of vertices in vertex table, VtxOrder_T
+    int global_vertex_order;
+    // batched remote reads within this many bytes are merged, 0 for no merge
+    int global_rdma_coalesce_gap;
+    // read vertices of next hop in background while traversals send their output
+    bool global_enable_prefetch;
 
     int max_data_size;
+    // number of values in one chunk of results sent to client
+    int result_chunk_size;
+    // max number of chunks of one query not consumed by client
+    int result_window;
+    // max number of chunks of one query held beyond result_window
+    int result_max_held;
 
     // ================================================================
     // mutable_config
@@ -117,10 +146,20 @@ class Config {
     // remote_head_buffer_offset = local_head_buffer_sz * local_head_buffer_offset
     uint64_t remote_head_buffer_offset;
 
-    // remote_buffer_sz = vertex_sz + kvstore_sz
+    // per-thread buffer the records of next hop vertices are prefetched into
+    static const uint64_t per_prefetch_buffer_sz = 1 << 20;
+    // prefetch_buffer_sz = num_threads * per_prefetch_buffer_sz if prefetch is enabled, otherwise 0
+    uint64_t prefetch_buffer_sz;
+    // prefetch_buffer_offset = remote_head_buffer_sz + remote_head_buffer_offset
+    uint64_t prefetch_buffer_offset;
+
+    // alloc_header_offset = kvstore_sz + kvstore_offset, see AllocHeader
+    uint64_t alloc_header_offset;
+
+    // remote_buffer_sz = vertex_sz + kvstore_sz + sizeof(AllocHeader)
     uint64_t remote_buffer_sz;
 
-    // local_buffer_sz = send_buffer_sz + recv_buffer_sz + local_head_buffer_sz + remote_head_buffer_sz
+    // local_buffer_sz = send_buffer_sz + recv_buffer_sz + local_head_buffer_sz + remote_head_buffer_sz + prefetch_buffer_sz
     uint64_t local_buffer_sz;
 
     // head [key region] / (head + entry) [Total] * 100
@@ -252,17 +291,37 @@ class Config {
             exit(-1);
         }
 
-        val = iniparser_getint(ini, "SYSTEM:VTX_IN_NBS", val_not_found);
-        if(val != val_not_found) {
-            global_vertex_in_nbs = val;
+        str = iniparser_getstring(ini, "SYSTEM:VTX_IN_NBS", const_cast<char *>(str_not_found));
+        if(strcmp(str, str_not_found) != 0) {
+            // auto is -1, picked from degrees of vertices when loading
+            char * end;
+            long num = strtol(str, &end, 10);
+            if (strcmp(str, "auto") == 0) {
+                global_vertex_in_nbs = -1;
+            } else if (end != str && *end == '\0' && num >= 0 && num <= MAX_INLINE_NBS) {
+                global_vertex_in_nbs = num;
+            } else {
+                fprintf(stderr, "VTX_IN_NBS must be a number in [0, %d] or auto. exits\n", MAX_INLINE_NBS);
+                exit(-1);
+            }
         } else {
             fprintf(stderr, "must enter the VTX_IN_NBS. exits\n");
             exit(-1);
         }
 
-        val = iniparser_getint(ini, "SYSTEM:VTX_OUT_NBS", val_not_found);
-        if(val != val_not_found) {
-            global_vertex_out_nbs = val;
+        str = iniparser_getstring(ini, "SYSTEM:VTX_OUT_NBS", const_cast<char *>(str_not_found));
+        if(strcmp(str, str_not_found) != 0) {
+            // auto is -1, picked from degrees of vertices when loading
+            char * end;
+            long num = strtol(str, &end, 10);
+            if (strcmp(str, "auto") == 0) {
+                global_vertex_out_nbs = -1;
+            } else if (end != str && *end == '\0' && num >= 0 && num <= MAX_INLINE_NBS) {
+                global_vertex_out_nbs = num;
+            } else {
+                fprintf(stderr, "VTX_OUT_NBS must be a number in [0, %d] or auto. exits\n", MAX_INLINE_NBS);
+                exit(-1);
+            }
         } else {
             fprintf(stderr, "must enter the VTX_OUT_NBS. exits\n");
             exit(-1);
@@ -348,6 +407,14 @@ class Config {
             exit(-1);
         }
 
+        val = iniparser_getint(ini, "SYSTEM:CACHE_SZ_MB", val_not_found);
+        if (val != val_not_found) {
+            global_cache_sz_mb = val;
+        } else {
+            fprintf(stderr, "must enter the CACHE_SZ_MB. exits.\n");
+            exit(-1);
+        }
+
         val = iniparser_getboolean(ini, "SYSTEM:ENABLE_CORE_BIND", val_not_found);
         if (val != val_not_found) {
             global_enable_core_binding = val;
@@ -388,6 +455,109 @@ class Config {
             exit(-1);
         }
 
+        val = iniparser_getboolean(ini, "SYSTEM:ENABLE_PIPELINE", val_not_found);
+        if (val != val_not_found) {
+            global_enable_pipeline = val;
+        } else {
+            fprintf(stderr, "must enter the ENABLE_PIPELINE. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getboolean(ini, "SYSTEM:ENABLE_FAIR_SCHED", val_not_found);
+        if (val != val_not_found) {
+            global_enable_fair_scheduling = val;
+        } else {
+            fprintf(stderr, "must enter the ENABLE_FAIR_SCHED. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:MAX_INFLIGHT_QUERIES", val_not_found);
+        if (val != val_not_found) {
+            global_max_inflight_queries = val;
+        } else {
+            fprintf(stderr, "must enter the MAX_INFLIGHT_QUERIES. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:MORSEL_SZ_KB", val_not_found);
+        if (val != val_not_found) {
+            global_morsel_sz_kb = val;
+        } else {
+            fprintf(stderr, "must enter the MORSEL_SZ_KB. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:DIVISION_ADAPT_MS", val_not_found);
+        if (val != val_not_found) {
+            global_division_adapt_ms = val;
+        } else {
+            fprintf(stderr, "must enter the DIVISION_ADAPT_MS. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getboolean(ini, "SYSTEM:ENABLE_NUMA_PLACEMENT", val_not_found);
+        if (val != val_not_found) {
+            global_enable_numa_placement = val;
+        } else {
+            fprintf(stderr, "must enter the ENABLE_NUMA_PLACEMENT. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:HUGEPAGE_SZ_MB", val_not_found);
+        if (val != val_not_found) {
+            if (val != 0 && val != 2 && val != 1024) {
+                fprintf(stderr, "HUGEPAGE_SZ_MB must be 0, 2 or 1024. exits.\n");
+                exit(-1);
+            }
+            global_hugepage_sz_mb = val;
+        } else {
+            fprintf(stderr, "must enter the HUGEPAGE_SZ_MB. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getboolean(ini, "SYSTEM:ENABLE_NBS_COMPRESSION", val_not_found);
+        if (val != val_not_found) {
+            global_enable_nbs_compression = val;
+        } else {
+            fprintf(stderr, "must enter the ENABLE_NBS_COMPRESSION. exits.\n");
+            exit(-1);
+        }
+
+        str = iniparser_getstring(ini, "SYSTEM:VERTEX_ORDER", const_cast<char *>(str_not_found));
+        if (strcmp(str, str_not_found) != 0) {
+            if (strcmp(str, "none") == 0) {
+                global_vertex_order = ORDER_NONE;
+            } else if (strcmp(str, "degree") == 0) {
+                global_vertex_order = ORDER_DEGREE;
+            } else if (strcmp(str, "bfs") == 0) {
+                global_vertex_order = ORDER_BFS;
+            } else if (strcmp(str, "label") == 0) {
+                global_vertex_order = ORDER_LABEL;
+            } else {
+                fprintf(stderr, "VERTEX_ORDER should be none, degree, bfs or label. exits.\n");
+                exit(-1);
+            }
+        } else {
+            fprintf(stderr, "must enter the VERTEX_ORDER. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:RDMA_COALESCE_GAP", val_not_found);
+        if (val != val_not_found) {
+            global_rdma_coalesce_gap = val;
+        } else {
+            fprintf(stderr, "must enter the RDMA_COALESCE_GAP. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getboolean(ini, "SYSTEM:ENABLE_PREFETCH", val_not_found);
+        if (val != val_not_found) {
+            global_enable_prefetch = val;
+        } else {
+            fprintf(stderr, "must enter the ENABLE_PREFETCH. exits.\n");
+            exit(-1);
+        }
+
         val = iniparser_getint(ini, "SYSTEM:MAX_MSG_SIZE", val_not_found);
         if (val != val_not_found) {
             max_data_size = val;
@@ -396,6 +566,30 @@ class Config {
             exit(-1);
         }
 
+        val = iniparser_getint(ini, "SYSTEM:RESULT_CHUNK_SZ", val_not_found);
+        if (val != val_not_found) {
+            result_chunk_size = val;
+        } else {
+            fprintf(stderr, "must enter the RESULT_CHUNK_SZ. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:RESULT_WINDOW", val_not_found);
+        if (val != val_not_found) {
+            result_window = val;
+        } else {
+            fprintf(stderr, "must enter the RESULT_WINDOW. exits.\n");
+            exit(-1);
+        }
+
+        val = iniparser_getint(ini, "SYSTEM:RESULT_MAX_HELD", val_not_found);
+        if (val != val_not_found) {
+            result_max_held = val;
+        } else {
+            fprintf(stderr, "must enter the RESULT_MAX_HELD. exits.\n");
+            exit(-1);
+        }
+
         str = iniparser_getstring(ini, "SYSTEM:SNAPSHOT_PATH", const_cast<char *>(str_not_found));
 
         if (strcmp(str, str_not_found) != 0) {
@@ -429,7 +623,9 @@ class Config {
         kvstore_sz = GiB2B(global_vertex_property_kv_sz_gb) + GiB2B(global_edge_property_kv_sz_gb);
         kvstore_offset = vertex_sz + vertex_offset;
 
-        remote_buffer_sz = vertex_sz + kvstore_sz;
+        alloc_header_offset = kvstore_sz + kvstore_offset;
+
+        remote_buffer_sz = vertex_sz + kvstore_sz + sizeof(AllocHeader);
             
         // remote init hdfs
         hdfs_init(HDFS_HOST_ADDRESS, HDFS_PORT);
@@ -449,7 +645,10 @@ class Config {
         remote_head_buffer_sz = (global_num_workers - 1) * global_num_threads * sizeof(uint64_t);
         remote_head_buffer_offset = local_head_buffer_sz + local_head_buffer_offset;
 
-        local_buffer_sz = send_buffer_sz + recv_buffer_sz + local_head_buffer_sz + remote_head_buffer_sz;
+        prefetch_buffer_sz = global_enable_prefetch ? global_num_threads * per_prefetch_buffer_sz : 0;
+        prefetch_buffer_offset = remote_head_buffer_sz + remote_head_buffer_offset;
+
+        local_buffer_sz = send_buffer_sz + recv_buffer_sz + local_head_buffer_sz + remote_head_buffer_sz + prefetch_buffer_sz;
 
         LOG(INFO) << DebugString();
     }
@@ -467,6 +666,8 @@ class Config {
         ss << "SNAPSHOT_PATH : " << SNAPSHOT_PATH << endl;
 
         ss << "global_vertex_sz_gb : " << global_vertex_sz_gb << endl;
+        ss << "global_vertex_in_nbs : " << global_vertex_in_nbs << endl;
+        ss << "global_vertex_out_nbs : " << global_vertex_out_nbs << endl;
         ss << "global_vertex_property_kv_sz_gb : " << global_vertex_property_kv_sz_gb << endl;
         ss << "global_edge_property_kv_sz_gb : " << global_edge_property_kv_sz_gb << endl;        
 
@@ -480,9 +681,24 @@ class Config {
 
         ss << "global_use_rdma : " << global_use_rdma << endl;
         ss << "global_enable_caching : " << global_enable_caching << endl;
+        ss << "global_cache_sz_mb : " << global_cache_sz_mb << endl;
         ss << "global_enable_core_binding : " << global_enable_core_binding << endl;
         ss << "global_enable_expert_division : " << global_enable_expert_division << endl;
         ss << "global_enable_workstealing : " << global_enable_workstealing << endl;
+        ss << "global_enable_pipeline : " << global_enable_pipeline << endl;
+        ss << "global_enable_fair_scheduling : " << global_enable_fair_scheduling << endl;
+        ss << "global_max_inflight_queries : " << global_max_inflight_queries << endl;
+        ss << "global_morsel_sz_kb : " << global_morsel_sz_kb << endl;
+        ss << "global_division_adapt_ms : " << global_division_adapt_ms << endl;
+        ss << "global_enable_numa_placement : " << global_enable_numa_placement << endl;
+        ss << "global_hugepage_sz_mb : " << global_hugepage_sz_mb << endl;
+        ss << "global_enable_nbs_compression : " << global_enable_nbs_compression << endl;
+        ss << "global_vertex_order : " << global_vertex_order << endl;
+        ss << "global_rdma_coalesce_gap : " << global_rdma_coalesce_gap << endl;
+        ss << "global_enable_prefetch : " << global_enable_prefetch << endl;
+        ss << "result_chunk_size : " << result_chunk_size << endl;
+        ss << "result_window : " << result_window << endl;
+        ss << "result_max_held : " << result_max_held << endl;
         return ss.str();
     }
 };
@@ -0,0 +1,116 @@
+/* Copyright 2019 Husky Data Lab, CUHK
+
+Authors: Nick Fang (jcfang6@cse.cuhk.edu.hk)
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// Allocation and placement of large memory regions
+//
+// Regions are mapped anonymously, so they are zeros without being written
+// and pages are only committed when touched. Placement policies on NUMA nodes
+// are set by the mbind syscall so that no libnuma is needed, they only apply
+// to pages not touched yet, so set them right after Alloc() and before the
+// region is written or registered to RDMA.
+class MemUtil {
+ public:
+    // region of zeros aligned to page_sz, which is set to the page size used
+    // hugepage_mb = 2 or 1024 for hugepages of that size, falls back to
+    // normal pages (with transparent hugepages advised) if none are reserved
+    static char* Alloc(uint64_t size, int hugepage_mb, uint64_t & page_sz) {
+        if (hugepage_mb > 0) {
+            page_sz = (uint64_t)hugepage_mb << 20;
+            int shift = hugepage_mb == 1024 ? 30 : 21;
+            void * addr = mmap(NULL, RoundUp(size, page_sz), PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+            if (addr != MAP_FAILED) {
+                return (char *)addr;
+            }
+            std::cout << "[Warning] No " << hugepage_mb << "MB hugepages for " << (size >> 20) << "MB, use normal pages" << std::endl;
+        }
+
+        page_sz = sysconf(_SC_PAGESIZE);
+        void * addr = mmap(NULL, RoundUp(size, page_sz), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            return NULL;
+        }
+        madvise(addr, size, MADV_HUGEPAGE);
+        return (char *)addr;
+    }
+
+    static void Free(char * addr, uint64_t size, uint64_t page_sz) {
+        munmap(addr, RoundUp(size, page_sz));
+    }
+
+    // commit pages of the region by num_threads threads in parallel, so that
+    // page faults and zeroing by the kernel are not left to one thread later
+    static void Prefault(char * addr, uint64_t size, uint64_t page_sz, int num_threads) {
+        uint64_t num_pages = RoundUp(size, page_sz) / page_sz;
+        num_threads = std::max(1, (int)std::min((uint64_t)num_threads, num_pages));
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; i++) {
+            threads.emplace_back([=]() {
+                for (uint64_t p = i; p < num_pages; p += num_threads) {
+                    // write the zero it already holds
+                    volatile char * c = addr + p * page_sz;
+                    *c = 0;
+                }
+            });
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+    }
+
+    // put pages inside [addr, addr + len) on node if it has free memory
+    static bool Prefer(char * addr, uint64_t len, uint64_t page_sz, int node) {
+        if (node < 0 || node >= MAX_NODES) {
+            return false;
+        }
+        return Bind(addr, len, page_sz, MPOL_PREFERRED_, 1ul << node);
+    }
+
+    // spread pages inside [addr, addr + len) over the first num_nodes nodes
+    static bool Interleave(char * addr, uint64_t len, uint64_t page_sz, int num_nodes) {
+        if (num_nodes <= 1) {
+            return false;
+        }
+        num_nodes = num_nodes < MAX_NODES ? num_nodes : MAX_NODES;
+        uint64_t mask = num_nodes == 64 ? ~0ul : (1ul << num_nodes) - 1;
+        return Bind(addr, len, page_sz, MPOL_INTERLEAVE_, mask);
+    }
+
+ private:
+    // modes of mbind, as in numaif.h
+    static const int MPOL_PREFERRED_ = 1;
+    static const int MPOL_INTERLEAVE_ = 3;
+    static const int MAX_NODES = 64;
+
+    static uint64_t RoundUp(uint64_t size, uint64_t page_sz) {
+        return (size + page_sz - 1) / page_sz * page_sz;
+    }
+
+    static bool Bind(char * addr, uint64_t len, uint64_t page_sz, int mode, uint64_t mask) {
+        // mbind takes whole pages, leave partial pages at both ends as they are
+        uint64_t start = RoundUp((uint64_t)addr, page_sz);
+        uint64_t end = ((uint64_t)addr + len) / page_sz * page_sz;
+        if (start >= end) {
+            return false;
+        }
+        return syscall(SYS_mbind, start, end - start, mode, &mask, MAX_NODES + 1, 0) == 0;
+    }
+};
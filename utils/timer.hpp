@@ -8,6 +8,7 @@ Authors: Hongzhi Chen (hzchen@cse.cuhk.edu.hk)
 
 #include <emmintrin.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdint.h>
 #include <string>
@@ -111,6 +111,39 @@ class Tool {
         return s;
     }
 
+    // escape string to be written as a json string literal
+    static string escape_json(const string &s) {
+        string result;
+        for (char c : s) {
+            switch (c) {
+            case '"':
+                result += "\\\"";
+                break;
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                } else {
+                    result += c;
+                }
+            }
+        }
+        return result;
+    }
+
     static int value_t2int(const value_t & v) {
         return *reinterpret_cast<const int *>(&(v.content[0]));
     }
@@ -276,7 +309,7 @@ class Tool {
             if (val.type != type) {
                 return false;
             }
-            v.content.insert(v.content.begin(), val.content.begin(), val.content.end());
+            v.content.insert(v.content.end(), val.content.begin(), val.content.end());
             v.content.push_back('\t');
         }
 
@@ -333,7 +366,7 @@ class Tool {
         v.type = e.type;
     }
 
-    static string DebugString(value_t & v) {
+    static string DebugString(const value_t & v) {
         double d;
         int i;
         uint64_t u;